@@ -4,6 +4,8 @@
 #include "cyTriMesh.h"
 #include "cyMatrix.h"
 #include "cyGL.h"
+#include "Transform.h"
+#include "Profiler.h"
 #include <iostream>
 #include <chrono>
 
@@ -31,6 +33,7 @@ cy::GLSLProgram lineProg;
 bool leftButtonPressed = false;
 bool controlKeyPressed = false;
 cy::TriMesh mesh;
+Transform::ModelTransform meshTransform;   // bounds of mesh, model matrix
 cy::Vec3f lightPosLocalSpace = cy::Vec3f(15.0, -15.0, 15.0);
 
 // Variables to store mouse click position
@@ -215,31 +218,35 @@ void PhysicsUpdate(PhysicsState& state, cy::Vec3f force, float deltaTime) {
 
 void display() {
     // set uniforms    
-     // Calculate the bounding box
-    mesh.ComputeBoundingBox();
-    cy::Vec3f center = (mesh.GetBoundMin() + mesh.GetBoundMax()) * 0.5f;
-    // Adjust the model transformation matrix to center the object
-    cy::Matrix4f model = cy::Matrix4f::Translation(-center); 
-    model *= cy::Matrix4f::Translation(physicsState.position);
+    // model matrix centres the object, rebuilt only when it moved
+    meshTransform.SetPosition(physicsState.position);
+    const cy::Matrix4f& model = meshTransform.Matrix();
 
 
     // Your rendering code goes here
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // Draw your graphics here
-    prog.Bind();
-    prog["lightPosLocalSpace"] = lightPosLocalSpace;
-    prog["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
-    prog["model"] = model;
-    prog["view"] = view;
-    prog["projection"] = proj;
-    prog["cameraViewPos"] = view * cy::Vec3f(0.0f, 0.0f, camera_distance);
-    prog["normalTransform"] = (view*model).GetSubMatrix3();
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, mesh.NF() * 3, GL_UNSIGNED_INT, 0);
+    {
+        PROFILE_SCOPE("uniforms");
+        prog.Bind();
+        prog["lightPosLocalSpace"] = lightPosLocalSpace;
+        prog["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
+        prog["model"] = model;
+        prog["view"] = view;
+        prog["projection"] = proj;
+        prog["cameraViewPos"] = view * cy::Vec3f(0.0f, 0.0f, camera_distance);
+        prog["normalTransform"] = (view*model).GetSubMatrix3();
+    }
+    {
+        PROFILE_SCOPE("draw");
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, mesh.NF() * 3, GL_UNSIGNED_INT, 0);
+    }
 
     // DRAW LINE
     if (arrowVisible)
     {
+        PROFILE_SCOPE("arrow");
         GLuint lineVBO;
         glGenVertexArrays(1, &lineVAO);
         glBindVertexArray(lineVAO);
@@ -275,11 +282,16 @@ void display() {
         glBindVertexArray(0);
     }
 
-    glutSwapBuffers();
+    {
+        PROFILE_SCOPE("swap");
+        glutSwapBuffers();
+    }
+    PROFILE_FRAME();
 }
 
 void keyboard(unsigned char key, int x, int y) {
     if (key == 27) {  // ASCII value for the Esc key
+        PROFILE_SHUTDOWN();
         glutLeaveMainLoop();
     } else if (key == 'v' || key == 'V') {  
         velocityFieldOn = !velocityFieldOn;
@@ -377,6 +389,7 @@ void loadModel(int argc, char** argv, cy::TriMesh & mesh) {
         cout << "Loaded model successfully." << endl;
         num_vertices = mesh.NV();
         mesh.ComputeNormals();
+        meshTransform.SetMesh(mesh, 1.0f);
     }
 }
 
@@ -385,10 +398,13 @@ void idle() {
     auto currentTime = std::chrono::high_resolution_clock::now();
     std::chrono::duration<float> elapsedTime = currentTime - lastTime;
     float deltaTime = elapsedTime.count();
-    if (implicitMode) {
-        PhysicsUpdateImplicit(physicsState, deltaTime);
-    } else {
-        PhysicsUpdate(physicsState, forceVector, deltaTime);
+    {
+        PROFILE_SCOPE("physics");
+        if (implicitMode) {
+            PhysicsUpdateImplicit(physicsState, deltaTime);
+        } else {
+            PhysicsUpdate(physicsState, forceVector, deltaTime);
+        }
     }
 
     lastTime = currentTime;
@@ -0,0 +1,365 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cyTriMesh.h"
+
+// Convex hulls of the loaded meshes, used as contact proxies: only hull vertices can be the
+// deepest point of a convex body against a plane, and a mesh has far fewer of them than vertices.
+// The hull carries its edge graph, so the support point in a direction (the vertex furthest along
+// it) is found by hill climbing from the last answer, and the vertices below a plane by a walk from
+// the support point; on a convex polytope both sets are connected.
+//
+// Hulls are cached next to the model (model.obj.hull) and recomputed when the mesh changes.
+namespace Hull {
+
+struct ConvexHull {
+    std::vector<unsigned int> indices;        // mesh vertex of each hull vertex
+    std::vector<unsigned int> faces;          // triangles over hull vertices, counter-clockwise from outside
+    std::vector<cy::Vec3f>    points;         // hull vertex positions, mesh space
+    std::vector<unsigned int> neighbourStart; // edge graph (CSR): neighbours of v are
+    std::vector<unsigned int> neighbours;     // neighbours[neighbourStart[v], neighbourStart[v + 1])
+    std::vector<unsigned int> seeds;          // support along each SeedDirection
+
+    size_t Size() const { return points.size(); }
+
+    // Support seeds on a cube map: face (axis and sign of the largest component) and a
+    // seedGrid x seedGrid cell of the ratios of the other two components to it.
+    static const int seedGrid = 8;
+
+    static int SeedCell(const cy::Vec3f& d) {
+        int axis = 0;
+        for (int a = 1; a < 3; a++) if (std::fabs(d[a]) > std::fabs(d[axis])) axis = a;
+        float major = std::fabs(d[axis]);
+        if (major == 0.0f) return 0;
+        int face = 2 * axis + (d[axis] < 0.0f ? 1 : 0);
+        int u = std::min(int((d[(axis + 1) % 3] / major + 1.0f) * 0.5f * seedGrid), seedGrid - 1);
+        int v = std::min(int((d[(axis + 2) % 3] / major + 1.0f) * 0.5f * seedGrid), seedGrid - 1);
+        return (face * seedGrid + u) * seedGrid + v;
+    }
+
+    static cy::Vec3f SeedDirection(int cell) {
+        int face = cell / (seedGrid * seedGrid), u = cell / seedGrid % seedGrid, v = cell % seedGrid;
+        int axis = face / 2;
+        cy::Vec3f d;
+        d[axis] = face % 2 ? -1.0f : 1.0f;
+        d[(axis + 1) % 3] = (u + 0.5f) / seedGrid * 2.0f - 1.0f;
+        d[(axis + 2) % 3] = (v + 0.5f) / seedGrid * 2.0f - 1.0f;
+        return d;
+    }
+
+    // Hull vertex furthest along d, by hill climbing from start (pass the last answer for a
+    // slowly turning direction) or from the seed of d's cube map cell, whichever is further along.
+    unsigned int Support(const cy::Vec3f& d, unsigned int start = 0) const {
+        if (neighbours.empty()) {   // degenerate hull, no edge graph
+            unsigned int best = 0;
+            for (unsigned int v = 1; v < Size(); v++) if (points[v].Dot(d) > points[best].Dot(d)) best = v;
+            return best;
+        }
+        unsigned int best = start;
+        float bestDot = points[best].Dot(d);
+        unsigned int seed = seeds[SeedCell(d)];
+        if (points[seed].Dot(d) > bestDot) { best = seed; bestDot = points[seed].Dot(d); }
+        for (bool moved = true; moved; ) {
+            moved = false;
+            for (unsigned int k = neighbourStart[best]; k < neighbourStart[best + 1]; k++) {
+                float dot = points[neighbours[k]].Dot(d);
+                if (dot > bestDot) { best = neighbours[k]; bestDot = dot; moved = true; }
+            }
+        }
+        return best;
+    }
+
+    // Fills positions (points) and the edge graph from indices and faces.
+    void Finish(const cy::TriMesh& mesh) {
+        points.resize(indices.size());
+        for (size_t v = 0; v < indices.size(); v++) points[v] = mesh.V(indices[v]);
+        std::vector<std::vector<unsigned int>> adjacent(indices.size());
+        for (size_t f = 0; f < faces.size(); f += 3) {
+            for (int e = 0; e < 3; e++) adjacent[faces[f + e]].push_back(faces[f + (e + 1) % 3]);   // each edge appears once per direction
+        }
+        neighbourStart.assign(1, 0);
+        neighbours.clear();
+        for (auto &a : adjacent) {
+            neighbours.insert(neighbours.end(), a.begin(), a.end());
+            neighbourStart.push_back(unsigned(neighbours.size()));
+        }
+        seeds.assign(6 * seedGrid * seedGrid, 0);
+        for (size_t cell = 0; cell < seeds.size(); cell++) {
+            cy::Vec3f d = SeedDirection(int(cell));
+            for (unsigned int v = 1; v < Size(); v++) if (points[v].Dot(d) > points[seeds[cell]].Dot(d)) seeds[cell] = v;
+        }
+    }
+};
+
+namespace detail {
+
+struct Face {
+    int    v[3];
+    double normal[3];
+    double offset;
+    std::vector<int> outside;   // points in front of the face
+    int    furthest = -1;
+    double furthestDistance = 0.0;
+    bool   alive = true;
+};
+
+struct Vec {
+    double x, y, z;
+    double operator[](int a) const { return a == 0 ? x : a == 1 ? y : z; }
+};
+
+inline Vec Sub(const Vec& a, const Vec& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Vec Cross(const Vec& a, const Vec& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline double Dot(const Vec& a, const Vec& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+} // namespace detail
+
+// Quickhull: start from a tetrahedron of extreme points, then repeatedly take the point furthest
+// in front of some face, remove the faces it sees and close the hole with a fan to it. Points
+// within eps of a face count as inside, which also drops duplicates and near-coplanar points.
+// Falls back to all vertices without faces for flat or degenerate meshes.
+inline ConvexHull Compute(const cy::TriMesh& mesh) {
+    using namespace detail;
+    ConvexHull hull;
+    const int n = int(mesh.NV());
+    std::vector<Vec> p(n);
+    double scale = 0.0;
+    for (int i = 0; i < n; i++) {
+        p[i] = { mesh.V(i).x, mesh.V(i).y, mesh.V(i).z };
+        scale = std::max(scale, std::fabs(p[i].x) + std::fabs(p[i].y) + std::fabs(p[i].z));
+    }
+    const double eps = 1e-6 * scale;
+    auto fallback = [&]() {
+        ConvexHull all;
+        for (int i = 0; i < n; i++) all.indices.push_back(unsigned(i));
+        all.Finish(mesh);
+        return all;
+    };
+    if (n < 4) return fallback();
+
+    // initial tetrahedron: the widest pair of axis extremes, the point furthest from their line,
+    // and the point furthest from that plane
+    int extreme[6] = { 0, 0, 0, 0, 0, 0 };   // min and max point on each axis
+    for (int i = 0; i < n; i++) {
+        for (int a = 0; a < 3; a++) {
+            if (p[i][a] < p[extreme[2 * a]][a]) extreme[2 * a] = i;
+            if (p[i][a] > p[extreme[2 * a + 1]][a]) extreme[2 * a + 1] = i;
+        }
+    }
+    int i0 = 0, i1 = 0;
+    double widest = -1.0;
+    for (int a = 0; a < 6; a++) {
+        for (int b = a + 1; b < 6; b++) {
+            Vec d = Sub(p[extreme[a]], p[extreme[b]]);
+            if (Dot(d, d) > widest) { widest = Dot(d, d); i0 = extreme[a]; i1 = extreme[b]; }
+        }
+    }
+    Vec line = Sub(p[i1], p[i0]);
+    int i2 = -1;
+    double furthest = eps * eps;
+    for (int i = 0; i < n; i++) {
+        Vec c = Cross(line, Sub(p[i], p[i0]));
+        if (Dot(c, c) / Dot(line, line) > furthest) { furthest = Dot(c, c) / Dot(line, line); i2 = i; }
+    }
+    if (i2 < 0) return fallback();
+    Vec planeNormal = Cross(line, Sub(p[i2], p[i0]));
+    double planeLength = std::sqrt(Dot(planeNormal, planeNormal));
+    int i3 = -1;
+    furthest = eps;
+    for (int i = 0; i < n; i++) {
+        double d = std::fabs(Dot(planeNormal, Sub(p[i], p[i0]))) / planeLength;
+        if (d > furthest) { furthest = d; i3 = i; }
+    }
+    if (i3 < 0) return fallback();
+
+    std::vector<Face> faces;
+    auto addFace = [&](int a, int b, int c) {
+        Face f;
+        f.v[0] = a; f.v[1] = b; f.v[2] = c;
+        Vec normal = Cross(Sub(p[b], p[a]), Sub(p[c], p[a]));
+        double length = std::sqrt(Dot(normal, normal));
+        if (length > 0.0) normal = { normal.x / length, normal.y / length, normal.z / length };
+        f.normal[0] = normal.x; f.normal[1] = normal.y; f.normal[2] = normal.z;
+        f.offset = Dot(normal, p[a]);
+        faces.push_back(std::move(f));
+        return int(faces.size()) - 1;
+    };
+    auto distance = [&](const Face& f, int i) {
+        return f.normal[0] * p[i].x + f.normal[1] * p[i].y + f.normal[2] * p[i].z - f.offset;
+    };
+    // assigns point i to the face among candidates it is furthest in front of, if any
+    auto assign = [&](int i, const std::vector<int>& candidates) {
+        int best = -1;
+        double bestDistance = eps;
+        for (int f : candidates) {
+            double d = distance(faces[f], i);
+            if (d > bestDistance) { bestDistance = d; best = f; }
+        }
+        if (best < 0) return;
+        Face &f = faces[best];
+        f.outside.push_back(i);
+        if (bestDistance > f.furthestDistance) { f.furthestDistance = bestDistance; f.furthest = i; }
+    };
+
+    bool flip = Dot(planeNormal, Sub(p[i3], p[i0])) > 0.0;   // i3 in front of (i0, i1, i2): turn that face around
+    std::vector<int> initial;
+    if (flip) {
+        initial = { addFace(i0, i2, i1), addFace(i0, i1, i3), addFace(i1, i2, i3), addFace(i2, i0, i3) };
+    } else {
+        initial = { addFace(i0, i1, i2), addFace(i0, i3, i1), addFace(i1, i3, i2), addFace(i2, i3, i0) };
+    }
+    for (int i = 0; i < n; i++) {
+        if (i != i0 && i != i1 && i != i2 && i != i3) assign(i, initial);
+    }
+
+    // directed edge (a, b) -> the live face that has it
+    std::unordered_map<uint64_t, int> faceOfEdge;
+    auto edgeKey = [](int a, int b) { return (uint64_t(uint32_t(a)) << 32) | uint32_t(b); };
+    auto link = [&](int f) {
+        for (int e = 0; e < 3; e++) faceOfEdge[edgeKey(faces[f].v[e], faces[f].v[(e + 1) % 3])] = f;
+    };
+    for (int f : initial) link(f);
+
+    // Faces are only added at the end, and a face passed without outside points never gets any,
+    // so one pass over the growing list finishes the hull.
+    std::vector<int> visible, created;
+    std::vector<std::pair<int, int>> horizon;
+    std::vector<char> seen;
+    for (size_t current = 0; current < faces.size(); current++) {
+        if (!faces[current].alive || faces[current].outside.empty()) continue;
+        const int eye = faces[current].furthest;
+
+        // faces the eye point sees, grown from the current one so they form one patch; the horizon
+        // is the patch boundary, in the patch faces' winding
+        seen.assign(faces.size(), 0);
+        visible.assign(1, int(current));
+        seen[current] = 1;
+        horizon.clear();
+        for (size_t k = 0; k < visible.size(); k++) {
+            const Face &f = faces[visible[k]];
+            for (int e = 0; e < 3; e++) {
+                int a = f.v[e], b = f.v[(e + 1) % 3];
+                int g = faceOfEdge[edgeKey(b, a)];
+                if (seen[g] == 1) continue;
+                if (seen[g] == 0 && distance(faces[g], eye) > eps) {
+                    seen[g] = 1;
+                    visible.push_back(g);
+                } else {
+                    seen[g] = 2;   // checked, not visible
+                    horizon.emplace_back(a, b);
+                }
+            }
+        }
+
+        for (int f : visible) {
+            faces[f].alive = false;
+            for (int e = 0; e < 3; e++) faceOfEdge.erase(edgeKey(faces[f].v[e], faces[f].v[(e + 1) % 3]));
+        }
+        created.clear();
+        for (auto &edge : horizon) {
+            created.push_back(addFace(edge.first, edge.second, eye));
+            link(created.back());
+        }
+        for (int f : visible) {
+            std::vector<int> orphans = std::move(faces[f].outside);
+            for (int i : orphans) {
+                if (i != eye) assign(i, created);
+            }
+        }
+    }
+
+    // compact: hull vertices in mesh order, faces over them
+    std::vector<int> slot(n, -1);
+    for (auto &f : faces) {
+        if (!f.alive) continue;
+        for (int e = 0; e < 3; e++) slot[f.v[e]] = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (slot[i] < 0) continue;
+        slot[i] = int(hull.indices.size());
+        hull.indices.push_back(unsigned(i));
+    }
+    for (auto &f : faces) {
+        if (!f.alive) continue;
+        for (int e = 0; e < 3; e++) hull.faces.push_back(unsigned(slot[f.v[e]]));
+    }
+    hull.Finish(mesh);
+    return hull;
+}
+
+// Cache file: FileHeader, then the hull vertex indices and the face indices as uint32.
+// meshHash identifies the mesh the hull was computed from.
+struct FileHeader {
+    char     magic[4]     = {'H', 'W', '2', 'H'};
+    uint32_t version      = 1;
+    uint32_t meshVertices = 0;
+    uint32_t numIndices   = 0;
+    uint32_t numFaces     = 0;   // triangles
+    uint64_t meshHash     = 0;   // FNV-1a of the mesh vertex positions
+};
+
+inline uint64_t MeshHash(const cy::TriMesh& mesh) {
+    uint64_t h = 14695981039346656037ull;
+    if (mesh.NV() == 0) return h;   // no V(0) to take the address of
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&mesh.V(0));
+    for (size_t i = 0; i < sizeof(cy::Vec3f) * mesh.NV(); i++) h = (h ^ bytes[i]) * 1099511628211ull;
+    return h;
+}
+
+inline bool Load(const std::string& fileName, const cy::TriMesh& mesh, ConvexHull& hull) {
+    std::FILE* file = std::fopen(fileName.c_str(), "rb");
+    if (!file) return false;
+    FileHeader header, expected;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+              std::memcmp(header.magic, expected.magic, 4) == 0 && header.version == expected.version &&
+              header.meshVertices == mesh.NV() && header.meshHash == MeshHash(mesh);
+    if (ok) {
+        hull.indices.resize(header.numIndices);
+        hull.faces.resize(size_t(header.numFaces) * 3);
+        ok = std::fread(hull.indices.data(), sizeof(unsigned int), hull.indices.size(), file) == hull.indices.size() &&
+             std::fread(hull.faces.data(), sizeof(unsigned int), hull.faces.size(), file) == hull.faces.size();
+        for (unsigned int i : hull.indices) ok = ok && i < mesh.NV();
+        for (unsigned int v : hull.faces) ok = ok && v < hull.indices.size();
+    }
+    std::fclose(file);
+    if (ok) hull.Finish(mesh);
+    return ok;
+}
+
+inline void Save(const std::string& fileName, const cy::TriMesh& mesh, const ConvexHull& hull) {
+    FileHeader header;
+    header.meshVertices = mesh.NV();
+    header.numIndices   = uint32_t(hull.indices.size());
+    header.numFaces     = uint32_t(hull.faces.size() / 3);
+    header.meshHash     = MeshHash(mesh);
+    std::FILE* file = std::fopen(fileName.c_str(), "wb");
+    bool ok = file &&
+              std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(hull.indices.data(), sizeof(unsigned int), hull.indices.size(), file) == hull.indices.size() &&
+              std::fwrite(hull.faces.data(), sizeof(unsigned int), hull.faces.size(), file) == hull.faces.size();
+    if (file) std::fclose(file);
+    if (!ok) std::cerr << "Cannot write hull cache " << fileName << std::endl;
+}
+
+// The hull of mesh, from fileName if it holds one for this mesh, else computed and saved there.
+inline ConvexHull LoadOrCompute(const cy::TriMesh& mesh, const std::string& fileName) {
+    ConvexHull hull;
+    if (Load(fileName, mesh, hull)) return hull;
+    hull = Compute(mesh);
+    Save(fileName, mesh, hull);
+    std::cout << "Convex hull: " << hull.Size() << " of " << mesh.NV() << " vertices, cached in " << fileName << std::endl;
+    return hull;
+}
+
+} // namespace Hull
+
+#endif // HULL_H
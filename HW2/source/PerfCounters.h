@@ -0,0 +1,158 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+// Hardware performance counters (cycles, instructions, LLC misses, branch mispredicts) for
+// code phases, through Linux perf_event_open.
+//
+//   PerfCounters::enabled = true;   or run with HW_PERF_COUNTERS=1
+//   { PERF_SCOPE("springs"); ... }  adds the counts of the scope to the "springs" totals
+//   PerfCounters::TakeTotals()      per-phase totals of the calling thread since the last call
+//
+// Counters are opened per thread on first use. Any counter the kernel refuses (no PMU in a
+// container or VM, perf_event_paranoid too high, non-Linux builds) is reported as unavailable
+// once and then skipped, so instrumented code runs the same with or without counters.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PerfCounters {
+
+enum Counter { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+inline const char* CounterName(int c) {
+    static const char* names[NUM_COUNTERS] = { "cycles", "instructions", "llc_misses", "branch_misses" };
+    return names[c];
+}
+
+inline bool enabled = std::getenv("HW_PERF_COUNTERS") != nullptr;
+
+struct Values {
+    uint64_t count[NUM_COUNTERS] = {};
+    bool     valid[NUM_COUNTERS] = {};
+};
+
+struct PhaseTotals {
+    uint64_t calls = 0;
+    Values   values;
+};
+
+// The counters of one thread. Multiplexed counts are scaled by enabled/running time.
+class ThreadCounters {
+public:
+    ThreadCounters() {
+#ifdef __linux__
+        static const uint64_t configs[NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size           = sizeof(attr);
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.config         = configs[c];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[c] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fd[c] >= 0) {
+                available = true;
+            } else {
+                ReportUnavailable(CounterName(c), std::strerror(errno));
+            }
+        }
+#else
+        ReportUnavailable("all counters", "perf_event_open is Linux only");
+#endif
+    }
+
+    ~ThreadCounters() {
+#ifdef __linux__
+        for (int f : fd) if (f >= 0) close(f);
+#endif
+    }
+
+    bool Available() const { return available; }
+
+    void Read(Values& v) const {
+#ifdef __linux__
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            uint64_t data[3];   // value, time enabled, time running
+            v.valid[c] = fd[c] >= 0 && read(fd[c], data, sizeof(data)) == sizeof(data);
+            if (v.valid[c]) v.count[c] = data[2] > 0 ? uint64_t(double(data[0]) * data[1] / data[2]) : data[0];
+        }
+#else
+        (void)v;
+#endif
+    }
+
+    std::map<std::string, PhaseTotals> totals;
+
+private:
+    int  fd[NUM_COUNTERS] = { -1, -1, -1, -1 };
+    bool available = false;
+
+    static void ReportUnavailable(const char* what, const char* why) {
+        static bool reported = false;
+        if (reported) return;
+        reported = true;
+        std::cerr << "Hardware counters unavailable (" << what << ": " << why << "), they are reported as missing" << std::endl;
+    }
+};
+
+inline ThreadCounters& Thread() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+// Counts the enclosing scope into the per-phase totals of this thread, when counters are on.
+class Scope {
+public:
+    explicit Scope(const char* name) : name(name) {
+        if (!enabled || !Thread().Available()) return;
+        active = true;
+        Thread().Read(start);
+    }
+    ~Scope() {
+        if (!active) return;
+        Values end;
+        auto& counters = Thread();
+        counters.Read(end);
+        PhaseTotals& t = counters.totals[name];
+        t.calls++;
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (!start.valid[c] || !end.valid[c]) continue;
+            t.values.valid[c] = true;
+            t.values.count[c] += end.count[c] - start.count[c];
+        }
+    }
+
+private:
+    const char* name;
+    bool        active = false;
+    Values      start;
+};
+
+// Per-phase totals of the calling thread since the previous call.
+inline std::map<std::string, PhaseTotals> TakeTotals() {
+    std::map<std::string, PhaseTotals> result;
+    if (enabled) result.swap(Thread().totals);
+    return result;
+}
+
+} // namespace PerfCounters
+
+#define PERF_COUNTERS_CONCAT_INNER(a, b) a##b
+#define PERF_COUNTERS_CONCAT(a, b) PERF_COUNTERS_CONCAT_INNER(a, b)
+#define PERF_SCOPE(name) PerfCounters::Scope PERF_COUNTERS_CONCAT(perfScope, __LINE__)(name)
+
+#endif // PERFCOUNTERS_H
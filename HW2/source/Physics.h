@@ -3,7 +3,11 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
 #include "Util.h"
+#include "RigidBody.h"
 
 
 struct PhysicsState {
@@ -11,8 +15,56 @@ struct PhysicsState {
     cy::Vec3f position;
     cy::Vec3f velocity;
 
-    cy::Matrix3f orientation;    // Rotation matrix representing orientation
-    cy::Vec3f angularVelocity;   // Angular velocity (axis-angle representation)
+    RigidBody::Quat rotation;    // orientation, a unit quaternion (set with SetOrientation)
+    cy::Matrix3f orientation;    // rotation matrix of rotation, kept in step with it
+    cy::Vec3f angularVelocity;   // world space, radians per second around its direction
+
+    // body space, per unit mass, about position (the center of mass); see SetMassProperties
+    cy::Matrix3f inertia    = cy::Matrix3f::Identity();
+    cy::Matrix3f invInertia = cy::Matrix3f::Identity();
+};
+
+// Rest detection: a body whose kinetic energy per unit mass stays below energy for frames
+// frames in a row falls asleep and is skipped (no collision, no integration) until woken.
+struct SleepState {
+    float energy = 0.05f;
+    int   frames = 60;
+    int   calm   = 0;      // calm frames in a row
+    bool  asleep = false;
+};
+
+// Adaptive substeps (see AdvanceAdaptive). The body has no springs, so there is no stiffness
+// limit; the step is bounded by how far it may move and turn, and by the step-doubling error.
+struct StepControl {
+    float dtMin       = 1e-4f;
+    float dtMax       = 0.1f;
+    float maxMove     = 0.5f;     // per step, scene units
+    float maxTurn     = 0.1f;     // per step, radians
+    float tolerance   = 1e-3f;    // local error per step, scene units (rotation error taken at unit radius)
+    float safety      = 0.9f;
+    float maxGrow     = 2.0f;
+    float minShrink   = 0.2f;
+    int   maxSubsteps = 32;       // per frame; the rest of the frame's time is dropped
+
+    float dt       = 1.0f / 60.0f;   // proposal for the next substep
+    float pending  = 0.0f;           // frame time not yet stepped
+    int   substeps = 0;              // of the last frame
+    int   rejected = 0;
+};
+
+// Contact vertices of the body (its convex hull, see Hull.h) in world space, stored as separate
+// x, y, z arrays so the transform loop vectorizes. UpdateContactVertices recomputes them only
+// when the body has moved, and finds the lowest one in the same pass, so the floor test is
+// skipped while the body is clear of the floor.
+struct ContactVertices {
+    std::vector<float> localX, localY, localZ;   // body space, placed like the model matrix places the mesh
+    std::vector<float> x, y, z;                  // world space
+    float lowest = 0.0f;                         // smallest y
+    bool  valid  = false;
+    cy::Vec3f    position;                       // the transform x, y, z were computed with
+    cy::Matrix3f orientation;
+
+    size_t Size() const { return x.size(); }
 };
 
 // Global boundaries and restitution factor.
@@ -23,6 +75,25 @@ cy::Vec3f maxBounds = {47.0f, 25.0f, 47.0f};
 
 namespace Physics {
 
+inline void SetOrientation(PhysicsState& state, const RigidBody::Quat& rotation) {
+    state.rotation = rotation;
+    state.rotation.Normalize();
+    state.orientation = state.rotation.ToMatrix();
+}
+
+// Inertia of the mesh the body was built from, with the mesh scaled by scale around its center of mass.
+inline void SetMassProperties(PhysicsState& state, const RigidBody::MassProperties& props, float scale) {
+    state.inertia = props.inertia * (scale * scale);
+    state.invInertia = state.inertia.GetInverse();
+}
+
+// Rotational part of the effective mass of a contact at r along the direction n,
+// n . ((I^-1 (r x n)) x r) = (r x n) . I^-1 (r x n), for a world space inverse inertia.
+inline float AngularResponse(const cy::Matrix3f& invInertia, const cy::Vec3f& r, const cy::Vec3f& n) {
+    cy::Vec3f rn = r.Cross(n);
+    return rn.Dot(invInertia * rn);
+}
+
 // This function uses an explicit integration method for updating the physics state.
 inline void PhysicsUpdate(PhysicsState& state, cy::Vec3f force, cy::Vec3f torque, float deltaTime) {
     if (state.mass <= 0.0f) return; // Avoid division by zero
@@ -36,21 +107,15 @@ inline void PhysicsUpdate(PhysicsState& state, cy::Vec3f force, cy::Vec3f torque
     state.position += state.velocity * deltaTime;
 
 
-    // Rotational dynamics (assuming an identity inertia tensor):
-    cy::Vec3f angularAcceleration = torque;
-    // Integrate angular velocity: ω = ω0 + α * dt
+    // Rotational dynamics: α = I⁻¹ τ with the inertia tensor in world space
+    cy::Vec3f angularAcceleration = RigidBody::WorldInverseInertia(state.orientation, state.invInertia, state.mass) * torque;
+    // Integrate angular velocity: ω = ω0 + α * dt, then the gyroscopic term (implicit)
     state.angularVelocity += angularAcceleration * deltaTime;
+    state.angularVelocity = RigidBody::GyroscopicStep(state.angularVelocity, state.orientation, state.inertia, deltaTime);
 
-    // Compute incremental rotation from angular velocity
-    float angularSpeed = state.angularVelocity.Length();
-    if (angularSpeed > 0.0f) {
-        cy::Vec3f axis = state.angularVelocity.GetNormalized();
-        cy::Matrix3f incrementalRotation;
-        incrementalRotation.SetRotation(axis, angularSpeed * deltaTime);
-
-        // Update orientation
-        state.orientation = incrementalRotation * state.orientation;
-    }
+    // Rotate the quaternion by ω * dt; it is renormalized, the matrix follows
+    RigidBody::Integrate(state.rotation, state.angularVelocity, deltaTime);
+    state.orientation = state.rotation.ToMatrix();
     
     // Check for wall boundary on the x, y, and z axes (3D box)
     for (int i = 0; i < 3; i++) {
@@ -64,17 +129,116 @@ inline void PhysicsUpdate(PhysicsState& state, cy::Vec3f force, cy::Vec3f torque
     }
 }
 
-// Process collisions for each vertex of the model
-// vertices: a collection of the model's vertices in world space
-void ProcessFloorCollision(PhysicsState& state, const std::vector<cy::Vec3f>& vertices) {
+// Covers frameTime with adaptive substeps and returns the time simulated. Each substep is taken
+// once with h and again as two steps of h/2; their difference estimates the local error. Over the
+// tolerance the substep is retried smaller, otherwise the more accurate half-step result is kept
+// and the next step grows. Time short of a whole substep carries over to the next frame.
+inline float AdvanceAdaptive(PhysicsState& state, cy::Vec3f force, cy::Vec3f torque, float frameTime, StepControl& control) {
+    control.pending += frameTime;
+    control.substeps = control.rejected = 0;
+    float covered = 0.0f;
+    while (control.substeps < control.maxSubsteps) {
+        float h = control.dt;
+        float speed = state.velocity.Length(), spin = state.angularVelocity.Length();
+        if (speed > 0.0f) h = std::min(h, control.maxMove / speed);
+        if (spin > 0.0f)  h = std::min(h, control.maxTurn / spin);
+        h = std::max(h, control.dtMin);
+        if (control.pending < h) break;
+
+        PhysicsState full = state, half = state;
+        PhysicsUpdate(full, force, torque, h);
+        PhysicsUpdate(half, force, torque, 0.5f * h);
+        PhysicsUpdate(half, force, torque, 0.5f * h);
+        float turnError = 0.0f;
+        for (int i = 0; i < 9; i++) turnError += (full.orientation.cell[i] - half.orientation.cell[i]) * (full.orientation.cell[i] - half.orientation.cell[i]);
+        float error = (full.position - half.position).Length() + std::sqrt(turnError);
+
+        float factor = error > 0.0f ? control.safety * std::sqrt(control.tolerance / error) : control.maxGrow;
+        if (!(error <= control.tolerance) && h > control.dtMin) {
+            control.rejected++;
+            control.dt = std::max(h * std::max(factor, control.minShrink), control.dtMin);
+            if (control.rejected > control.maxSubsteps) break;
+            continue;
+        }
+        state = half;
+        control.pending -= h;
+        covered += h;
+        control.substeps++;
+        control.dt = std::min(std::max(h * std::min(factor, control.maxGrow), control.dtMin), control.dtMax);
+    }
+    if (control.substeps == control.maxSubsteps || control.rejected > control.maxSubsteps) control.pending = 0.0f;
+    return covered;
+}
+
+// Magnitude of the impulse along normal that reverses a contact point's approach speed v_rel
+// (scaled by restitution). The formula for impulse magnitude is:
+//   j = -(1 + restitution) * (v_rel) / (1/mA + 1/mB + n · ((I^-1 (rA x n)) x rA + (I^-1 (rB x n)) x rB))
+// with the world space inverse inertia tensors I^-1 (zero for a body that does not move).
+inline float ContactImpulse(float v_rel, const cy::Vec3f& normal,
+                            float invMassA, const cy::Matrix3f& invInertiaA, const cy::Vec3f& rA,
+                            float invMassB, const cy::Matrix3f& invInertiaB, const cy::Vec3f& rB) {
+    float denominator = invMassA + invMassB + AngularResponse(invInertiaA, rA, normal) + AngularResponse(invInertiaB, rB, normal);
+    return -(1.0f + restitution) * v_rel / denominator;
+}
+
+inline void SetContactVertices(ContactVertices& vertices, const std::vector<cy::Vec3f>& local) {
+    const size_t n = local.size();
+    vertices.localX.resize(n); vertices.localY.resize(n); vertices.localZ.resize(n);
+    vertices.x.resize(n); vertices.y.resize(n); vertices.z.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        vertices.localX[i] = local[i].x;
+        vertices.localY[i] = local[i].y;
+        vertices.localZ[i] = local[i].z;
+    }
+    vertices.valid = false;
+}
+
+// Transforms the contact vertices by the body's current position and orientation, unless they
+// already are. Returns true if they were recomputed.
+inline bool UpdateContactVertices(ContactVertices& vertices, const PhysicsState& state) {
+    if (vertices.valid && vertices.position == state.position && vertices.orientation == state.orientation) return false;
+    // the matrix (column major) in locals, so the stores below cannot alias it
+    const float r0 = state.orientation.cell[0], r1 = state.orientation.cell[1], r2 = state.orientation.cell[2];
+    const float r3 = state.orientation.cell[3], r4 = state.orientation.cell[4], r5 = state.orientation.cell[5];
+    const float r6 = state.orientation.cell[6], r7 = state.orientation.cell[7], r8 = state.orientation.cell[8];
+    const float px = state.position.x, py = state.position.y, pz = state.position.z;
+    const float* lx = vertices.localX.data();
+    const float* ly = vertices.localY.data();
+    const float* lz = vertices.localZ.data();
+    float* x = vertices.x.data();
+    float* y = vertices.y.data();
+    float* z = vertices.z.data();
+    const size_t n = vertices.Size();
+    float lowest = std::numeric_limits<float>::infinity();
+    #pragma omp simd reduction(min:lowest)
+    for (size_t i = 0; i < n; i++) {
+        x[i] = px + r0 * lx[i] + r3 * ly[i] + r6 * lz[i];
+        y[i] = py + r1 * lx[i] + r4 * ly[i] + r7 * lz[i];
+        z[i] = pz + r2 * lx[i] + r5 * ly[i] + r8 * lz[i];
+        lowest = y[i] < lowest ? y[i] : lowest;
+    }
+    vertices.lowest      = lowest;
+    vertices.position    = state.position;
+    vertices.orientation = state.orientation;
+    vertices.valid       = true;
+    return true;
+}
+
+// Process collisions for each contact vertex of the model
+// vertices: the model's contact vertices, as of UpdateContactVertices
+void ProcessFloorCollision(PhysicsState& state, const ContactVertices& vertices) {
     // For a horizontal floor at y = 0, the contact normal is upward.
     const cy::Vec3f normal(0.0f, 1.0f, 0.0f);
     const float floorHeight = minBounds[1];
+    if (vertices.lowest >= floorHeight) return;
+    const cy::Matrix3f invInertia = RigidBody::WorldInverseInertia(state.orientation, state.invInertia, state.mass);
 
     // Iterate over each vertex in the model
-    for (const auto& worldVertex : vertices) {
+    for (size_t i = 0; i < vertices.Size(); i++) {
         // Check if the vertex is penetrating the floor.
-        if (worldVertex.y < floorHeight) {
+        if (vertices.y[i] < floorHeight) {
+            cy::Vec3f worldVertex(vertices.x[i], vertices.y[i], vertices.z[i]);
+
             // Compute penetration depth.
             float penetration = floorHeight - worldVertex.y;
 
@@ -88,13 +252,8 @@ void ProcessFloorCollision(PhysicsState& state, const std::vector<cy::Vec3f>& ve
             // Only process if the vertex is moving into the floor.
             float v_rel = v_contact.Dot(normal);
             if (v_rel < 0.0f) {
-                // Compute the impulse magnitude.
-                // The formula for impulse magnitude is:
-                //   j = -(1 + restitution) * (v_rel) / (1/m + n · ((r x n) x r))
-                // With an identity inertia tensor, (I^-1 * (r x n)) simplifies to (r x n),
-                // so the denominator becomes: 1/m + |r x n|^2.
-                float denominator = (1.0f / state.mass) + (r.Cross(normal)).LengthSquared();
-                float j = -(1.0f + restitution) * v_rel / denominator;
+                // The floor does not move: zero inverse mass and lever arm.
+                float j = ContactImpulse(v_rel, normal, 1.0f / state.mass, invInertia, r, 0.0f, cy::Matrix3f(0.0f), cy::Vec3f(0.0f));
 
                 // The impulse vector is along the contact normal.
                 cy::Vec3f impulse = j * normal;
@@ -104,8 +263,7 @@ void ProcessFloorCollision(PhysicsState& state, const std::vector<cy::Vec3f>& ve
 
                 // Apply the impulse to the angular velocity.
                 // The change in angular velocity is given by: Δω = I⁻¹ * (r × impulse).
-                // With I⁻¹ assumed to be the identity, it's just r × impulse.
-                state.angularVelocity += r.Cross(impulse);
+                state.angularVelocity += invInertia * r.Cross(impulse);
 
                 // Optionally: Adjust the position to reduce interpenetration.
                 // This is a simple positional correction along the normal.
@@ -116,6 +274,30 @@ void ProcessFloorCollision(PhysicsState& state, const std::vector<cy::Vec3f>& ve
 }
 
 
+// Kinetic energy per unit mass; the angular part is ω · I ω with the body's inertia per unit mass.
+inline float KineticEnergy(const PhysicsState& state) {
+    cy::Vec3f w = state.orientation.TransposeMult(state.angularVelocity);
+    return 0.5f * (state.velocity.LengthSquared() + w.Dot(state.inertia * w));
+}
+
+// Counts calm frames after a step and puts the body to sleep once it has been calm long enough.
+inline void UpdateSleep(SleepState& sleep, PhysicsState& state) {
+    float energy = KineticEnergy(state);
+    sleep.calm = energy < sleep.energy ? sleep.calm + 1 : 0;
+    if (!sleep.asleep && sleep.calm >= sleep.frames) {
+        sleep.asleep = true;
+        state.velocity = cy::Vec3f(0.0f);
+        state.angularVelocity = cy::Vec3f(0.0f);
+    }
+}
+
+// Call for anything that should move a sleeping body: a mouse force, a contact, a moved boundary.
+inline void Wake(SleepState& sleep) {
+    sleep.asleep = false;
+    sleep.calm = 0;
+}
+
+
 void OnMouseClick(int mouseX, int mouseY, cy::Vec3f& externalTorque, PhysicsState & physicsState) {
     cy::Vec3f hitPoint = Util::screenToWorldSpaceXPlane(mouseX,mouseY,800,600);
 
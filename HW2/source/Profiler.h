@@ -0,0 +1,223 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Per-phase frame profiler. Enabled by defining PROFILER_ENABLED (cmake -DENABLE_PROFILER=ON);
+// otherwise every PROFILE_* macro compiles to nothing.
+//
+//   PROFILE_SCOPE("physics");  times the enclosing scope (the name must be a string literal)
+//   PROFILE_FRAME();           ends a frame; every summaryFrames frames appends p50/p95/p99
+//                              of each phase to summaryFile, plus the hardware counters
+//                              of phases that also have a PERF_SCOPE (see PerfCounters.h)
+//   PROFILE_SHUTDOWN();        writes what the ring buffers still hold as a Chrome trace
+//                              (open traceFile in chrome://tracing or ui.perfetto.dev)
+//
+// Each thread appends to its own ring buffer, so timing a scope is two clock reads and a store.
+// The rings are read without locking out their writers: summaries (PROFILE_FRAME) and the trace
+// (PROFILE_SHUTDOWN) must be taken on a thread while no other thread is inside a timed scope,
+// as between frames, when the OpenMP regions that time their phases have joined.
+// GL calls only measure submission; the driver may do the actual work later.
+
+#ifdef PROFILER_ENABLED
+
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "PerfCounters.h"
+
+namespace Profiler {
+
+inline std::string traceFile     = "profile_trace.json";
+inline std::string summaryFile   = "profile_summary.csv";
+inline uint64_t    summaryFrames = 300;
+
+struct Event {
+    const char* name;
+    int64_t     start;  // ns since the profiler started
+    int64_t     end;
+};
+
+// Per-thread ring of the most recent events. Only the owning thread writes it; written is stored
+// with release, so a reader that loads it with acquire sees the events before it (read only
+// while the owner is outside timed scopes, see above).
+struct Ring {
+    static const size_t CAPACITY = 1 << 16;
+    std::vector<Event>    events = std::vector<Event>(CAPACITY);
+    std::atomic<uint64_t> written{0};
+    uint64_t              summarized = 0;  // events already in a CSV summary
+    int                   tid = 0;
+
+    void Push(const Event& e) {
+        uint64_t w = written.load(std::memory_order_relaxed);
+        events[w & (CAPACITY - 1)] = e;
+        written.store(w + 1, std::memory_order_release);
+    }
+};
+
+struct PhaseSummary {
+    std::string name;
+    size_t      count = 0;
+    double      meanMs = 0, p50Ms = 0, p95Ms = 0, p99Ms = 0;
+};
+
+struct Registry {
+    std::mutex                          mutex;
+    std::vector<std::unique_ptr<Ring>>  rings;    // kept after their thread exits, for the trace
+    uint64_t                            frame = 0;
+    std::vector<PhaseSummary>           latest;   // last rolling summary
+    std::ofstream                       csv;
+};
+
+inline Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+inline int64_t Now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+inline Ring& ThreadRing() {
+    thread_local Ring* ring = [] {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.rings.push_back(std::make_unique<Ring>());
+        registry.rings.back()->tid = int(registry.rings.size()) - 1;
+        return registry.rings.back().get();
+    }();
+    return *ring;
+}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : name(name), start(Now()) {}
+    ~ScopedTimer() { ThreadRing().Push({ name, start, Now() }); }
+
+private:
+    const char* name;
+    int64_t     start;
+};
+
+// Oldest event of the ring that has not been overwritten yet.
+inline uint64_t FirstValid(uint64_t written) {
+    return written > Ring::CAPACITY ? written - Ring::CAPACITY : 0;
+}
+
+// Percentiles of every phase over the events recorded since the previous call.
+inline std::vector<PhaseSummary> Summarize(Registry& registry) {
+    std::map<std::string, std::vector<double>> durations;
+    for (auto &ring : registry.rings) {
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        for (uint64_t i = std::max(ring->summarized, FirstValid(written)); i < written; i++) {
+            const Event& e = ring->events[i & (Ring::CAPACITY - 1)];
+            durations[e.name].push_back((e.end - e.start) * 1e-6);
+        }
+        ring->summarized = written;
+    }
+
+    std::vector<PhaseSummary> summaries;
+    for (auto &entry : durations) {
+        auto &d = entry.second;
+        std::sort(d.begin(), d.end());
+        auto percentile = [&d](double p) { return d[std::min(d.size() - 1, size_t(p * d.size()))]; };
+        PhaseSummary s;
+        s.name  = entry.first;
+        s.count = d.size();
+        for (double v : d) s.meanMs += v;
+        s.meanMs /= d.size();
+        s.p50Ms = percentile(0.50);
+        s.p95Ms = percentile(0.95);
+        s.p99Ms = percentile(0.99);
+        summaries.push_back(s);
+    }
+    return summaries;
+}
+
+inline void WriteSummary(Registry& registry) {
+    registry.latest = Summarize(registry);
+    auto counters = PerfCounters::TakeTotals();
+    if (!registry.csv.is_open()) {
+        registry.csv.open(summaryFile);
+        registry.csv << "frame,phase,count,mean_ms,p50_ms,p95_ms,p99_ms";
+        for (int c = 0; c < PerfCounters::NUM_COUNTERS; c++) registry.csv << "," << PerfCounters::CounterName(c);
+        registry.csv << "\n";
+    }
+    for (auto &s : registry.latest) {
+        registry.csv << registry.frame << "," << s.name << "," << s.count << "," << s.meanMs << ","
+                     << s.p50Ms << "," << s.p95Ms << "," << s.p99Ms;
+        // hardware counters per call, empty when not measured
+        auto it = counters.find(s.name);
+        for (int c = 0; c < PerfCounters::NUM_COUNTERS; c++) {
+            registry.csv << ",";
+            if (it != counters.end() && it->second.values.valid[c]) registry.csv << it->second.values.count[c] / it->second.calls;
+        }
+        registry.csv << "\n";
+    }
+    registry.csv.flush();
+}
+
+inline void EndFrame() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (++registry.frame % summaryFrames == 0) WriteSummary(registry);
+}
+
+// The most recent rolling summary, e.g. for an on-screen display.
+inline std::vector<PhaseSummary> LatestSummary() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.latest;
+}
+
+inline void WriteChromeTrace(const std::string& fileName) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::ofstream out(fileName);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (auto &ring : registry.rings) {
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        for (uint64_t i = FirstValid(written); i < written; i++) {
+            const Event& e = ring->events[i & (Ring::CAPACITY - 1)];
+            out << (first ? "" : ",\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->tid
+                << ",\"ts\":" << e.start * 1e-3 << ",\"dur\":" << (e.end - e.start) * 1e-3 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+inline void Shutdown() {
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        WriteSummary(registry);
+        registry.csv.close();
+    }
+    WriteChromeTrace(traceFile);
+}
+
+} // namespace Profiler
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::ScopedTimer PROFILER_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FRAME()     Profiler::EndFrame()
+#define PROFILE_SHUTDOWN()  Profiler::Shutdown()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME()
+#define PROFILE_SHUTDOWN()
+
+#endif // PROFILER_ENABLED
+
+#endif // PROFILER_H
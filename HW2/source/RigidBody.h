@@ -0,0 +1,150 @@
+#ifndef RIGIDBODY_H
+#define RIGIDBODY_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "cyMatrix.h"
+
+// Orientation and mass distribution of a rigid body.
+// The orientation is a unit quaternion: a step multiplies in the rotation of the angular velocity
+// and renormalizes, which removes the drift of the product exactly (4 numbers), where a matrix
+// would need to be orthonormalized. The rotation matrix is derived from it after each step.
+// The inertia tensor comes from the volume integrals of a closed mesh (the convex hull), once per
+// shape, and the angular velocity is advanced through Euler's equations with an implicit
+// gyroscopic term, which keeps a free spinning body from gaining energy at large steps.
+namespace RigidBody {
+
+struct Quat {
+    float w = 1.0f, x = 0.0f, y = 0.0f, z = 0.0f;
+
+    // rotation by angle (radians) around the unit vector axis
+    static Quat AxisAngle(const cy::Vec3f& axis, float angle) {
+        float s = std::sin(0.5f * angle);
+        Quat q;
+        q.w = std::cos(0.5f * angle);
+        q.x = axis.x * s;
+        q.y = axis.y * s;
+        q.z = axis.z * s;
+        return q;
+    }
+
+    Quat operator*(const Quat& q) const {
+        Quat r;
+        r.w = w * q.w - x * q.x - y * q.y - z * q.z;
+        r.x = w * q.x + x * q.w + y * q.z - z * q.y;
+        r.y = w * q.y - x * q.z + y * q.w + z * q.x;
+        r.z = w * q.z + x * q.y - y * q.x + z * q.w;
+        return r;
+    }
+
+    void Normalize() {
+        float length = std::sqrt(w * w + x * x + y * y + z * z);
+        if (length <= 0.0f) { *this = Quat(); return; }
+        w /= length; x /= length; y /= length; z /= length;
+    }
+
+    cy::Matrix3f ToMatrix() const {
+        cy::Matrix3f m;
+        m.cell[0] = 1.0f - 2.0f * (y * y + z * z);
+        m.cell[1] = 2.0f * (x * y + w * z);
+        m.cell[2] = 2.0f * (x * z - w * y);
+        m.cell[3] = 2.0f * (x * y - w * z);
+        m.cell[4] = 1.0f - 2.0f * (x * x + z * z);
+        m.cell[5] = 2.0f * (y * z + w * x);
+        m.cell[6] = 2.0f * (x * z + w * y);
+        m.cell[7] = 2.0f * (y * z - w * x);
+        m.cell[8] = 1.0f - 2.0f * (x * x + y * y);
+        return m;
+    }
+};
+
+// Rotates q by the world space angular velocity over dt and renormalizes.
+inline void Integrate(Quat& q, const cy::Vec3f& angularVelocity, float dt) {
+    float angularSpeed = angularVelocity.Length();
+    if (angularSpeed <= 0.0f) return;
+    q = Quat::AxisAngle(angularVelocity / angularSpeed, angularSpeed * dt) * q;
+    q.Normalize();
+}
+
+// Mass properties of a solid of unit density, per unit mass.
+struct MassProperties {
+    float        volume = 0.0f;
+    cy::Vec3f    centerOfMass = cy::Vec3f(0.0f);
+    cy::Matrix3f inertia = cy::Matrix3f::Identity();   // about the center of mass, per unit mass
+};
+
+// Volume integrals of the closed triangle mesh (points, faces counter-clockwise from outside),
+// summed over the tetrahedra from a reference point to each face. The second moments
+// C = sum det / 120 (a a^T + b b^T + c c^T + (a + b + c)(a + b + c)^T) give the inertia
+// trace(C) E - C, moved to the center of mass. A flat or empty mesh gets the inertia of a solid
+// ball as large as the points.
+inline MassProperties ComputeMassProperties(const std::vector<cy::Vec3f>& points, const std::vector<unsigned int>& faces) {
+    MassProperties props;
+    if (points.empty()) return props;
+    const cy::Vec3f origin = points[0];   // keeps the determinants small
+    double volume = 0.0, first[3] = { 0.0, 0.0, 0.0 }, second[3][3] = {};
+    for (size_t f = 0; f + 2 < faces.size(); f += 3) {
+        cy::Vec3f a = points[faces[f]] - origin, b = points[faces[f + 1]] - origin, c = points[faces[f + 2]] - origin;
+        double det = a.Dot(b.Cross(c));
+        cy::Vec3f s = a + b + c;
+        volume += det / 6.0;
+        for (int i = 0; i < 3; i++) {
+            first[i] += det / 24.0 * s[i];
+            for (int j = 0; j < 3; j++) {
+                second[i][j] += det / 120.0 * (double(a[i]) * a[j] + double(b[i]) * b[j] + double(c[i]) * c[j] + double(s[i]) * s[j]);
+            }
+        }
+    }
+
+    float extent = 0.0f;
+    if (volume <= 0.0) {
+        cy::Vec3f center(0.0f);
+        for (auto &p : points) center += p;
+        props.centerOfMass = center / float(points.size());
+        for (auto &p : points) extent = std::max(extent, (p - props.centerOfMass).Length());
+        props.inertia = cy::Matrix3f::Identity() * (0.4f * extent * extent);
+        return props;
+    }
+    double com[3];
+    for (int i = 0; i < 3; i++) com[i] = first[i] / volume;
+    double trace = 0.0;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) second[i][j] = second[i][j] / volume - com[i] * com[j];   // per unit mass, about the center
+        trace += second[i][i];
+    }
+    props.volume = float(volume);
+    props.centerOfMass = origin + cy::Vec3f(float(com[0]), float(com[1]), float(com[2]));
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) props.inertia.cell[j * 3 + i] = float((i == j ? trace : 0.0) - second[i][j]);
+    }
+    return props;
+}
+
+// World space inverse inertia of a body of the given mass: R I^-1 R^T / mass, with I^-1 per unit mass in body space.
+inline cy::Matrix3f WorldInverseInertia(const cy::Matrix3f& orientation, const cy::Matrix3f& invInertia, float mass) {
+    return orientation * invInertia * orientation.GetTranspose() * (1.0f / mass);
+}
+
+// Advances the world space angular velocity by the gyroscopic term of Euler's equations,
+// I dw/dt = -w x (I w), over dt. The body space equation is solved with the implicit midpoint
+// rule, I (w1 - w0) + dt m x (I m) = 0 with m = (w0 + w1) / 2, by Newton steps with the Jacobian
+// I + dt / 2 (skew(m) I - skew(I m)). The rule keeps both the energy and |I w| of a free body,
+// so a tumbling body neither gains energy (as with explicit steps, which blow up) nor settles
+// onto its major axis (as with implicit Euler).
+inline cy::Vec3f GyroscopicStep(const cy::Vec3f& angularVelocity, const cy::Matrix3f& orientation, const cy::Matrix3f& inertia, float dt, int iterations = 2) {
+    const cy::Vec3f w0 = orientation.TransposeMult(angularVelocity);
+    cy::Vec3f w = w0;
+    for (int k = 0; k < iterations; k++) {
+        cy::Vec3f m = (w0 + w) * 0.5f;
+        cy::Vec3f Im = inertia * m;
+        cy::Vec3f g = inertia * (w - w0) + m.Cross(Im) * dt;
+        cy::Matrix3f J = inertia + (cy::Matrix3f::MatrixCrossProd(m) * inertia - cy::Matrix3f::MatrixCrossProd(Im)) * (0.5f * dt);
+        w -= J.GetInverse() * g;
+    }
+    return orientation * w;
+}
+
+} // namespace RigidBody
+
+#endif // RIGIDBODY_H
@@ -0,0 +1,81 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "cyMatrix.h"
+#include "cyTriMesh.h"
+
+// Model matrix of a drawn mesh: Translation(position) * orientation * Scale(scale) * Translation(-center).
+// The mesh part (bounds, center and the scale picked at load) is read once; the pose is set every
+// frame, but the matrix is only rebuilt when a setter actually changed something, so a body at rest
+// (or one that never moves) costs two compares per frame instead of a bounding box pass over the
+// mesh and three matrix products.
+namespace Transform {
+
+class ModelTransform {
+public:
+    // Takes the bounding box center of mesh; the bounds are computed here, once.
+    void SetMesh(cy::TriMesh& mesh, float meshScale) {
+        mesh.ComputeBoundingBox();
+        boundMin = mesh.GetBoundMin();
+        boundMax = mesh.GetBoundMax();
+        SetFrame((boundMin + boundMax) * 0.5f, meshScale);
+    }
+
+    // For meshes placed by another center (e.g. the centroid of a tetrahedral mesh).
+    void SetFrame(const cy::Vec3f& meshCenter, float meshScale) {
+        if (meshCenter == center && meshScale == scale) return;
+        center = meshCenter;
+        scale  = meshScale;
+        dirty  = true;
+    }
+
+    void SetPosition(const cy::Vec3f& p) {
+        if (p == position) return;
+        position = p;
+        dirty    = true;
+    }
+
+    void SetOrientation(const cy::Matrix3f& r) {
+        if (r == orientation) return;
+        orientation = r;
+        dirty       = true;
+    }
+
+    void SetPose(const cy::Vec3f& p, const cy::Matrix3f& r) {
+        SetPosition(p);
+        SetOrientation(r);
+    }
+
+    const cy::Vec3f& Center()   const { return center; }
+    const cy::Vec3f& BoundMin() const { return boundMin; }
+    const cy::Vec3f& BoundMax() const { return boundMax; }
+    float            Scale()    const { return scale; }
+
+    // body space point of a mesh vertex: centred and scaled like the model matrix
+    cy::Vec3f ToBody(const cy::Vec3f& meshPoint) const { return (meshPoint - center) * scale; }
+
+    const cy::Matrix4f& Matrix() {
+        if (dirty) {
+            // the product above, without forming it: the linear part is orientation * scale and
+            // the center is moved to the origin before the translation
+            cy::Matrix3f linear = orientation * scale;
+            model = cy::Matrix4f(linear, position - linear * center);
+            dirty = false;
+        }
+        return model;
+    }
+
+private:
+    cy::Vec3f    boundMin     = cy::Vec3f(0.0f);
+    cy::Vec3f    boundMax     = cy::Vec3f(0.0f);
+    cy::Vec3f    center       = cy::Vec3f(0.0f);
+    float        scale        = 1.0f;
+    cy::Vec3f    position     = cy::Vec3f(0.0f);
+    cy::Matrix3f orientation  = cy::Matrix3f::Identity();
+    cy::Matrix4f model        = cy::Matrix4f::Identity();
+    bool         dirty        = true;
+};
+
+} // namespace Transform
+
+#endif // TRANSFORM_H
@@ -0,0 +1,387 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "Physics.h"
+#include "Hull.h"
+#include "RigidBody.h"
+
+// Many rigid bodies in the box, stored per field (SoA) so the broadphase and integration loops
+// only touch what they use. Narrowphase is the vertex test of ProcessFloorCollision on the convex
+// hull, against the floor and, between two bodies, against the plane through the overlap of their
+// bounding spheres. A support query finds the deepest hull vertex, so a body clear of a plane
+// costs a short hill climb, and a walk from there visits only the vertices that cross it.
+// Bodies turn about their center of mass with the inertia tensor of their hull (RigidBody.h) and
+// use the walls and restitution of the single-body simulation and the thresholds of SleepState;
+// Coulomb friction lets piles come to rest.
+namespace World {
+
+// Convex hull of one mesh in body space: (V - center) * scale.
+struct Shape {
+    Hull::ConvexHull hull;
+    cy::Vec3f center;        // center of mass of the hull, mesh space; the body origin
+    float scale  = 1.0f;
+    float radius = 0.0f;     // bounding sphere around the centre
+    cy::Matrix3f inertia;    // body space, per unit mass
+    cy::Matrix3f invInertia;
+};
+
+// Scales the mesh so its bounding sphere has the given radius; hull is the mesh's convex hull,
+// whose volume gives the center of mass and the inertia (the meshes themselves need not be closed).
+inline Shape MakeShape(const cy::TriMesh& mesh, const Hull::ConvexHull& hull, float radius) {
+    Shape shape;
+    RigidBody::MassProperties props = RigidBody::ComputeMassProperties(hull.points, hull.faces);
+    shape.center = props.centerOfMass;
+    float extent = 0.0f;
+    for (unsigned int i = 0; i < mesh.NV(); i++) extent = std::max(extent, (mesh.V(i) - shape.center).Length());
+    shape.scale = extent > 0.0f ? radius / extent : 1.0f;
+    shape.radius = radius;
+    shape.inertia = props.inertia * (shape.scale * shape.scale);
+    shape.invInertia = shape.inertia.GetInverse();
+    shape.hull = hull;
+    for (auto &v : shape.hull.points) v = (v - shape.center) * shape.scale;
+    return shape;
+}
+
+// Sweep and prune on x over the bodies' bounding spheres. The sorted order is kept from step to
+// step and repaired with an insertion sort, which is close to linear because bodies move little
+// per step (new bodies enter at the end and sort into place).
+class SweepAndPrune {
+public:
+    std::vector<std::pair<int, int>> pairs;   // overlapping bounding spheres, from the last Update
+    size_t swaps = 0;                         // insertion sort moves of the last Update
+
+    void Update(const std::vector<cy::Vec3f>& position, const std::vector<float>& radius) {
+        const int n = int(position.size());
+        for (int i = int(order.size()); i < n; i++) order.push_back(i);
+        minX.resize(n);
+        for (int i = 0; i < n; i++) minX[i] = position[i].x - radius[i];
+
+        swaps = 0;
+        for (int k = 1; k < n; k++) {
+            int body = order[k];
+            int j = k;
+            while (j > 0 && minX[order[j - 1]] > minX[body]) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = body;
+            swaps += k - j;
+        }
+
+        pairs.clear();
+        for (int k = 0; k < n; k++) {
+            int a = order[k];
+            float maxX = position[a].x + radius[a];
+            for (int m = k + 1; m < n && minX[order[m]] <= maxX; m++) {
+                int b = order[m];
+                float reach = radius[a] + radius[b];
+                if ((position[a] - position[b]).LengthSquared() < reach * reach) pairs.emplace_back(a, b);
+            }
+        }
+    }
+
+private:
+    std::vector<int>   order;   // bodies by increasing minX
+    std::vector<float> minX;
+};
+
+class Bodies {
+public:
+    std::vector<Shape> shapes;
+
+    // per body
+    std::vector<int>          shape;
+    std::vector<float>        mass;
+    std::vector<float>        radius;
+    std::vector<cy::Vec3f>    position;
+    std::vector<cy::Vec3f>    velocity;
+    std::vector<RigidBody::Quat> rotation;
+    std::vector<cy::Matrix3f> orientation;      // of rotation
+    std::vector<cy::Vec3f>    angularVelocity;
+    std::vector<cy::Matrix3f> invInertia;       // world space, for the current orientation and mass
+    std::vector<int>          calm;       // calm steps in a row
+    std::vector<char>         asleep;
+    std::vector<unsigned int> support;    // last support vertex, where the next climb starts
+
+    float         friction = 0.4f;        // Coulomb coefficient of the contact impulses
+    float         restingSpeed = 0.5f;    // slower contacts do not bounce (gravity adds 0.16 per step at 60 Hz)
+    SleepState    sleepParams;            // energy and frames only
+    SweepAndPrune broadphase;
+    size_t        contacts = 0;           // contact impulses of the last step
+    std::vector<std::pair<int, int>> touching;   // pairs in contact in the last step, see BodyContact
+
+    size_t Size() const { return position.size(); }
+    size_t NumAwake() const { return size_t(std::count(asleep.begin(), asleep.end(), 0)); }
+
+    size_t Add(int shapeIndex, const cy::Vec3f& p, RigidBody::Quat q, float m) {
+        q.Normalize();
+        shape.push_back(shapeIndex);
+        mass.push_back(m);
+        radius.push_back(shapes[shapeIndex].radius);
+        position.push_back(p);
+        velocity.push_back(cy::Vec3f(0.0f));
+        rotation.push_back(q);
+        orientation.push_back(q.ToMatrix());
+        angularVelocity.push_back(cy::Vec3f(0.0f));
+        invInertia.push_back(RigidBody::WorldInverseInertia(orientation.back(), shapes[shapeIndex].invInertia, m));
+        calm.push_back(0);
+        asleep.push_back(0);
+        support.push_back(0);
+        return Size() - 1;
+    }
+
+    void Wake(int i) {
+        asleep[i] = 0;
+        calm[i] = 0;
+    }
+
+    // Wakes what the moving bodies touched in the last step, then contacts at the current state
+    // and an explicit step of the awake bodies under gravity.
+    void Step(float deltaTime) {
+        WakeTouching();
+        broadphase.Update(position, radius);
+        contacts = 0;
+        touching.clear();
+        for (auto &pair : broadphase.pairs) BodyContact(pair.first, pair.second);
+        for (size_t i = 0; i < Size(); i++) {
+            if (!asleep[i] && position[i].y - radius[i] < minBounds[1]) FloorContact(int(i));
+        }
+        Integrate(deltaTime);
+    }
+
+private:
+    std::vector<unsigned int> visited;    // scratch of Crossing: hull vertex -> last visit
+    unsigned int              visit = 0;
+    std::vector<unsigned int> queue;
+
+    // Extent of body i along the world direction d: the largest d . (x - position) over its hull.
+    float Extent(int i, const cy::Vec3f& d) {
+        const Hull::ConvexHull &hull = shapes[shape[i]].hull;
+        support[i] = hull.Support(orientation[i].TransposeMult(d), support[i]);
+        return (orientation[i] * hull.points[support[i]]).Dot(d);
+    }
+
+    // Calls crossing(x, depth) for the hull vertices x of body i (world space) with n . x < offset,
+    // depth = offset - n . x. Starts at the deepest vertex and walks the hull's edges outward
+    // while they stay below the plane.
+    template <typename Visit>
+    void Crossing(int i, const cy::Vec3f& n, float offset, Visit crossing) {
+        const Hull::ConvexHull &hull = shapes[shape[i]].hull;
+        float below = offset - n.Dot(position[i]);   // the plane, relative to the body
+        cy::Vec3f d = orientation[i].TransposeMult(n);
+        support[i] = hull.Support(-d, support[i]);
+        if (hull.points[support[i]].Dot(d) >= below) return;
+        if (hull.neighbours.empty()) {   // no edge graph, test them all
+            for (auto &v : hull.points) {
+                if (v.Dot(d) < below) crossing(position[i] + orientation[i] * v, below - v.Dot(d));
+            }
+            return;
+        }
+        if (visited.size() < hull.Size()) visited.assign(hull.Size(), 0);
+        if (++visit == 0) { std::fill(visited.begin(), visited.end(), 0); visit = 1; }
+        queue.assign(1, support[i]);
+        visited[support[i]] = visit;
+        for (size_t q = 0; q < queue.size(); q++) {
+            unsigned int v = queue[q];
+            crossing(position[i] + orientation[i] * hull.points[v], below - hull.points[v].Dot(d));
+            for (unsigned int k = hull.neighbourStart[v]; k < hull.neighbourStart[v + 1]; k++) {
+                unsigned int w = hull.neighbours[k];
+                if (visited[w] == visit || hull.points[w].Dot(d) >= below) continue;
+                visited[w] = visit;
+                queue.push_back(w);
+            }
+        }
+    }
+
+    // Impulse at the world point x along the normal n, which points from b into a, then friction
+    // against the sliding that remains. A sleeping body or b < 0 (the floor) does not move.
+    // Returns the approach speed, 0 if x is separating.
+    float Impulse(int a, int b, const cy::Vec3f& x, const cy::Vec3f& n) {
+        bool movesA = !asleep[a], movesB = b >= 0 && !asleep[b];
+        cy::Vec3f rA = movesA ? x - position[a] : cy::Vec3f(0.0f);
+        cy::Vec3f rB = movesB ? x - position[b] : cy::Vec3f(0.0f);
+        float invMassA = movesA ? 1.0f / mass[a] : 0.0f;
+        float invMassB = movesB ? 1.0f / mass[b] : 0.0f;
+        const cy::Matrix3f zero(0.0f);
+        const cy::Matrix3f& invInertiaA = movesA ? invInertia[a] : zero;
+        const cy::Matrix3f& invInertiaB = movesB ? invInertia[b] : zero;
+        float v_rel = RelativeVelocity(a, b, rA, rB).Dot(n);
+        if (v_rel >= 0.0f) return 0.0f;
+
+        float j = Physics::ContactImpulse(v_rel, n, invMassA, invInertiaA, rA, invMassB, invInertiaB, rB);
+        if (-v_rel < restingSpeed) j /= 1.0f + restitution;   // resting contact, no bounce
+        Apply(a, b, rA, rB, j * n);
+
+        cy::Vec3f v = RelativeVelocity(a, b, rA, rB);
+        cy::Vec3f slide = v - n * v.Dot(n);
+        float slideSpeed = slide.Length();
+        if (slideSpeed > 0.0f) {
+            cy::Vec3f t = slide / slideSpeed;
+            float denominator = invMassA + invMassB + Physics::AngularResponse(invInertiaA, rA, t) + Physics::AngularResponse(invInertiaB, rB, t);
+            Apply(a, b, rA, rB, t * -std::min(slideSpeed / denominator, friction * j));
+        }
+        contacts++;
+        return -v_rel;
+    }
+
+    // velocity of a's point at rA relative to b's point at rB; zero r for a body that does not move
+    cy::Vec3f RelativeVelocity(int a, int b, const cy::Vec3f& rA, const cy::Vec3f& rB) const {
+        cy::Vec3f v(0.0f);
+        if (!asleep[a]) v += velocity[a] + angularVelocity[a].Cross(rA);
+        if (b >= 0 && !asleep[b]) v -= velocity[b] + angularVelocity[b].Cross(rB);
+        return v;
+    }
+
+    // impulse on a at rA and its opposite on b at rB
+    void Apply(int a, int b, const cy::Vec3f& rA, const cy::Vec3f& rB, const cy::Vec3f& impulse) {
+        if (!asleep[a]) {
+            velocity[a] += impulse / mass[a];
+            angularVelocity[a] += invInertia[a] * rA.Cross(impulse);
+        }
+        if (b >= 0 && !asleep[b]) {
+            velocity[b] -= impulse / mass[b];
+            angularVelocity[b] -= invInertia[b] * rB.Cross(impulse);
+        }
+    }
+
+    // ProcessFloorCollision for one body, except that the penetrating vertices act as one contact
+    // at their centroid and the position is corrected once, by the deepest of them. Impulses vertex
+    // by vertex make a body lying on a flat side rock without end.
+    void FloorContact(int i) {
+        cy::Vec3f centroid(0.0f);
+        int count = 0;
+        float penetration = 0.0f;
+        Crossing(i, cy::Vec3f(0.0f, 1.0f, 0.0f), minBounds[1], [&](const cy::Vec3f& x, float depth) {
+            penetration = std::max(penetration, depth);
+            centroid += x;
+            count++;
+        });
+        if (count == 0) return;
+        if (Impulse(i, -1, centroid / float(count), cy::Vec3f(0.0f, 1.0f, 0.0f)) > 0.0f) position[i].y += penetration;
+    }
+
+    // Vertices of either body that cross the plane halfway through the overlap of the bounding
+    // spheres are handled like floor vertices, with the other body as the floor. The deepest
+    // crossings push the bodies apart, split by inverse mass. A sleeping body acts as static
+    // until an awake one hits it faster than the calm threshold allows. Pairs in contact are
+    // recorded for WakeTouching; two sleeping bodies are not tested and count as touching, since
+    // they came to rest with their bounding spheres overlapping.
+    void BodyContact(int a, int b) {
+        if (asleep[a] && asleep[b]) {
+            touching.emplace_back(a, b);
+            return;
+        }
+        cy::Vec3f d = position[a] - position[b];
+        float distance = d.Length();
+        if (distance <= 0.0f) return;
+        cy::Vec3f n = d / distance;
+        float overlap = radius[a] + radius[b] - distance;
+        float plane = n.Dot(position[b]) + radius[b] - 0.5f * overlap;
+
+        cy::Vec3f centroid(0.0f);
+        int count = 0;
+        float depthA = 0.0f, depthB = 0.0f;
+        Crossing(a, n, plane, [&](const cy::Vec3f& x, float depth) {
+            depthA = std::max(depthA, depth);
+            centroid += x;
+            count++;
+        });
+        Crossing(b, -n, -plane, [&](const cy::Vec3f& x, float depth) {
+            depthB = std::max(depthB, depth);
+            centroid += x;
+            count++;
+        });
+        if (count == 0) return;
+        touching.emplace_back(a, b);
+        float approach = Impulse(a, b, centroid / float(count), n);
+        if (approach <= 0.0f) return;
+
+        float invMassA = asleep[a] ? 0.0f : 1.0f / mass[a];
+        float invMassB = asleep[b] ? 0.0f : 1.0f / mass[b];
+        float push = depthA + depthB;
+        position[a] += n * (push * invMassA / (invMassA + invMassB));
+        position[b] -= n * (push * invMassB / (invMassA + invMassB));
+        if (approach * approach > 2.0f * sleepParams.energy) {
+            if (asleep[a]) Wake(a);
+            if (asleep[b]) Wake(b);
+        }
+    }
+
+    // A body that moved faster than the calm threshold in the last step or was woken since (its
+    // calm count is 0) wakes every sleeping body it touched in that step, and those wake what they
+    // touched in turn. Otherwise a body resting on one that was knocked away would stay frozen in
+    // the air, since only a hit wakes it. Sweeps the pairs until nothing changes, one sweep per
+    // level of a stack.
+    void WakeTouching() {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto &pair : touching) {
+                int a = pair.first, b = pair.second;
+                if (asleep[a] == asleep[b]) continue;
+                int moving = asleep[a] ? b : a, resting = asleep[a] ? a : b;
+                if (calm[moving] != 0) continue;
+                Wake(resting);
+                changed = true;
+            }
+        }
+    }
+
+    // PhysicsUpdate for every awake body, after the calm count of UpdateSleep.
+    void Integrate(float deltaTime) {
+        const cy::Vec3f gravity(0.0f, -9.8f, 0.0f);
+        for (size_t i = 0; i < Size(); i++) {
+            if (asleep[i]) continue;
+            // measured after the contacts, before gravity, so a resting body reads as still
+            const Shape& s = shapes[shape[i]];
+            cy::Vec3f w = orientation[i].TransposeMult(angularVelocity[i]);
+            float energy = 0.5f * (velocity[i].LengthSquared() + w.Dot(s.inertia * w));
+            calm[i] = energy < sleepParams.energy ? calm[i] + 1 : 0;
+            if (calm[i] >= sleepParams.frames) {
+                asleep[i] = 1;
+                velocity[i] = cy::Vec3f(0.0f);
+                angularVelocity[i] = cy::Vec3f(0.0f);
+                continue;
+            }
+
+            velocity[i] += gravity * deltaTime;
+            position[i] += velocity[i] * deltaTime;
+
+            if (angularVelocity[i].LengthSquared() > 0.0f) {
+                angularVelocity[i] = RigidBody::GyroscopicStep(angularVelocity[i], orientation[i], s.inertia, deltaTime);
+                RigidBody::Integrate(rotation[i], angularVelocity[i], deltaTime);
+                orientation[i] = rotation[i].ToMatrix();
+                invInertia[i] = RigidBody::WorldInverseInertia(orientation[i], s.invInertia, mass[i]);
+            }
+
+            // walls by the hull's extent, once the bounding sphere reaches them (the floor is
+            // left to the vertex contacts)
+            for (int c = 0; c < 3; c++) {
+                cy::Vec3f axis(0.0f);
+                axis[c] = 1.0f;
+                if (c != 1 && position[i][c] - radius[i] < minBounds[c]) {
+                    float lo = minBounds[c] + Extent(int(i), -axis);
+                    if (position[i][c] < lo) {
+                        position[i][c] = lo;
+                        velocity[i][c] = -velocity[i][c] * restitution;
+                    }
+                }
+                if (position[i][c] + radius[i] > maxBounds[c]) {
+                    float hi = maxBounds[c] - Extent(int(i), axis);
+                    if (position[i][c] > hi) {
+                        position[i][c] = hi;
+                        velocity[i][c] = -velocity[i][c] * restitution;
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace World
+
+#endif // WORLD_H
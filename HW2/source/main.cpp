@@ -6,9 +6,15 @@
 #include "cyGL.h"
 #include "Camera.h"
 #include "Physics.h"
+#include "Hull.h"
+#include "World.h"
+#include "Transform.h"
 #include "Models.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <chrono>
+#include <random>
 
 using namespace std;
 
@@ -22,12 +28,25 @@ cy::GLSLProgram prog;
 cy::GLSLProgram planeProg;
 bool leftButtonPressed = false;
 cy::TriMesh mesh;
+Transform::ModelTransform meshTransform;   // bounds and scale of mesh, model matrix
+Hull::ConvexHull hull;   // contact vertices of mesh
 cy::Vec3f lightPosLocalSpace = cy::Vec3f(15.0, -15.0, 15.0);
 
 // init physics variables
 PhysicsState physicsState;
+SleepState sleepState;
+// adaptive substeps instead of one step per frame (toggle with T)
+bool adaptiveStep = false;
+StepControl stepControl;
 cy::Vec3f externalTorque(0.0f,0.0f,0.0f);
-std::vector<cy::Vec3f> verticesWorldSpace;
+ContactVertices contactVertices;
+
+// teapots and dragons dropped into the box with B
+World::Bodies world;
+std::vector<GLuint> worldVAOs;               // per world shape
+std::vector<unsigned int> worldIndexCounts;
+std::vector<Transform::ModelTransform> worldTransforms;   // per body
+std::mt19937 dropRandom(1);
 
 // simulation/render time steps
 auto lastTime = std::chrono::high_resolution_clock::now();
@@ -42,23 +61,11 @@ float scaleFactor = 1.0f; // scale factor for obj model
 
 void display() {
     // set uniforms    
-     // Calculate the bounding box
-    mesh.ComputeBoundingBox();
-    cy::Vec3f center = (mesh.GetBoundMin() + mesh.GetBoundMax()) * 0.5f;
-    // Adjust the model transformation matrix to center the object (reverse matrix multiplication order)
-    cy::Matrix4f angularRotation = cy::Matrix4f(physicsState.orientation);
-    cy::Matrix4f model = cy::Matrix4f::Translation(physicsState.position) * 
-                         angularRotation *
-                         cy::Matrix4f::Scale(scaleFactor) *
-                         cy::Matrix4f::Translation(-center);
-
+    // model matrix, rebuilt only when the pose changed
+    meshTransform.SetPose(physicsState.position, physicsState.orientation);
+    cy::Matrix4f model = meshTransform.Matrix();
 
 
-    //update verticesWorldSpace
-    for (auto& vertex : verticesWorldSpace) {
-        vertex = cy::Vec3f(model * cy::Vec4f(vertex,1.0f));
-    }
-
 
     cy::Matrix4f view = camera.getLookAtMatrix();
     cy::Matrix4f proj = camera.getProjectionMatrix();
@@ -67,35 +74,128 @@ void display() {
     // Your rendering code goes here
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // Draw your graphics here
-    prog.Bind();
-    prog["lightPosLocalSpace"] = lightPosLocalSpace;
-    prog["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
-    prog["model"] = model;
-    prog["view"] = view;
-    prog["projection"] =  proj;
-    prog["normalTransform"] = (view*model).GetSubMatrix3();
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, mesh.NF() * 3, GL_UNSIGNED_INT, 0);
-
-    planeProg.Bind();
-    planeProg["lightPosLocalSpace"] = lightPosLocalSpace;
-    planeProg["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
-    model = cy::Matrix4f(1.0);
-    planeProg["model"] = model;
-    planeProg["view"] = view;
-    planeProg["projection"] =  proj;
-    planeProg["normalTransform"] = (view*model).GetSubMatrix3();
-    glBindVertexArray(planeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    {
+        PROFILE_SCOPE("uniforms");
+        prog.Bind();
+        prog["lightPosLocalSpace"] = lightPosLocalSpace;
+        prog["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
+        prog["model"] = model;
+        prog["view"] = view;
+        prog["projection"] =  proj;
+        prog["normalTransform"] = (view*model).GetSubMatrix3();
+    }
+    {
+        PROFILE_SCOPE("draw");
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, mesh.NF() * 3, GL_UNSIGNED_INT, 0);
+    }
+
+    {
+        PROFILE_SCOPE("world draw");
+        for (size_t i = 0; i < world.Size(); i++) {
+            worldTransforms[i].SetPose(world.position[i], world.orientation[i]);
+            const cy::Matrix4f& bodyModel = worldTransforms[i].Matrix();
+            prog["model"] = bodyModel;
+            prog["normalTransform"] = (view*bodyModel).GetSubMatrix3();
+            glBindVertexArray(worldVAOs[world.shape[i]]);
+            glDrawElements(GL_TRIANGLES, worldIndexCounts[world.shape[i]], GL_UNSIGNED_INT, 0);
+        }
+    }
+
+    {
+        PROFILE_SCOPE("plane");
+        planeProg.Bind();
+        planeProg["lightPosLocalSpace"] = lightPosLocalSpace;
+        planeProg["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
+        model = cy::Matrix4f(1.0);
+        planeProg["model"] = model;
+        planeProg["view"] = view;
+        planeProg["projection"] =  proj;
+        planeProg["normalTransform"] = (view*model).GetSubMatrix3();
+        glBindVertexArray(planeVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    {
+        PROFILE_SCOPE("swap");
+        glutSwapBuffers();
+    }
+    PROFILE_FRAME();
+}
+
+
+// Uploads positions, normals and faces of a mesh (with normals computed) into a new VAO.
+GLuint createMeshVAO(cy::TriMesh& m) {
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    GLuint normalVBO;
+    glGenBuffers(1, &normalVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, normalVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cy::Vec3f) * m.NV(), &m.VN(0), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(1); // Assuming attribute index 1 for normals
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+    GLuint VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cy::Vec3f) * m.NV(), &m.V(0), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-    glutSwapBuffers();
+    GLuint EBO;
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * m.NF() * 3, &m.F(0), GL_STATIC_DRAW);
+    return vao;
+}
+
+// Drops count bodies, alternately teapots and dragons, at random places in the upper half of the box.
+// The shapes are loaded on the first drop.
+void dropBodies(int count) {
+    if (world.shapes.empty()) {
+        cy::TriMesh meshes[2];
+        const char* files[2] = { "teapot.obj", "dragon.obj" };
+        for (int s = 0; s < 2; s++) {
+            if (!meshes[s].LoadFromFileObj(files[s])) {
+                cout << "Could not load " << files[s] << "." << endl;
+                return;
+            }
+            meshes[s].ComputeNormals();
+        }
+        for (int s = 0; s < 2; s++) {
+            world.shapes.push_back(World::MakeShape(meshes[s], Hull::LoadOrCompute(meshes[s], std::string(files[s]) + ".hull"), 2.5f));
+            worldVAOs.push_back(createMeshVAO(meshes[s]));
+            worldIndexCounts.push_back(meshes[s].NF() * 3);
+        }
+    }
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < count; i++) {
+        cy::Vec3f position(40.0f * unit(dropRandom), 15.0f + 8.0f * unit(dropRandom), 40.0f * unit(dropRandom));
+        cy::Vec3f axis(unit(dropRandom), unit(dropRandom), unit(dropRandom));
+        RigidBody::Quat rotation = RigidBody::Quat::AxisAngle(axis.GetNormalized(), 3.14f * unit(dropRandom));
+        int shape = int(world.Size() % world.shapes.size());
+        world.Add(shape, position, rotation, 1.0f);
+        worldTransforms.emplace_back();
+        worldTransforms.back().SetFrame(world.shapes[shape].center, world.shapes[shape].scale);
+    }
+    cout << "World: " << world.Size() << " bodies, " << world.NumAwake() << " awake, "
+         << world.broadphase.pairs.size() << " pairs." << endl;
 }
 
 
 void keyboard(unsigned char key, int x, int y) {
 
     if (key == 27) {  // Esc key
+        PROFILE_SHUTDOWN();
         glutLeaveMainLoop();
+    } else if (key == 't' || key == 'T') {
+        adaptiveStep = !adaptiveStep;
+        stepControl.pending = 0.0f;
+        cout << (adaptiveStep ? "Adaptive" : "Frame") << " time step." << endl;
+    } else if (key == 'b' || key == 'B') {
+        dropBodies(100);
     } else {
         camera.processKeyboard(key);
     }
@@ -125,6 +225,7 @@ void handleMouse(int button, int state, int x, int y) {
     // Check for left mouse button click
     if (button == GLUT_LEFT_BUTTON && state == GLUT_UP) {
         Physics::OnMouseClick(x,y,externalTorque,physicsState);
+        Physics::Wake(sleepState);
     }
 
     // Update last mouse position
@@ -152,10 +253,34 @@ void idle() {
     
     cy::Vec3f gravityForce = cy::Vec3f(0.0f, -9.8f * physicsState.mass, 0.0f);
 
-    Physics::ProcessFloorCollision(physicsState, verticesWorldSpace);
-    Physics::PhysicsUpdate(physicsState, gravityForce, externalTorque, deltaTime);
+    // a body at rest costs nothing until the mouse wakes it
+    if (!sleepState.asleep) {
+        {
+            PROFILE_SCOPE("transform");
+            Physics::UpdateContactVertices(contactVertices, physicsState);
+        }
+        {
+            PROFILE_SCOPE("collision");
+            PERF_SCOPE("collision");
+            Physics::ProcessFloorCollision(physicsState, contactVertices);
+        }
+        {
+            PROFILE_SCOPE("physics");
+            PERF_SCOPE("physics");
+            if (adaptiveStep) Physics::AdvanceAdaptive(physicsState, gravityForce, externalTorque, deltaTime, stepControl);
+            else Physics::PhysicsUpdate(physicsState, gravityForce, externalTorque, deltaTime);
+        }
+        Physics::UpdateSleep(sleepState, physicsState);
+    }
     externalTorque = cy::Vec3f(0.0f,0.0f,0.0f);
 
+    if (world.Size() > 0) {
+        PROFILE_SCOPE("world");
+        PERF_SCOPE("world");
+        // one step per frame, capped so a slow frame cannot tunnel through the pile
+        world.Step(std::min(deltaTime, 1.0f / 30.0f));
+    }
+
     lastTime = currentTime;
 
 
@@ -166,8 +291,7 @@ int main(int argc, char** argv) {
     // initial physics
     physicsState.mass = 1.0f;
     physicsState.position = cy::Vec3f(0.0, 0.0, 0.0); 
-    physicsState.orientation.SetIdentity();
-    physicsState.orientation.SetRotationZ(Util::degreesToRadians(35));
+    Physics::SetOrientation(physicsState, RigidBody::Quat::AxisAngle(cy::Vec3f(0.0f, 0.0f, 1.0f), Util::degreesToRadians(35)));
     physicsState.angularVelocity = cy::Vec3f(0.0f);
 
     // Initialize GLUT
@@ -206,32 +330,24 @@ int main(int argc, char** argv) {
     camera.setPerspectiveMatrix(65,800.0f/600.0f, 2.0f, 600.0f);
 
     // load model
-    int num_vertices = Models::loadModel(argc, argv, mesh, scaleFactor);
-    verticesWorldSpace.resize(num_vertices);
+    Models::loadModel(argc, argv, mesh, scaleFactor);
+    // cached next to the model file; without a file name there is nowhere to cache it
+    hull = argc > 1 ? Hull::LoadOrCompute(mesh, std::string(argv[1]) + ".hull") : Hull::Compute(mesh);
+
+    // the body turns about the center of mass of the hull, with its inertia (once, at load)
+    RigidBody::MassProperties massProperties = RigidBody::ComputeMassProperties(hull.points, hull.faces);
+    Physics::SetMassProperties(physicsState, massProperties, scaleFactor);
+    meshTransform.SetMesh(mesh, scaleFactor);
+    meshTransform.SetFrame(massProperties.centerOfMass, scaleFactor);
+
+    // contact vertices in body space, centred and scaled like the model matrix in display()
+    std::vector<cy::Vec3f> contactPoints;
+    for (auto& p : hull.points) contactPoints.push_back(meshTransform.ToBody(p));
+    Physics::SetContactVertices(contactVertices, contactPoints);
     
 
     // set up VAO and VBO and EBO and NBO
-    glGenVertexArrays(1, &VAO); 
-    glBindVertexArray(VAO);
-
-    GLuint normalVBO;
-    glGenBuffers(1, &normalVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, normalVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cy::Vec3f) * mesh.NV(), &mesh.VN(0), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(1); // Assuming attribute index 1 for normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-    GLuint VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cy::Vec3f)*num_vertices, &mesh.V(0), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-    GLuint EBO;
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * mesh.NF() * 3, &mesh.F(0), GL_STATIC_DRAW);
+    VAO = createMeshVAO(mesh);
 
     // set up plane
     glGenVertexArrays(1, &planeVAO); 
@@ -0,0 +1,49 @@
+#ifndef TESTSHAPES_H
+#define TESTSHAPES_H
+
+// Shared by the HW2 tests (one per feature, run by ctest): CHECK, which reports a failed
+// condition and lets the test go on, and small procedural meshes in place of the teapot and the
+// dragon, so the tests need no model files.
+
+#include <iostream>
+#include "cyTriMesh.h"
+#include "cyMatrix.h"
+
+namespace TestShapes {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition << std::endl; \
+            TestShapes::Failures()++; \
+        } \
+    } while (0)
+
+// The exit code of a test: 0 if every CHECK held.
+inline int Finish(const char* name) {
+    std::cout << name << ": " << (Failures() ? "FAILED" : "passed") << std::endl;
+    return Failures() ? 1 : 0;
+}
+
+// Box centred at the origin with half extents h, corners by bits (x, y, z) = (1, 2, 4), two
+// triangles per side, counter-clockwise from outside.
+inline void Box(cy::TriMesh& mesh, const cy::Vec3f& h) {
+    mesh.SetNumVertex(8);
+    for (int c = 0; c < 8; c++) mesh.V(c) = cy::Vec3f(c & 1 ? h.x : -h.x, c & 2 ? h.y : -h.y, c & 4 ? h.z : -h.z);
+    const unsigned int faces[12][3] = { {0, 2, 3}, {0, 3, 1}, {4, 5, 7}, {4, 7, 6}, {0, 1, 5}, {0, 5, 4},
+                                        {2, 6, 7}, {2, 7, 3}, {0, 4, 6}, {0, 6, 2}, {1, 3, 7}, {1, 7, 5} };
+    mesh.SetNumFaces(12);
+    for (int f = 0; f < 12; f++) {
+        for (int k = 0; k < 3; k++) mesh.F(f).v[k] = faces[f][k];
+    }
+    mesh.ComputeBoundingBox();
+}
+
+} // namespace TestShapes
+
+#endif // TESTSHAPES_H
@@ -0,0 +1,49 @@
+// Model transform (Transform.h): the mesh bounds and center are read once at SetMesh, the cached
+// matrix is Translation(position) * orientation * Scale(scale) * Translation(-center) after every
+// kind of pose change, and ToBody places mesh points like the matrix minus the pose.
+
+#include "TestShapes.h"
+#include "Transform.h"
+
+static float Distance(const cy::Matrix4f& a, const cy::Matrix4f& b) {
+    float distance = 0.0f;
+    for (int i = 0; i < 16; i++) distance = std::max(distance, std::abs(a.cell[i] - b.cell[i]));
+    return distance;
+}
+
+static cy::Matrix4f Expected(const cy::Vec3f& position, const cy::Matrix3f& orientation, float scale, const cy::Vec3f& center) {
+    return cy::Matrix4f::Translation(position) * cy::Matrix4f(orientation) * cy::Matrix4f::Scale(scale) * cy::Matrix4f::Translation(-center);
+}
+
+int main() {
+    cy::TriMesh mesh;
+    TestShapes::Box(mesh, cy::Vec3f(1.0f, 2.0f, 3.0f));
+    for (unsigned int i = 0; i < mesh.NV(); i++) mesh.V(i) += cy::Vec3f(5.0f, -1.0f, 2.0f);
+
+    Transform::ModelTransform transform;
+    transform.SetMesh(mesh, 0.5f);
+    CHECK(transform.BoundMin() == cy::Vec3f(4.0f, -3.0f, -1.0f) && transform.BoundMax() == cy::Vec3f(6.0f, 1.0f, 5.0f));
+    CHECK(transform.Center() == cy::Vec3f(5.0f, -1.0f, 2.0f) && transform.Scale() == 0.5f);
+    CHECK(Distance(transform.Matrix(), Expected(cy::Vec3f(0.0f), cy::Matrix3f::Identity(), 0.5f, transform.Center())) < 1e-6f);
+
+    // the mesh moving afterwards does not change the cached frame
+    for (unsigned int i = 0; i < mesh.NV(); i++) mesh.V(i) += cy::Vec3f(1.0f, 1.0f, 1.0f);
+    CHECK(transform.Center() == cy::Vec3f(5.0f, -1.0f, 2.0f));
+
+    cy::Matrix3f rotation;
+    rotation.SetRotation(cy::Vec3f(1.0f, 2.0f, 2.0f).GetNormalized(), 0.7f);
+    const cy::Vec3f position(3.0f, 4.0f, -2.0f);
+    transform.SetPosition(position);
+    CHECK(Distance(transform.Matrix(), Expected(position, cy::Matrix3f::Identity(), 0.5f, transform.Center())) < 1e-5f);
+    transform.SetOrientation(rotation);
+    CHECK(Distance(transform.Matrix(), Expected(position, rotation, 0.5f, transform.Center())) < 1e-5f);
+    transform.SetPose(position, rotation);   // unchanged
+    CHECK(Distance(transform.Matrix(), Expected(position, rotation, 0.5f, transform.Center())) < 1e-5f);
+    transform.SetFrame(cy::Vec3f(0.0f, 1.0f, 0.0f), 2.0f);
+    CHECK(Distance(transform.Matrix(), Expected(position, rotation, 2.0f, cy::Vec3f(0.0f, 1.0f, 0.0f))) < 1e-5f);
+
+    const cy::Vec3f point(1.0f, 2.0f, 3.0f);
+    cy::Vec3f world = cy::Vec3f(transform.Matrix() * cy::Vec4f(point, 1.0f));
+    CHECK((world - (position + rotation * transform.ToBody(point))).Length() < 1e-5f);
+    return TestShapes::Finish("bounds");
+}
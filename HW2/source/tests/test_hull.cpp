@@ -0,0 +1,81 @@
+// Convex hulls (Hull.h): the hull of a box with points inside it is the eight corners, the hull
+// of points on a sphere keeps every one of them and is a closed convex polytope with all points
+// behind its faces, Support finds the furthest hull vertex from any start, and the cache file
+// round-trips and is refused once the mesh has changed. An empty mesh hashes to the seed.
+
+#include <cstdio>
+#include "TestShapes.h"
+#include "Hull.h"
+
+// Every face has all mesh vertices behind it, every edge is shared by two faces (V - E + F = 2).
+static bool Convex(const cy::TriMesh& mesh, const Hull::ConvexHull& hull) {
+    bool convex = true;
+    for (size_t f = 0; f < hull.faces.size(); f += 3) {
+        cy::Vec3f a = hull.points[hull.faces[f]], b = hull.points[hull.faces[f + 1]], c = hull.points[hull.faces[f + 2]];
+        cy::Vec3f n = (b - a).Cross(c - a).GetNormalized();
+        for (unsigned int i = 0; i < mesh.NV(); i++) convex &= (mesh.V(i) - a).Dot(n) <= 1e-4f;
+    }
+    size_t edges = hull.neighbours.size() / 2;
+    return convex && hull.Size() + hull.faces.size() / 3 == edges + 2;
+}
+
+int main() {
+    unsigned state = 7;
+    auto random = [&state]() { state = state * 1664525u + 1013904223u; return float(state >> 8) / float(1 << 24); };
+
+    // a box and a cloud inside it
+    {
+        cy::TriMesh mesh;
+        TestShapes::Box(mesh, cy::Vec3f(1.0f, 2.0f, 3.0f));
+        const int inside = 200;
+        std::vector<cy::Vec3f> corners(&mesh.V(0), &mesh.V(0) + 8);
+        mesh.SetNumVertex(8 + inside);
+        for (int c = 0; c < 8; c++) mesh.V(c) = corners[c];
+        for (int i = 0; i < inside; i++) mesh.V(8 + i) = cy::Vec3f(random() * 1.8f - 0.9f, random() * 3.8f - 1.9f, random() * 5.8f - 2.9f);
+        Hull::ConvexHull hull = Hull::Compute(mesh);
+        CHECK(hull.Size() == 8);
+        bool cornersOnly = true;
+        for (unsigned int i : hull.indices) cornersOnly &= i < 8;
+        CHECK(cornersOnly);
+        CHECK(Convex(mesh, hull));
+    }
+
+    // points on a sphere, every one a hull vertex, plus some inside
+    cy::TriMesh sphere;
+    const int onSphere = 300, inside = 100;
+    sphere.SetNumVertex(onSphere + inside);
+    for (int i = 0; i < onSphere; i++) {
+        float z = 1.0f - 2.0f * (i + 0.5f) / onSphere, r = std::sqrt(1.0f - z * z), phi = 2.39996323f * i;
+        sphere.V(i) = cy::Vec3f(r * std::cos(phi), r * std::sin(phi), z) * 2.0f;
+    }
+    for (int i = 0; i < inside; i++) sphere.V(onSphere + i) = cy::Vec3f(random() - 0.5f, random() - 0.5f, random() - 0.5f);
+    Hull::ConvexHull hull = Hull::Compute(sphere);
+    CHECK(hull.Size() == size_t(onSphere));
+    CHECK(Convex(sphere, hull));
+
+    bool supported = true;
+    for (int k = 0; k < 500; k++) {
+        cy::Vec3f d(random() - 0.5f, random() - 0.5f, random() - 0.5f);
+        unsigned int best = 0;
+        for (unsigned int v = 1; v < hull.Size(); v++) if (hull.points[v].Dot(d) > hull.points[best].Dot(d)) best = v;
+        unsigned int start = (unsigned int)(random() * hull.Size()) % hull.Size();
+        supported &= hull.points[hull.Support(d)].Dot(d) >= hull.points[best].Dot(d) - 1e-6f;
+        supported &= hull.points[hull.Support(d, start)].Dot(d) >= hull.points[best].Dot(d) - 1e-6f;
+    }
+    CHECK(supported);
+
+    // the cache
+    const char* cacheFile = "test_hull.hull";
+    Hull::Save(cacheFile, sphere, hull);
+    Hull::ConvexHull loaded;
+    CHECK(Hull::Load(cacheFile, sphere, loaded));
+    CHECK(loaded.indices == hull.indices && loaded.faces == hull.faces && loaded.neighbours == hull.neighbours);
+    sphere.V(onSphere) += cy::Vec3f(0.01f, 0.0f, 0.0f);
+    CHECK(!Hull::Load(cacheFile, sphere, loaded));
+    std::remove(cacheFile);
+
+    // an empty mesh has nothing to hash
+    cy::TriMesh empty;
+    CHECK(Hull::MeshHash(empty) == 14695981039346656037ull);
+    return TestShapes::Finish("hull");
+}
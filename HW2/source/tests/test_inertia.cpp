@@ -0,0 +1,76 @@
+// Rigid body orientation and inertia (RigidBody.h): the volume integrals give a box its volume,
+// center and textbook inertia, a quaternion turned step by step stays a rotation and agrees with
+// one turn by the whole angle, and a free box tumbling about its intermediate axis keeps its
+// energy and angular momentum through the gyroscopic step.
+
+#include "TestShapes.h"
+#include "Physics.h"
+
+static float MaxDifference(const cy::Matrix3f& a, const cy::Matrix3f& b) {
+    float difference = 0.0f;
+    for (int i = 0; i < 9; i++) difference = std::max(difference, std::abs(a.cell[i] - b.cell[i]));
+    return difference;
+}
+
+int main() {
+    // a 2 x 4 x 6 box, off the origin
+    const float a = 1.0f, b = 2.0f, c = 3.0f;
+    cy::TriMesh box;
+    TestShapes::Box(box, cy::Vec3f(a, b, c));
+    std::vector<cy::Vec3f> points;
+    std::vector<unsigned int> faces;
+    for (unsigned int i = 0; i < box.NV(); i++) points.push_back(box.V(i) + cy::Vec3f(3.0f, -2.0f, 1.0f));
+    for (unsigned int f = 0; f < box.NF(); f++) faces.insert(faces.end(), { box.F(f).v[0], box.F(f).v[1], box.F(f).v[2] });
+    RigidBody::MassProperties props = RigidBody::ComputeMassProperties(points, faces);
+    cy::Matrix3f expected(0.0f);
+    expected.cell[0] = (b * b + c * c) / 3.0f;
+    expected.cell[4] = (a * a + c * c) / 3.0f;
+    expected.cell[8] = (a * a + b * b) / 3.0f;
+    CHECK(std::abs(props.volume - 8.0f * a * b * c) < 1e-3f);
+    CHECK((props.centerOfMass - cy::Vec3f(3.0f, -2.0f, 1.0f)).Length() < 1e-4f);
+    CHECK(MaxDifference(props.inertia, expected) < 1e-4f);
+
+    // many small turns against one large one
+    {
+        const cy::Vec3f axis = cy::Vec3f(1.0f, -2.0f, 0.5f).GetNormalized();
+        RigidBody::Quat q;
+        for (int i = 0; i < 1000; i++) RigidBody::Integrate(q, axis * 3.0f, 1e-3f);
+        cy::Matrix3f m = q.ToMatrix(), turn;
+        turn.SetRotation(axis, 3.0f);
+        CHECK(std::abs(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z - 1.0f) < 1e-5f);
+        CHECK(MaxDifference(m * m.GetTranspose(), cy::Matrix3f::Identity()) < 1e-5f);
+        CHECK(MaxDifference(m, turn) < 1e-3f);
+    }
+
+    // the world space inverse inertia undoes the world space inertia of a turned body
+    {
+        cy::Matrix3f r = RigidBody::Quat::AxisAngle(cy::Vec3f(0.0f, 0.6f, 0.8f), 1.1f).ToMatrix();
+        const float mass = 2.5f;
+        cy::Matrix3f inertia = r * props.inertia * r.GetTranspose() * mass;
+        CHECK(MaxDifference(RigidBody::WorldInverseInertia(r, props.inertia.GetInverse(), mass) * inertia, cy::Matrix3f::Identity()) < 1e-4f);
+    }
+
+    // a free body spun near its unstable middle axis flips over and over; energy and |L| stay put
+    {
+        PhysicsState body;
+        body.mass = 1.0f;
+        body.position = cy::Vec3f(0.0f);
+        body.velocity = cy::Vec3f(0.0f);
+        body.angularVelocity = cy::Vec3f(0.01f, 2.0f, 0.01f);
+        Physics::SetOrientation(body, RigidBody::Quat());
+        Physics::SetMassProperties(body, props, 1.0f);
+        auto momentum = [&]() { return (body.orientation * (body.inertia * body.orientation.TransposeMult(body.angularVelocity))).Length(); };
+        const float energy = Physics::KineticEnergy(body), angularMomentum = momentum();
+        float minY = 1.0f;
+        for (int i = 0; i < 6000; i++) {   // 200 s at 30 Hz
+            body.angularVelocity = RigidBody::GyroscopicStep(body.angularVelocity, body.orientation, body.inertia, 1.0f / 30.0f);
+            RigidBody::Integrate(body.rotation, body.angularVelocity, 1.0f / 30.0f);
+            body.orientation = body.rotation.ToMatrix();
+            minY = std::min(minY, body.orientation.cell[4]);   // body y axis, up at the start
+        }
+        CHECK(minY < 0.0f);   // it did flip
+        CHECK(std::abs(Physics::KineticEnergy(body) - energy) < 1e-2f * energy);
+        CHECK(std::abs(momentum() - angularMomentum) < 1e-2f * angularMomentum);
+    }
+    return TestShapes::Finish("inertia");
+}
@@ -0,0 +1,54 @@
+// Contact vertex transform (Physics.h): UpdateContactVertices places the hull points like the
+// rotation matrix does and finds the lowest, skips the work while the body has not moved, and
+// the floor test leaves a body alone while its lowest point is above the floor.
+
+#include "TestShapes.h"
+#include "Physics.h"
+
+int main() {
+    unsigned state = 11;
+    auto random = [&state]() { state = state * 1664525u + 1013904223u; return float(state >> 8) / float(1 << 24); };
+
+    std::vector<cy::Vec3f> local;
+    for (int i = 0; i < 37; i++) local.push_back(cy::Vec3f(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 4.0f);   // not a multiple of the vector width
+    ContactVertices vertices;
+    Physics::SetContactVertices(vertices, local);
+
+    PhysicsState body;
+    body.mass = 1.0f;
+    body.velocity = cy::Vec3f(0.0f);
+    body.angularVelocity = cy::Vec3f(0.0f);
+    bool placed = true, lowest = true, recomputed = true;
+    for (int k = 0; k < 20; k++) {
+        body.position = cy::Vec3f(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 20.0f;
+        body.orientation.SetRotation(cy::Vec3f(random() - 0.5f, random() - 0.5f, random() - 0.5f).GetNormalized(), random() * 6.0f);
+        recomputed &= Physics::UpdateContactVertices(vertices, body);
+        recomputed &= !Physics::UpdateContactVertices(vertices, body);
+        float expectedLowest = 1e30f;
+        for (size_t i = 0; i < local.size(); i++) {
+            cy::Vec3f expected = body.position + body.orientation * local[i];
+            placed &= (cy::Vec3f(vertices.x[i], vertices.y[i], vertices.z[i]) - expected).Length() < 1e-5f;
+            expectedLowest = std::min(expectedLowest, vertices.y[i]);
+        }
+        lowest &= vertices.lowest == expectedLowest;
+    }
+    CHECK(placed);
+    CHECK(lowest);
+    CHECK(recomputed);
+
+    // clear of the floor: nothing happens, even to a falling body
+    body.position = cy::Vec3f(0.0f, minBounds.y + 5.0f, 0.0f);
+    body.orientation.SetIdentity();
+    body.velocity = cy::Vec3f(0.0f, -3.0f, 0.0f);
+    Physics::UpdateContactVertices(vertices, body);
+    Physics::ProcessFloorCollision(body, vertices);
+    CHECK(body.velocity == cy::Vec3f(0.0f, -3.0f, 0.0f) && body.position.y == minBounds.y + 5.0f);
+
+    // through the floor: pushed back up and no longer approaching
+    body.position.y = minBounds.y + 1.0f;
+    Physics::UpdateContactVertices(vertices, body);
+    CHECK(vertices.lowest < minBounds.y);
+    Physics::ProcessFloorCollision(body, vertices);
+    CHECK(body.velocity.y > 0.0f && body.position.y > minBounds.y + 1.0f);
+    return TestShapes::Finish("transform");
+}
@@ -0,0 +1,91 @@
+// Rigid world (World.h): the sweep-and-prune pairs are exactly the overlapping bounding spheres
+// as the bodies move and new ones join, a dropped box comes to rest on the floor and falls
+// asleep, and two boxes dropped onto each other end up stacked rather than through each other;
+// a sleeping box wakes and falls when the one under it is knocked away.
+
+#include <set>
+#include "TestShapes.h"
+#include "Physics.h"
+#include "World.h"
+
+static std::set<std::pair<int,int>> Sorted(const std::vector<std::pair<int,int>>& pairs) {
+    std::set<std::pair<int,int>> sorted;
+    for (auto &p : pairs) sorted.insert({ std::min(p.first, p.second), std::max(p.first, p.second) });
+    return sorted;
+}
+
+int main() {
+    // broadphase against all pairs
+    {
+        unsigned state = 2024;
+        auto random = [&state]() { state = state * 1664525u + 1013904223u; return float(state >> 8) / float(1 << 24); };
+        std::vector<cy::Vec3f> position;
+        std::vector<float> radius;
+        World::SweepAndPrune broadphase;
+        bool same = true;
+        for (int round = 0; round < 20; round++) {
+            for (int i = 0; i < 10; i++) {
+                position.push_back(cy::Vec3f(random() * 40.0f, random() * 10.0f, random() * 10.0f));
+                radius.push_back(0.5f + random());
+            }
+            for (auto &p : position) p += cy::Vec3f(random() - 0.5f, random() - 0.5f, random() - 0.5f);
+            broadphase.Update(position, radius);
+            std::set<std::pair<int,int>> expected;
+            for (int a = 0; a < int(position.size()); a++) {
+                for (int b = a + 1; b < int(position.size()); b++) {
+                    float reach = radius[a] + radius[b];
+                    if ((position[a] - position[b]).LengthSquared() < reach * reach) expected.insert({ a, b });
+                }
+            }
+            same &= Sorted(broadphase.pairs) == expected && broadphase.pairs.size() == expected.size();
+        }
+        CHECK(same);
+    }
+
+    cy::TriMesh box;
+    TestShapes::Box(box, cy::Vec3f(1.0f, 1.0f, 1.0f));
+    const float radius = std::sqrt(3.0f);   // the box scaled 1:1
+    const float dt = 1.0f / 60.0f;
+
+    // one box onto the floor
+    {
+        World::Bodies world;
+        world.shapes.push_back(World::MakeShape(box, Hull::Compute(box), radius));
+        world.Add(0, cy::Vec3f(0.0f, minBounds.y + 6.0f, 0.0f), RigidBody::Quat(), 1.0f);
+        int steps = 0;
+        while (world.NumAwake() > 0 && steps < 1200) {
+            world.Step(dt);
+            steps++;
+        }
+        CHECK(world.NumAwake() == 0);
+        CHECK(std::abs(world.position[0].y - (minBounds.y + 1.0f)) < 0.1f);
+    }
+
+    // two boxes dropped one onto the other
+    {
+        World::Bodies world;
+        world.shapes.push_back(World::MakeShape(box, Hull::Compute(box), radius));
+        world.Add(0, cy::Vec3f(0.0f, minBounds.y + 1.5f, 0.0f), RigidBody::Quat(), 1.0f);
+        world.Add(0, cy::Vec3f(0.0f, minBounds.y + 5.0f, 0.0f), RigidBody::Quat(), 1.0f);
+        for (int i = 0; i < 1200; i++) world.Step(dt);
+        CHECK(std::abs(world.position[0].y - (minBounds.y + 1.0f)) < 0.1f);
+        CHECK(std::abs(world.position[1].y - world.position[0].y - 2.0f) < 0.1f);
+
+        // put to sleep as they are, then knock the bottom box away: the top one wakes and falls
+        for (int i = 0; i < 2; i++) {
+            world.asleep[i] = 1;
+            world.velocity[i] = world.angularVelocity[i] = cy::Vec3f(0.0f);
+        }
+        world.Step(dt);
+        world.Wake(0);
+        world.velocity[0] = cy::Vec3f(12.0f, 0.0f, 0.0f);
+        float lowest = world.position[1].y;
+        for (int i = 0; i < 60; i++) {
+            world.Step(dt);
+            lowest = std::min(lowest, world.position[1].y);
+        }
+        CHECK(!world.asleep[1]);
+        CHECK(lowest < minBounds.y + 1.1f);   // down on the floor, whatever it bounced to since
+    }
+    return TestShapes::Finish("world");
+}
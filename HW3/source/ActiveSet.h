@@ -0,0 +1,210 @@
+#ifndef ACTIVESET_H
+#define ACTIVESET_H
+
+#include <vector>
+#include <algorithm>
+#include "Physics.h"
+
+namespace Physics {
+
+// Active-set layout of the mass points and springs:
+//   mpoints [0, numFree)                 free points
+//   mpoints [numFree, end)               pinned points
+//   springs [0, freeFreeEnd)             both ends free
+//   springs [freeFreeEnd, freePinnedEnd) end a free, end b pinned
+//   springs [freePinnedEnd, end)         both ends pinned, never evaluated
+// Pinned-pinned springs stay parked at the back so they can come back when a pin is released.
+// Reordering moves points, so nodeAt maps each slot back to its original node for rendering.
+template <typename P>
+struct ActiveSetT {
+    size_t numFree       = 0;
+    size_t freeFreeEnd   = 0;
+    size_t freePinnedEnd = 0;
+    std::vector<int> nodeAt;                  // slot -> original node index
+    std::vector<int> slotOf;                  // original node index -> slot
+    std::vector<std::vector<int>> incident;   // slot -> springs touching it, built by SetPinned when missing
+
+    StepLayout Layout() const { return { numFree, freeFreeEnd, freePinnedEnd }; }
+};
+
+using ActiveSet = ActiveSetT<SimPrecision>;
+
+namespace ActiveSetDetail {
+
+    // 0: free-free, 1: free-pinned, 2: pinned-pinned
+    template <typename P>
+    inline int SpringGroup(const std::vector<MassPointT<P>> & mpoints, const SpringT<P> & s) {
+        return int(mpoints[s.a].fixed) + int(mpoints[s.b].fixed);
+    }
+
+    template <typename P>
+    inline void ReplaceIncident(ActiveSetT<P> & as, int slot, int from, int to) {
+        for (auto &si : as.incident[slot]) {
+            if (si == from) { si = to; return; }
+        }
+    }
+
+    template <typename P>
+    inline void SwapSprings(std::vector<SpringT<P>> & springs, ActiveSetT<P> & as, int x, int y) {
+        if (x == y) return;
+        for (int node : { springs[x].a, springs[x].b }) ReplaceIncident(as, node, x, -1);
+        for (int node : { springs[y].a, springs[y].b }) ReplaceIncident(as, node, y, x);
+        for (int node : { springs[x].a, springs[x].b }) ReplaceIncident(as, node, -1, y);
+        std::swap(springs[x], springs[y]);
+    }
+
+    template <typename P>
+    inline void BuildIncident(const std::vector<SpringT<P>> & springs, ActiveSetT<P> & as) {
+        as.incident.assign(as.nodeAt.size(), {});
+        for (int si = 0; si < int(springs.size()); si++) {
+            as.incident[springs[si].a].push_back(si);
+            as.incident[springs[si].b].push_back(si);
+        }
+    }
+
+    // Moves spring si into the group its end points now belong to, one boundary swap per group.
+    template <typename P>
+    inline void Regroup(std::vector<MassPointT<P>> & mpoints, std::vector<SpringT<P>> & springs, ActiveSetT<P> & as, int si) {
+        int target = SpringGroup(mpoints, springs[si]);
+        int group  = si < int(as.freeFreeEnd) ? 0 : (si < int(as.freePinnedEnd) ? 1 : 2);
+        while (group < target) {
+            int last = int(group == 0 ? as.freeFreeEnd : as.freePinnedEnd) - 1;
+            SwapSprings(springs, as, si, last);
+            si = last;
+            if (group == 0) as.freeFreeEnd--; else as.freePinnedEnd--;
+            group++;
+        }
+        while (group > target) {
+            int first = int(group == 2 ? as.freePinnedEnd : as.freeFreeEnd);
+            SwapSprings(springs, as, si, first);
+            si = first;
+            if (group == 2) as.freePinnedEnd++; else as.freeFreeEnd++;
+            group--;
+        }
+        // free-pinned springs keep their free end in a
+        auto &s = springs[si];
+        if (target == 1 && mpoints[s.a].fixed) std::swap(s.a, s.b);
+    }
+
+    // Exchanges the points in slots i and j and renames them in every touching spring.
+    template <typename P>
+    inline void SwapSlots(std::vector<MassPointT<P>> & mpoints, std::vector<SpringT<P>> & springs, ActiveSetT<P> & as, int i, int j) {
+        if (i == j) return;
+        std::vector<int> touched = as.incident[i];
+        touched.insert(touched.end(), as.incident[j].begin(), as.incident[j].end());
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        auto rename = [i, j](int &v) { v = v == i ? j : (v == j ? i : v); };
+        for (int si : touched) {
+            rename(springs[si].a);
+            rename(springs[si].b);
+        }
+        std::swap(mpoints[i], mpoints[j]);
+        std::swap(as.incident[i], as.incident[j]);
+        std::swap(as.nodeAt[i], as.nodeAt[j]);
+        as.slotOf[as.nodeAt[i]] = i;
+        as.slotOf[as.nodeAt[j]] = j;
+    }
+
+} // namespace ActiveSetDetail
+
+// Restores the layout after the fixed flags of any number of points changed in place: the points
+// and springs are partitioned again, stably, in one pass each. This costs O(points + springs)
+// however many points changed, where SetPinned costs a few swaps per spring of each point, so
+// it is the cheaper way to move more than about a hundred points at once.
+template <typename P>
+inline void RelayoutActiveSet(std::vector<MassPointT<P>> & mpoints, std::vector<SpringT<P>> & springs, ActiveSetT<P> & as) {
+    const int n = int(mpoints.size());
+
+    // free points first, keeping their relative order
+    std::vector<int> oldSlot(n);
+    for (int i = 0; i < n; i++) oldSlot[i] = i;
+    std::stable_partition(oldSlot.begin(), oldSlot.end(), [&](int i) { return !mpoints[i].fixed; });
+    std::vector<int> newSlot(n), nodeAt(n);
+    std::vector<MassPointT<P>> reordered(n);
+    for (int slot = 0; slot < n; slot++) {
+        newSlot[oldSlot[slot]] = slot;
+        nodeAt[slot] = as.nodeAt[oldSlot[slot]];
+        as.slotOf[nodeAt[slot]] = slot;
+        reordered[slot] = mpoints[oldSlot[slot]];
+    }
+    mpoints.swap(reordered);
+    as.nodeAt.swap(nodeAt);
+    as.numFree = std::count_if(mpoints.begin(), mpoints.end(), [](const MassPointT<P> &mp) { return !mp.fixed; });
+
+    for (auto &s : springs) {
+        s.a = newSlot[s.a];
+        s.b = newSlot[s.b];
+        if (mpoints[s.a].fixed && !mpoints[s.b].fixed) std::swap(s.a, s.b);
+    }
+    // springs by group, stably: counted, then placed
+    size_t count[3] = { 0, 0, 0 };
+    for (auto &s : springs) count[ActiveSetDetail::SpringGroup(mpoints, s)]++;
+    size_t next[3] = { 0, count[0], count[0] + count[1] };
+    std::vector<SpringT<P>> grouped(springs.size());
+    for (auto &s : springs) grouped[next[ActiveSetDetail::SpringGroup(mpoints, s)]++] = s;
+    springs.swap(grouped);
+    as.freeFreeEnd   = count[0];
+    as.freePinnedEnd = count[0] + count[1];
+
+    // every spring moved; only SetPinned needs the lists, so it rebuilds them when it next runs
+    as.incident.clear();
+}
+
+// Reorders mpoints and springs into the active-set layout from the current fixed flags.
+template <typename P>
+inline void BuildActiveSet(std::vector<MassPointT<P>> & mpoints, std::vector<SpringT<P>> & springs, ActiveSetT<P> & as) {
+    const int n = int(mpoints.size());
+    as.nodeAt.resize(n);
+    as.slotOf.resize(n);
+    for (int i = 0; i < n; i++) as.nodeAt[i] = as.slotOf[i] = i;
+    RelayoutActiveSet(mpoints, springs, as);
+}
+
+// Pins or releases one point (by original node index) and updates the layout incrementally:
+// the point swaps across the free/pinned boundary and only its own springs change group.
+template <typename P>
+inline void SetPinned(std::vector<MassPointT<P>> & mpoints, std::vector<SpringT<P>> & springs, ActiveSetT<P> & as, int node, bool pinned) {
+    int slot = as.slotOf[node];
+    if (mpoints[slot].fixed == pinned) return;
+    if (as.incident.size() != mpoints.size()) ActiveSetDetail::BuildIncident(springs, as);
+
+    if (pinned) {
+        int boundary = int(as.numFree) - 1;
+        ActiveSetDetail::SwapSlots(mpoints, springs, as, slot, boundary);
+        as.numFree--;
+        slot = boundary;
+    } else {
+        int boundary = int(as.numFree);
+        ActiveSetDetail::SwapSlots(mpoints, springs, as, slot, boundary);
+        as.numFree++;
+        slot = boundary;
+    }
+    mpoints[slot].fixed = pinned;
+    // a pinned point does not move, and a released one starts from rest; either way a stale
+    // velocity would only feed the damping of its springs
+    mpoints[slot].velocity = cy::Vec3<typename P::Storage>(0, 0, 0);
+
+    // regrouping swaps springs around, so track each spring by its other end point
+    std::vector<int> others;
+    for (int si : as.incident[slot]) others.push_back(springs[si].a == slot ? springs[si].b : springs[si].a);
+    for (int other : others) {
+        for (int si : as.incident[slot]) {
+            if (springs[si].a == other || springs[si].b == other) {
+                ActiveSetDetail::Regroup(mpoints, springs, as, si);
+                break;
+            }
+        }
+    }
+}
+
+// Runs an explicit step over the free points only; nothing pinned is visited.
+template <typename P>
+inline void PhysicsUpdate(std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs, const ActiveSetT<P> & as, StepFeatures features, const cy::Vec3f externalForce, float deltaTime) {
+    features.hasFixed = false;
+    PhysicsUpdate(mpoints, springs, as.Layout(), features, externalForce, deltaTime);
+}
+
+} // namespace Physics
+
+#endif // ACTIVESET_H
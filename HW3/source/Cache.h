@@ -0,0 +1,278 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Physics.h"
+
+// Simulation cache: a header followed by fixed-size frames, so frame i lives at
+// sizeof(FileHeader) + i * frameBytes and can be reached without reading anything else.
+// Each frame is the step time (double) followed by float3 positions and, optionally,
+// float3 velocities, in original node order.
+namespace Cache {
+
+struct FileHeader {
+    char     magic[4] = {'H', 'W', '3', 'C'};
+    uint32_t version  = 1;
+    uint32_t numNodes = 0;
+    uint32_t flags    = 0;  // bit 0: velocities are stored
+};
+
+const uint32_t FLAG_VELOCITIES = 1;
+
+inline size_t FrameBytes(uint32_t numNodes, uint32_t flags) {
+    return sizeof(double) + sizeof(float) * 3 * numNodes * ((flags & FLAG_VELOCITIES) ? 2 : 1);
+}
+
+// Hands buffers to a single background thread. Submit() never blocks on the consumer;
+// processed buffers come back through TakeSpare() so steady-state recording does not allocate.
+class AsyncQueue {
+public:
+    ~AsyncQueue() { Stop(); }
+
+    template <typename Fn>
+    void Start(Fn process) {
+        Stop();
+        stop = false;
+        worker = std::thread([this, process] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                ready.wait(lock, [this] { return stop || !pending.empty(); });
+                if (pending.empty()) break;     // stop requested and nothing left
+                std::vector<char> item = std::move(pending.front());
+                pending.pop_front();
+                lock.unlock();
+                process(item);
+                lock.lock();
+                spare.push_back(std::move(item));
+            }
+        });
+    }
+
+    void Submit(std::vector<char>&& item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(item));
+        }
+        ready.notify_one();
+    }
+
+    // a previously processed buffer, or an empty one if none is free yet
+    std::vector<char> TakeSpare() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (spare.empty()) return {};
+        std::vector<char> item = std::move(spare.back());
+        spare.pop_back();
+        return item;
+    }
+
+    // processes everything still pending, then joins the thread
+    void Stop() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        ready.notify_one();
+        worker.join();
+    }
+
+private:
+    std::deque<std::vector<char>> pending;
+    std::vector<std::vector<char>> spare;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool stop = false;
+};
+
+// Read-only memory mapping of a whole file.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t      size = 0;
+
+    ~MappedFile() { Close(); }
+
+    bool Open(const std::string& fileName) {
+        Close();
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Cannot open cache file " << fileName << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            std::cerr << "Invalid cache file " << fileName << std::endl;
+            return false;
+        }
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Cannot map cache file " << fileName << std::endl;
+            return false;
+        }
+        data = static_cast<const char*>(mapped);
+        size = st.st_size;
+        return true;
+    }
+
+    void Close() {
+        if (data) munmap(const_cast<char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+};
+
+// Copies float3 positions (and optionally velocities) of mpoints into dst in original node order.
+// nodeAt maps each slot of mpoints to its original node (identity if empty).
+template <typename P>
+inline void GatherFrame(const std::vector<MassPointT<P>>& mpoints, const std::vector<int>& nodeAt, float* positions, float* velocities) {
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        size_t node = nodeAt.empty() ? i : size_t(nodeAt[i]);
+        const auto &mp = mpoints[i];
+        positions[3*node] = float(mp.position.x); positions[3*node+1] = float(mp.position.y); positions[3*node+2] = float(mp.position.z);
+        if (velocities) {
+            velocities[3*node] = float(mp.velocity.x); velocities[3*node+1] = float(mp.velocity.y); velocities[3*node+2] = float(mp.velocity.z);
+        }
+    }
+}
+
+// Streams frames to disk. Push() only copies into the current chunk; full chunks are handed to
+// a background thread that does the writing, so the simulation never waits on I/O.
+class Writer {
+public:
+    ~Writer() { Close(); }
+
+    bool Open(const std::string& fileName, uint32_t nodes, bool withVelocities, size_t chunkFrames = 32) {
+        Close();
+        file = std::fopen(fileName.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Cannot open cache file " << fileName << std::endl;
+            return false;
+        }
+        header.numNodes = nodes;
+        header.flags    = withVelocities ? FLAG_VELOCITIES : 0;
+        std::fwrite(&header, sizeof(header), 1, file);
+        frameBytes = FrameBytes(header.numNodes, header.flags);
+        chunkBytes = frameBytes * chunkFrames;
+        current.clear();
+        current.reserve(chunkBytes);
+        framesWritten = 0;
+        queue.Start([this](const std::vector<char>& chunk) { std::fwrite(chunk.data(), 1, chunk.size(), file); });
+        return true;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+    size_t FramesWritten() const { return framesWritten; }
+
+    // Appends one frame. nodeAt maps each slot of mpoints to its original node (identity if empty).
+    template <typename P>
+    void Push(double time, const std::vector<MassPointT<P>>& mpoints, const std::vector<int>& nodeAt) {
+        if (!file) return;
+        size_t offset = current.size();
+        current.resize(offset + frameBytes);
+        char* frame = current.data() + offset;
+        std::memcpy(frame, &time, sizeof(double));
+        float* positions = reinterpret_cast<float*>(frame + sizeof(double));
+        GatherFrame(mpoints, nodeAt, positions, (header.flags & FLAG_VELOCITIES) ? positions + 3 * header.numNodes : nullptr);
+        framesWritten++;
+        if (current.size() >= chunkBytes) Flush();
+    }
+
+    // Hands the remaining frames to the writer thread, waits for it and closes the file.
+    void Close() {
+        if (!file) return;
+        Flush();
+        queue.Stop();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    FileHeader header;
+    std::FILE* file = nullptr;
+    size_t frameBytes = 0;
+    size_t chunkBytes = 0;
+    size_t framesWritten = 0;
+    std::vector<char> current;  // chunk being filled by the simulation thread
+    AsyncQueue queue;
+
+    void Flush() {
+        if (current.empty()) return;
+        queue.Submit(std::move(current));
+        current = queue.TakeSpare();
+        current.clear();
+        current.reserve(chunkBytes);
+    }
+};
+
+// Memory-maps a cache for playback. Any frame is a pointer into the mapping, so jumping
+// around the cache costs nothing beyond the page faults of the frame being shown.
+class Player {
+public:
+    bool Open(const std::string& fileName) {
+        Close();
+        if (!file.Open(fileName)) return false;
+        if (file.size < sizeof(FileHeader)) {
+            std::cerr << "Invalid cache file " << fileName << std::endl;
+            Close();
+            return false;
+        }
+        std::memcpy(&header, file.data, sizeof(header));
+        if (std::memcmp(header.magic, "HW3C", 4) != 0 || header.version != 1) {
+            std::cerr << "Unsupported cache file " << fileName << std::endl;
+            Close();
+            return false;
+        }
+        frameBytes = FrameBytes(header.numNodes, header.flags);
+        // derive the frame count from the size, so a cache cut short by a crash still plays
+        numFrames = (file.size - sizeof(FileHeader)) / frameBytes;
+        return true;
+    }
+
+    void Close() {
+        file.Close();
+        numFrames = 0;
+    }
+
+    bool     IsOpen() const        { return file.data != nullptr; }
+    size_t   NumFrames() const     { return numFrames; }
+    uint32_t NumNodes() const      { return header.numNodes; }
+    bool     HasVelocities() const { return header.flags & FLAG_VELOCITIES; }
+
+    double Time(size_t frame) const {
+        double t;
+        std::memcpy(&t, Frame(frame), sizeof(double));
+        return t;
+    }
+    const float* Positions(size_t frame) const {
+        return reinterpret_cast<const float*>(Frame(frame) + sizeof(double));
+    }
+    const float* Velocities(size_t frame) const {
+        return HasVelocities() ? Positions(frame) + 3 * header.numNodes : nullptr;
+    }
+
+private:
+    FileHeader header;
+    MappedFile file;
+    size_t     frameBytes = 0;
+    size_t     numFrames = 0;
+
+    const char* Frame(size_t frame) const { return file.data + sizeof(FileHeader) + frame * frameBytes; }
+};
+
+} // namespace Cache
+
+#endif // CACHE_H
@@ -0,0 +1,375 @@
+#ifndef CACHECODEC_H
+#define CACHECODEC_H
+
+#include <cmath>
+#include "Cache.h"
+
+// Compressed simulation cache. Positions are quantized on a uniform grid centered on the mesh
+// bounding box, predicted from earlier frames, and the integer residuals are Rice coded.
+// Prediction works on the quantized values, so errors never accumulate: every decoded
+// coordinate is within errorBound of the original.
+//
+// File layout: QuantizedHeader, one record per frame (FrameRecord + payload), then an index
+// footer of uint64 record offsets, the uint64 frame count and "HW3I". Keyframes every
+// keyInterval frames only predict within the frame, so any frame decodes from the keyframe before it.
+namespace Cache {
+
+enum class Predictor : uint32_t { Previous = 0, Linear = 1 };
+
+struct CodecSettings {
+    float     errorBound  = 1e-3f;  // max |decoded - original| per coordinate, in world units
+    uint32_t  keyInterval = 64;
+    Predictor predictor   = Predictor::Linear;
+};
+
+struct QuantizedHeader {
+    char     magic[4]    = {'H', 'W', '3', 'Q'};
+    uint32_t version     = 1;
+    uint32_t numNodes    = 0;
+    uint32_t keyInterval = 64;
+    uint32_t predictor   = 0;
+    float    origin[3]   = {0, 0, 0};
+    float    step        = 0;   // grid spacing, 2 * errorBound
+};
+
+struct FrameRecord {
+    double   time;
+    uint32_t payloadBytes;
+    uint8_t  riceK[3];          // Rice parameter of the x, y and z residual streams
+    uint8_t  pad;
+};
+
+namespace CodecDetail {
+
+    const int RICE_ESCAPE = 24; // quotients this large are stored as raw 32-bit values
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<char>& out) : out(out) {}
+
+        // bits <= 32, value must fit in bits
+        void Put(uint32_t value, int bits) {
+            acc |= uint64_t(value) << count;
+            count += bits;
+            while (count >= 8) {
+                out.push_back(char(acc & 0xff));
+                acc >>= 8;
+                count -= 8;
+            }
+        }
+
+        void PutRice(uint32_t u, int k) {
+            uint32_t q = u >> k;
+            if (q < uint32_t(RICE_ESCAPE)) {
+                Put((1u << q) - 1, q);  // q ones
+                Put(0, 1);
+                if (k > 0) Put(u & ((1u << k) - 1), k);
+            } else {
+                Put((1u << RICE_ESCAPE) - 1, RICE_ESCAPE);
+                Put(u, 32);
+            }
+        }
+
+        void Finish() {
+            if (count > 0) out.push_back(char(acc & 0xff));
+            acc = 0;
+            count = 0;
+        }
+
+    private:
+        std::vector<char>& out;
+        uint64_t acc = 0;
+        int count = 0;
+    };
+
+    class BitReader {
+    public:
+        BitReader(const char* data, size_t size) : p(reinterpret_cast<const uint8_t*>(data)), end(p + size) {}
+
+        uint32_t Get(int bits) {
+            if (count < bits) Refill();
+            uint32_t v = uint32_t(acc & ((uint64_t(1) << bits) - 1));
+            acc >>= bits;
+            count -= bits;
+            return v;
+        }
+
+        uint32_t GetRice(int k) {
+            if (count < RICE_ESCAPE + 1) Refill();
+            uint64_t zeros = ~acc;
+            int q = zeros ? __builtin_ctzll(zeros) : 64;
+            if (q >= RICE_ESCAPE) {
+                acc >>= RICE_ESCAPE;
+                count -= RICE_ESCAPE;
+                return Get(32);
+            }
+            acc >>= q + 1;
+            count -= q + 1;
+            return (uint32_t(q) << k) | (k > 0 ? Get(k) : 0);
+        }
+
+    private:
+        const uint8_t* p;
+        const uint8_t* end;
+        uint64_t acc = 0;
+        int count = 0;
+
+        void Refill() {
+            while (count <= 56) {
+                acc |= uint64_t(p < end ? *p++ : 0) << count;
+                count += 8;
+            }
+        }
+    };
+
+    inline uint32_t ZigZag(int32_t v)    { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+    inline int32_t  UnZigZag(uint32_t u) { return int32_t(u >> 1) ^ -int32_t(u & 1); }
+
+    // Rice parameter close to optimal for a geometric distribution with the given mean
+    inline int ChooseRiceK(const uint32_t* values, size_t n) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++) sum += values[i];
+        uint64_t mean = n ? sum / n : 0;
+        int k = 0;
+        while (k < 30 && (uint64_t(1) << (k + 1)) <= mean) k++;
+        return k;
+    }
+
+    // Predicted value of coordinate i of one component stream (prev/prev2 are the last two frames)
+    inline int32_t Predict(const int32_t* cur, const int32_t* prev, const int32_t* prev2, size_t i, uint32_t age, Predictor predictor) {
+        if (age == 0) return i > 0 ? cur[i-1] : 0;          // keyframe: previous node of the same frame
+        if (age == 1 || predictor == Predictor::Previous) return prev[i];
+        return 2 * prev[i] - prev2[i];                      // constant velocity
+    }
+
+} // namespace CodecDetail
+
+// Quantizes, predicts and entropy codes frames on a background thread while the simulation runs.
+class QuantizedWriter {
+public:
+    ~QuantizedWriter() { Close(); }
+
+    bool Open(const std::string& fileName, uint32_t nodes, const cy::Vec3f& boundMin, const cy::Vec3f& boundMax, const CodecSettings& settings = CodecSettings()) {
+        Close();
+        file = std::fopen(fileName.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Cannot open cache file " << fileName << std::endl;
+            return false;
+        }
+        header.numNodes    = nodes;
+        header.keyInterval = std::max(1u, settings.keyInterval);
+        header.predictor   = uint32_t(settings.predictor);
+        header.step        = 2.0f * settings.errorBound;
+        cy::Vec3f center   = 0.5f * (boundMin + boundMax);
+        header.origin[0] = center.x; header.origin[1] = center.y; header.origin[2] = center.z;
+        float extent = (boundMax - boundMin).Max();
+        if (extent / header.step > float(1 << 30)) {
+            std::cerr << "Cache error bound is too small for the mesh size" << std::endl;
+        }
+        std::fwrite(&header, sizeof(header), 1, file);
+
+        offset = sizeof(header);
+        offsets.clear();
+        framesWritten = 0;
+        quantized.assign(3 * nodes, 0);
+        prev.assign(3 * nodes, 0);
+        prev2.assign(3 * nodes, 0);
+        residuals.resize(3 * nodes);
+        queue.Start([this](const std::vector<char>& frame) { Encode(frame); });
+        return true;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+    size_t FramesWritten() const { return framesWritten; }
+
+    // Copies one frame and hands it to the encoder thread.
+    template <typename P>
+    void Push(double time, const std::vector<MassPointT<P>>& mpoints, const std::vector<int>& nodeAt) {
+        if (!file) return;
+        std::vector<char> frame = queue.TakeSpare();
+        frame.resize(sizeof(double) + sizeof(float) * 3 * header.numNodes);
+        std::memcpy(frame.data(), &time, sizeof(double));
+        GatherFrame(mpoints, nodeAt, reinterpret_cast<float*>(frame.data() + sizeof(double)), nullptr);
+        queue.Submit(std::move(frame));
+        framesWritten++;
+    }
+
+    // Encodes whatever is still queued, writes the index and closes the file.
+    void Close() {
+        if (!file) return;
+        queue.Stop();
+        uint64_t count = offsets.size();
+        std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file);
+        std::fwrite(&count, sizeof(count), 1, file);
+        std::fwrite("HW3I", 1, 4, file);
+        std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    QuantizedHeader header;
+    std::FILE* file = nullptr;
+    size_t framesWritten = 0;
+    AsyncQueue queue;
+
+    // encoder thread state
+    uint64_t offset = 0;
+    std::vector<uint64_t> offsets;
+    std::vector<int32_t>  quantized, prev, prev2;   // component-major: all x, then all y, then all z
+    std::vector<uint32_t> residuals;
+    std::vector<char>     payload;
+
+    void Encode(const std::vector<char>& frame) {
+        using namespace CodecDetail;
+        const size_t n = header.numNodes;
+        const float* positions = reinterpret_cast<const float*>(frame.data() + sizeof(double));
+        const double invStep = 1.0 / header.step;
+        const uint32_t age = uint32_t(offsets.size() % header.keyInterval);
+
+        FrameRecord record;
+        std::memcpy(&record.time, frame.data(), sizeof(double));
+        record.pad = 0;
+        payload.clear();
+        BitWriter bits(payload);
+        for (int c = 0; c < 3; c++) {
+            int32_t* q = &quantized[c * n];
+            uint32_t* r = &residuals[c * n];
+            for (size_t i = 0; i < n; i++) q[i] = int32_t(std::lround((double(positions[3*i + c]) - header.origin[c]) * invStep));
+            for (size_t i = 0; i < n; i++) r[i] = ZigZag(q[i] - Predict(q, &prev[c * n], &prev2[c * n], i, age, Predictor(header.predictor)));
+            int k = ChooseRiceK(r, n);
+            record.riceK[c] = uint8_t(k);
+            for (size_t i = 0; i < n; i++) bits.PutRice(r[i], k);
+        }
+        bits.Finish();
+        record.payloadBytes = uint32_t(payload.size());
+
+        std::fwrite(&record, sizeof(record), 1, file);
+        std::fwrite(payload.data(), 1, payload.size(), file);
+        offsets.push_back(offset);
+        offset += sizeof(record) + payload.size();
+        prev2.swap(prev);
+        prev.swap(quantized);
+    }
+};
+
+// Decodes a compressed cache. Consecutive frames decode incrementally; a jump decodes
+// forward from the keyframe before the target, at most keyInterval frames.
+class QuantizedPlayer {
+public:
+    bool Open(const std::string& fileName) {
+        Close();
+        if (!file.Open(fileName)) return false;
+        if (file.size < sizeof(QuantizedHeader)) {
+            std::cerr << "Invalid cache file " << fileName << std::endl;
+            Close();
+            return false;
+        }
+        std::memcpy(&header, file.data, sizeof(header));
+        if (std::memcmp(header.magic, "HW3Q", 4) != 0 || header.version != 1 || header.keyInterval == 0) {
+            std::cerr << "Unsupported cache file " << fileName << std::endl;
+            Close();
+            return false;
+        }
+
+        // read the index, or rebuild it from the records if the writer never closed the file or
+        // the footer does not describe records that fit in front of it
+        bool indexed = false;
+        const char* tail = file.data + file.size;
+        if (file.size >= sizeof(header) + 12 && std::memcmp(tail - 4, "HW3I", 4) == 0) {
+            uint64_t count = 0;
+            std::memcpy(&count, tail - 12, sizeof(count));
+            if (count <= (file.size - sizeof(header) - 12) / sizeof(uint64_t)) {
+                const uint64_t recordsEnd = file.size - 12 - count * sizeof(uint64_t);
+                offsets.resize(count);
+                std::memcpy(offsets.data(), file.data + recordsEnd, count * sizeof(uint64_t));
+                indexed = true;
+                for (uint64_t pos : offsets) indexed &= RecordFits(pos, recordsEnd);
+            }
+        }
+        if (!indexed) {
+            offsets.clear();
+            uint64_t pos = sizeof(header);
+            while (RecordFits(pos, file.size)) {
+                offsets.push_back(pos);
+                pos += sizeof(FrameRecord) + RecordAt(pos).payloadBytes;
+            }
+        }
+
+        const size_t n = header.numNodes;
+        quantized.assign(3 * n, 0);
+        prev.assign(3 * n, 0);
+        prev2.assign(3 * n, 0);
+        positions.assign(3 * n, 0.0f);
+        decoded = size_t(-1);
+        return true;
+    }
+
+    void Close() {
+        file.Close();
+        offsets.clear();
+        decoded = size_t(-1);
+    }
+
+    bool     IsOpen() const    { return file.data != nullptr; }
+    size_t   NumFrames() const { return offsets.size(); }
+    uint32_t NumNodes() const  { return header.numNodes; }
+
+    double Time(size_t frame) const { return RecordAt(offsets[frame]).time; }
+
+    // float3 positions of the frame in original node order; valid until the next call
+    const float* Decode(size_t frame) {
+        if (frame == decoded) return positions.data();
+        size_t start = frame - frame % header.keyInterval;
+        if (decoded != size_t(-1) && decoded < frame && decoded >= start) start = decoded + 1;
+        for (size_t f = start; f <= frame; f++) DecodeRecord(f);
+        decoded = frame;
+
+        const size_t n = header.numNodes;
+        for (int c = 0; c < 3; c++) {
+            const int32_t* q = &prev[c * n];
+            for (size_t i = 0; i < n; i++) positions[3*i + c] = float(header.origin[c] + double(q[i]) * header.step);
+        }
+        return positions.data();
+    }
+
+private:
+    QuantizedHeader header;
+    MappedFile file;
+    std::vector<uint64_t> offsets;
+    std::vector<int32_t>  quantized, prev, prev2;   // prev holds the last decoded frame
+    std::vector<float>    positions;
+    size_t decoded = size_t(-1);
+
+    FrameRecord RecordAt(uint64_t pos) const {
+        FrameRecord record;
+        std::memcpy(&record, file.data + pos, sizeof(record));
+        return record;
+    }
+
+    // whether a whole record, payload included, starts at pos and ends by end
+    bool RecordFits(uint64_t pos, uint64_t end) const {
+        if (pos < sizeof(QuantizedHeader) || pos > end || end - pos < sizeof(FrameRecord)) return false;
+        return RecordAt(pos).payloadBytes <= end - pos - sizeof(FrameRecord);
+    }
+
+    void DecodeRecord(size_t frame) {
+        using namespace CodecDetail;
+        const size_t n = header.numNodes;
+        const uint32_t age = uint32_t(frame % header.keyInterval);
+        FrameRecord record = RecordAt(offsets[frame]);
+        BitReader bits(file.data + offsets[frame] + sizeof(record), record.payloadBytes);
+        for (int c = 0; c < 3; c++) {
+            int32_t* q = &quantized[c * n];
+            const int k = record.riceK[c];
+            for (size_t i = 0; i < n; i++) {
+                q[i] = UnZigZag(bits.GetRice(k)) + Predict(q, &prev[c * n], &prev2[c * n], i, age, Predictor(header.predictor));
+            }
+        }
+        prev2.swap(prev);
+        prev.swap(quantized);
+    }
+};
+
+} // namespace Cache
+
+#endif // CACHECODEC_H
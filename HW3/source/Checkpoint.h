@@ -0,0 +1,194 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <unistd.h>
+#include "Cache.h"
+
+// Checkpoint/restart of the simulation state.
+// The application lists its state once in a transfer function, template <typename Archive>
+// void transfer(Archive& ar) { ar(simTime); ar(mpoints); ... }, which is used both to save
+// (Writer) and to restore (Reader). Values are stored as raw bytes, so a restore is bit-exact.
+//
+// File layout: FileHeader, then the payload. The header records the point and spring sizes,
+// so a snapshot from a build with another precision policy is rejected instead of misread.
+namespace Checkpoint {
+
+struct FileHeader {
+    char     magic[4]     = {'H', 'W', '3', 'K'};
+    uint32_t version      = 1;
+    uint32_t pointBytes   = uint32_t(sizeof(MassPoint));
+    uint32_t springBytes  = uint32_t(sizeof(Spring));
+    uint64_t payloadBytes = 0;
+    uint64_t checksum     = 0;   // FNV-1a of the payload
+};
+
+inline uint64_t Checksum(const char* data, size_t size) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) h = (h ^ uint8_t(data[i])) * 1099511628211ull;
+    return h;
+}
+
+// Appends values to a byte buffer; vectors are stored as a count followed by their elements.
+class Writer {
+public:
+    explicit Writer(std::vector<char>& out) : out(out) {}
+
+    template <typename T>
+    void operator()(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void operator()(const std::vector<T>& values) {
+        (*this)(uint64_t(values.size()));
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            const char* bytes = reinterpret_cast<const char*>(values.data());
+            out.insert(out.end(), bytes, bytes + values.size() * sizeof(T));
+        } else {
+            for (const auto &v : values) (*this)(v);
+        }
+    }
+
+private:
+    std::vector<char>& out;
+};
+
+// Reads values back in the order they were written. Stops and reports failure on a short buffer.
+class Reader {
+public:
+    Reader(const char* data, size_t size) : p(data), end(data + size) {}
+
+    bool Ok() const { return ok; }
+    bool AtEnd() const { return p == end; }
+
+    template <typename T>
+    void operator()(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        if (!Take(sizeof(T))) return;
+        std::memcpy(&value, p - sizeof(T), sizeof(T));
+    }
+
+    template <typename T>
+    void operator()(std::vector<T>& values) {
+        uint64_t n = 0;
+        (*this)(n);
+        if (!ok) return;
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if (n > uint64_t(end - p) / sizeof(T)) { ok = false; return; }
+            values.resize(n);
+            Take(n * sizeof(T));
+            std::memcpy(values.data(), p - n * sizeof(T), n * sizeof(T));
+        } else {
+            values.resize(n);
+            for (auto &v : values) (*this)(v);
+        }
+    }
+
+private:
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    bool Take(size_t bytes) {
+        if (!ok || size_t(end - p) < bytes) { ok = false; return false; }
+        p += bytes;
+        return true;
+    }
+};
+
+// Takes snapshots without stalling the step loop. Save() only copies the state into one of two
+// buffers; a background thread checksums it and writes it to fileName.tmp, then renames it over
+// fileName, so a crash mid-write leaves the previous snapshot intact.
+class Saver {
+public:
+    explicit Saver(const std::string& fileName) : fileName(fileName) {}
+    ~Saver() { Stop(); }
+
+    template <typename Transfer>
+    void Save(Transfer transfer) {
+        if (!started) {
+            queue.Start([this](const std::vector<char>& payload) { WriteFile(payload); });
+            started = true;
+        }
+        std::vector<char> payload = queue.TakeSpare();
+        payload.clear();
+        payload.reserve(lastBytes);
+        Writer writer(payload);
+        transfer(writer);
+        lastBytes = payload.size();
+        queue.Submit(std::move(payload));
+    }
+
+    // waits for the snapshots still being written
+    void Stop() {
+        queue.Stop();
+        started = false;
+    }
+
+private:
+    std::string fileName;
+    Cache::AsyncQueue queue;
+    bool started = false;
+    size_t lastBytes = 0;
+
+    void WriteFile(const std::vector<char>& payload) {
+        FileHeader header;
+        header.payloadBytes = payload.size();
+        header.checksum     = Checksum(payload.data(), payload.size());
+        std::string tmpName = fileName + ".tmp";
+        std::FILE* file = std::fopen(tmpName.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Cannot write checkpoint " << tmpName << std::endl;
+            return;
+        }
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(payload.data(), 1, payload.size(), file) == payload.size() &&
+                  std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+        std::fclose(file);
+        if (!ok || std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+            std::cerr << "Failed to write checkpoint " << fileName << std::endl;
+        }
+    }
+};
+
+// Restores a snapshot written by Saver through the same transfer function.
+template <typename Transfer>
+inline bool Load(const std::string& fileName, Transfer transfer) {
+    Cache::MappedFile file;
+    if (!file.Open(fileName)) return false;
+    FileHeader header, expected;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Invalid checkpoint " << fileName << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data, sizeof(header));
+    if (std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version ||
+        header.pointBytes != expected.pointBytes || header.springBytes != expected.springBytes) {
+        std::cerr << "Checkpoint " << fileName << " was written by an incompatible build" << std::endl;
+        return false;
+    }
+    const char* payload = file.data + sizeof(header);
+    if (header.payloadBytes != file.size - sizeof(header) || header.checksum != Checksum(payload, header.payloadBytes)) {
+        std::cerr << "Checkpoint " << fileName << " is corrupted" << std::endl;
+        return false;
+    }
+    Reader reader(payload, header.payloadBytes);
+    transfer(reader);
+    if (!reader.Ok() || !reader.AtEnd()) {
+        std::cerr << "Checkpoint " << fileName << " does not match this build's state" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace Checkpoint
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,207 @@
+#ifndef CLOTH_H
+#define CLOTH_H
+
+#include <cmath>
+#include <vector>
+#include "Physics.h"
+
+// Cloth on a structured width x height grid. Node (i, j) is number j * width + i, and every spring
+// joins a node to the node at a fixed offset: structural (1,0) (0,1), shear (1,1) (-1,1) and
+// bend (2,0) (0,2). Ends, rest lengths and parameters all follow from the offset's family, so no
+// spring records are stored or streamed.
+//
+// State is kept per component (x, y, z arrays), and each offset is processed a row at a time:
+// one loop computes the spring forces of the row into a scratch row and two more add them to the
+// a and b ends, all over contiguous indices so they vectorize. Forces are summed in the same
+// order as PhysicsUpdate over Springs(), so both give bitwise identical results.
+namespace Cloth {
+
+struct Params {
+    float spacing    = 2.0f;
+    float mass       = 1.0f;
+    float structural = 100.0f;   // stiffness per family
+    float shear      = 20.0f;
+    float bend       = 10.0f;
+    float damping    = 0.2f;
+};
+
+template <typename P>
+class ClothT {
+public:
+    using S = typename P::Storage;
+    using T = typename P::Accum;
+
+    // Positions are origin + spacing * (i * across + j * down); the nodes start at rest.
+    void Init(int width, int height, const Params& params, cy::Vec3f origin, cy::Vec3f across, cy::Vec3f down) {
+        w = width;
+        h = height;
+        mass = params.mass;
+        const size_t n = size_t(w) * h;
+        for (auto *a : { &x, &y, &z, &vx, &vy, &vz }) a->assign(n, S(0));
+        for (auto *a : { &fx, &fy, &fz }) a->assign(n, T(0));
+        freeMask.assign(n, S(1));
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                cy::Vec3f p = origin + params.spacing * (float(i) * across + float(j) * down);
+                x[Node(i, j)] = p.x; y[Node(i, j)] = p.y; z[Node(i, j)] = p.z;
+            }
+        }
+        const float diagonal = params.spacing * std::sqrt(2.0f);
+        families = {
+            { 1, 0, params.spacing, params.structural }, { 0, 1, params.spacing, params.structural },
+            { 1, 1, diagonal, params.shear },            { -1, 1, diagonal, params.shear },
+            { 2, 0, 2 * params.spacing, params.bend },   { 0, 2, 2 * params.spacing, params.bend } };
+        for (auto &f : families) f.damping = params.damping;
+        tx.resize(w); ty.resize(w); tz.resize(w);
+    }
+
+    int Width() const  { return w; }
+    int Height() const { return h; }
+    size_t Size() const { return x.size(); }
+    int Node(int i, int j) const { return j * w + i; }
+
+    // Mass points in node order, all free (pin them with Physics::PinTop and Load them back).
+    std::vector<MassPointT<P>> MassPoints() const {
+        std::vector<MassPointT<P>> mpoints(Size());
+        for (size_t k = 0; k < Size(); k++) {
+            mpoints[k].position = cy::Vec3<S>(x[k], y[k], z[k]);
+            mpoints[k].velocity = cy::Vec3<S>(vx[k], vy[k], vz[k]);
+            mpoints[k].mass     = mass;
+        }
+        return mpoints;
+    }
+
+    // The same springs as explicit records, in the order Step evaluates them.
+    std::vector<SpringT<P>> Springs() const {
+        std::vector<SpringT<P>> springs;
+        for (auto &f : families) {
+            for (int j = 0; j + f.dj < h; j++) {
+                for (int i = First(f); i < End(f); i++) {
+                    springs.push_back({ Node(i, j), Node(i + f.di, j + f.dj), f.restLength, f.stiffness, f.damping });
+                }
+            }
+        }
+        return springs;
+    }
+
+    // Two triangles per cell, for rendering.
+    std::vector<unsigned int> Triangles() const {
+        std::vector<unsigned int> indices;
+        for (int j = 0; j + 1 < h; j++) {
+            for (int i = 0; i + 1 < w; i++) {
+                unsigned int a = Node(i, j), b = Node(i + 1, j), c = Node(i, j + 1), d = Node(i + 1, j + 1);
+                indices.insert(indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        return indices;
+    }
+
+    // Takes positions, velocities and pins from mpoints; slotOf maps a node to its slot (identity if empty).
+    void Load(const std::vector<MassPointT<P>>& mpoints, const std::vector<int>& slotOf) {
+        for (size_t k = 0; k < Size(); k++) {
+            const auto &mp = mpoints[slotOf.empty() ? k : slotOf[k]];
+            x[k] = mp.position.x;  y[k] = mp.position.y;  z[k] = mp.position.z;
+            vx[k] = mp.velocity.x; vy[k] = mp.velocity.y; vz[k] = mp.velocity.z;
+            freeMask[k] = S(!mp.fixed);
+        }
+    }
+
+    void Store(std::vector<MassPointT<P>>& mpoints, const std::vector<int>& slotOf) const {
+        for (size_t k = 0; k < Size(); k++) {
+            auto &mp = mpoints[slotOf.empty() ? k : slotOf[k]];
+            mp.position = cy::Vec3<S>(x[k], y[k], z[k]);
+            mp.velocity = cy::Vec3<S>(vx[k], vy[k], vz[k]);
+        }
+    }
+
+    // One semi-implicit Euler step, the same update as PhysicsUpdate.
+    void Step(const cy::Vec3f externalForce, float deltaTime) {
+        const int n = int(Size());
+        const T gravity = T(-9.8) * T(mass);
+        {
+            PHYSICS_PHASE("forces");
+            #pragma omp simd
+            for (int k = 0; k < n; k++) {
+                fx[k] = T(0) + T(externalForce.x);
+                fy[k] = gravity + T(externalForce.y);
+                fz[k] = T(0) + T(externalForce.z);
+            }
+        }
+        {
+            PHYSICS_PHASE("springs");
+            for (auto &f : families) {
+                for (int j = 0; j + f.dj < h; j++) Row(f, j);
+            }
+        }
+        {
+            PHYSICS_PHASE("integrate");
+            const T dt = deltaTime;
+            const T uniformStep = dt / T(mass);
+            #pragma omp simd
+            for (int k = 0; k < n; k++) {
+                const T step = uniformStep * freeMask[k];
+                const T move = dt * freeMask[k];
+                T vxk = vx[k] + step * fx[k], vyk = vy[k] + step * fy[k], vzk = vz[k] + step * fz[k];
+                vx[k] = S(vxk); vy[k] = S(vyk); vz[k] = S(vzk);
+                x[k] = S(x[k] + move * vxk); y[k] = S(y[k] + move * vyk); z[k] = S(z[k] + move * vzk);
+            }
+        }
+    }
+
+private:
+    struct Family {
+        int di, dj;
+        S   restLength;
+        S   stiffness;
+        S   damping = 0;
+    };
+
+    int w = 0, h = 0;
+    S   mass = 1;
+    std::vector<S> x, y, z, vx, vy, vz;
+    std::vector<T> fx, fy, fz;
+    std::vector<S> freeMask;         // 0 for pinned nodes
+    std::vector<Family> families;
+    std::vector<T> tx, ty, tz;       // force of each spring of the current row
+
+    // columns whose spring at this offset stays inside the grid
+    int First(const Family& f) const { return f.di < 0 ? -f.di : 0; }
+    int End(const Family& f) const   { return f.di > 0 ? w - f.di : w; }
+
+    // Springs from row j to row j + dj. Each end adds in the order PhysicsUpdate would: a node's
+    // b-end contributions of the row come from the spring before it, so they go first.
+    void Row(const Family& f, int j) {
+        const int i0 = First(f), i1 = End(f);
+        const int a = Node(0, j), b = Node(f.di, j + f.dj);
+        const S *ax = &x[a], *ay = &y[a], *az = &z[a], *bx = &x[b], *by = &y[b], *bz = &z[b];
+        const S *avx = &vx[a], *avy = &vy[a], *avz = &vz[a], *bvx = &vx[b], *bvy = &vy[b], *bvz = &vz[b];
+        T *rx = tx.data(), *ry = ty.data(), *rz = tz.data();
+        const T k = f.stiffness, c = f.damping, rest = f.restLength;
+        #pragma omp simd
+        for (int i = i0; i < i1; i++) {
+            T dx = T(bx[i]) - T(ax[i]), dy = T(by[i]) - T(ay[i]), dz = T(bz[i]) - T(az[i]);
+            T len = std::sqrt(dx * dx + dy * dy + dz * dz);
+            T invLen = len > 0 ? T(1) / len : T(0);
+            T ex = dx * invLen, ey = dy * invLen, ez = dz * invLen;
+            T fs = k * (len - rest);
+            fs += c * ((T(bvx[i]) - T(avx[i])) * ex + (T(bvy[i]) - T(avy[i])) * ey + (T(bvz[i]) - T(avz[i])) * ez);
+            rx[i] = ex * fs; ry[i] = ey * fs; rz[i] = ez * fs;
+        }
+        T *fbx = &fx[b], *fby = &fy[b], *fbz = &fz[b];
+        #pragma omp simd
+        for (int i = i0; i < i1; i++) {
+            fbx[i] += -rx[i]; fby[i] += -ry[i]; fbz[i] += -rz[i];
+        }
+        T *fax = &fx[a], *fay = &fy[a], *faz = &fz[a];
+        #pragma omp simd
+        for (int i = i0; i < i1; i++) {
+            fax[i] += rx[i]; fay[i] += ry[i]; faz[i] += rz[i];
+        }
+    }
+};
+
+using Cloth = ClothT<SimPrecision>;
+
+} // namespace Cloth
+
+#endif // CLOTH_H
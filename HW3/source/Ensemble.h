@@ -0,0 +1,133 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <cmath>
+#include <vector>
+#include "Physics.h"
+
+// L simulations of one mesh stepped side by side, for parameter studies. Lane k of every array
+// belongs to simulation k: a node stores x[L], y[L], z[L], so each spring is evaluated for all
+// L simulations by one loop over contiguous lanes, which the compiler turns into SIMD with no
+// gathers or scatters. Lanes share the springs and masses and differ in their stiffness and
+// damping multipliers and in their state (set any lane's initial conditions with SetLane).
+//
+// The math is the explicit kernel's, in float, in the same order, so lane k reproduces a scalar
+// PhysicsUpdate run whose springs were scaled by the lane's multipliers. The spring loop only
+// vectorizes when sqrt and the guarded division may run unconditionally, hence
+// -fno-math-errno -fno-trapping-math in CMakeLists.txt; neither changes any result.
+namespace Ensemble {
+
+template <int L>
+struct Lanes3 {
+    alignas(32) float x[L];
+    float y[L];
+    float z[L];
+};
+
+template <int L>
+class EnsembleT {
+public:
+    static const int LANES = L;
+    float stiffnessScale[L];
+    float dampingScale[L];
+
+    // Every lane starts as a copy of mpoints, with multipliers of 1.
+    template <typename P>
+    void Init(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs) {
+        const size_t n = mpoints.size();
+        position.assign(n, Lanes3<L>());
+        velocity.assign(n, Lanes3<L>());
+        force.assign(n, Lanes3<L>());
+        mass.resize(n);
+        freeMask.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            mass[i]     = float(mpoints[i].mass);
+            freeMask[i] = float(!mpoints[i].fixed);
+        }
+        for (int k = 0; k < L; k++) {
+            SetLane(k, mpoints);
+            stiffnessScale[k] = dampingScale[k] = 1.0f;
+        }
+        this->springs.clear();
+        for (const auto &s : springs) this->springs.push_back({ s.a, s.b, float(s.restLength), float(s.stiffness), float(s.damping) });
+    }
+
+    size_t NumNodes() const { return position.size(); }
+
+    // Positions and velocities of lane k.
+    template <typename P>
+    void SetLane(int k, const std::vector<MassPointT<P>>& mpoints) {
+        for (size_t i = 0; i < mpoints.size(); i++) {
+            const auto &mp = mpoints[i];
+            position[i].x[k] = float(mp.position.x); position[i].y[k] = float(mp.position.y); position[i].z[k] = float(mp.position.z);
+            velocity[i].x[k] = float(mp.velocity.x); velocity[i].y[k] = float(mp.velocity.y); velocity[i].z[k] = float(mp.velocity.z);
+        }
+    }
+    template <typename P>
+    void GetLane(int k, std::vector<MassPointT<P>>& mpoints) const {
+        using Storage = typename P::Storage;
+        for (size_t i = 0; i < mpoints.size(); i++) {
+            auto &mp = mpoints[i];
+            mp.position = cy::Vec3<Storage>(position[i].x[k], position[i].y[k], position[i].z[k]);
+            mp.velocity = cy::Vec3<Storage>(velocity[i].x[k], velocity[i].y[k], velocity[i].z[k]);
+        }
+    }
+
+    // One semi-implicit Euler step of every lane.
+    void Step(const cy::Vec3f externalForce, float deltaTime) {
+        const int n = int(position.size());
+        const float dt = deltaTime;
+        for (int i = 0; i < n; i++) {
+            const float gravity = -9.8f * mass[i];
+            Lanes3<L> &f = force[i];
+            #pragma omp simd
+            for (int k = 0; k < L; k++) {
+                f.x[k] = 0.0f    + externalForce.x;
+                f.y[k] = gravity + externalForce.y;
+                f.z[k] = 0.0f    + externalForce.z;
+            }
+        }
+
+        for (const auto &s : springs) {
+            const Lanes3<L> &pa = position[s.a], &pb = position[s.b];
+            const Lanes3<L> &va = velocity[s.a], &vb = velocity[s.b];
+            Lanes3<L> &fa = force[s.a], &fb = force[s.b];
+            #pragma omp simd
+            for (int k = 0; k < L; k++) {
+                float dx = pb.x[k] - pa.x[k], dy = pb.y[k] - pa.y[k], dz = pb.z[k] - pa.z[k];
+                float len = std::sqrt(dx * dx + dy * dy + dz * dz);
+                float invLen = len > 0 ? 1.0f / len : 0.0f;
+                float ex = dx * invLen, ey = dy * invLen, ez = dz * invLen;
+                float stiffness = s.stiffness * stiffnessScale[k];
+                float damping   = s.damping * dampingScale[k];
+                float fs = stiffness * (len - s.restLength);
+                fs += damping * ((vb.x[k] - va.x[k]) * ex + (vb.y[k] - va.y[k]) * ey + (vb.z[k] - va.z[k]) * ez);
+                float fx = ex * fs, fy = ey * fs, fz = ez * fs;
+                fa.x[k] += fx; fa.y[k] += fy; fa.z[k] += fz;
+                fb.x[k] -= fx; fb.y[k] -= fy; fb.z[k] -= fz;
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            const float step = dt / mass[i] * freeMask[i];
+            const float move = dt * freeMask[i];
+            Lanes3<L> &p = position[i], &v = velocity[i];
+            const Lanes3<L> &f = force[i];
+            #pragma omp simd
+            for (int k = 0; k < L; k++) {
+                v.x[k] += step * f.x[k]; v.y[k] += step * f.y[k]; v.z[k] += step * f.z[k];
+                p.x[k] += move * v.x[k]; p.y[k] += move * v.y[k]; p.z[k] += move * v.z[k];
+            }
+        }
+    }
+
+private:
+    std::vector<Lanes3<L>> position, velocity, force;
+    std::vector<float> mass;
+    std::vector<float> freeMask;    // 0 for fixed nodes
+    std::vector<SpringT<FloatPrecision>> springs;
+};
+
+} // namespace Ensemble
+
+#endif // ENSEMBLE_H
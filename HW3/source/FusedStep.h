@@ -0,0 +1,131 @@
+#ifndef FUSEDSTEP_H
+#define FUSEDSTEP_H
+
+#include <vector>
+#include "Physics.h"
+
+namespace Physics {
+
+// Node-centric form of the explicit step. Every free point pulls the forces of its springs over a
+// CSR adjacency and is integrated in the same pass, so there is no force array and no scatter
+// write; the new positions and velocities go to a second buffer that becomes current after the
+// pass. Points no longer race for their force accumulators, so the pass runs in parallel.
+//
+// A point's links are kept in spring order and each end evaluates the spring from its own side,
+// which gives the exact negation of the other end's force, so the result is bitwise identical to
+// PhysicsUpdate's. Fixed points have no links and are never written.
+//
+// Evaluating each spring from both ends doubles the spring work, and the parallel pass has to win
+// that back. On one core it does not: the armadillo takes 0.59 ms per step against 0.40 ms for
+// the active-set step in float (hw3_bench fused), so the fused step is an option for machines
+// with enough cores, not a default. Its speed with several threads has not been measured.
+template <typename P>
+struct FusedStateT {
+    using Scalar = typename P::Storage;
+    struct Link {
+        int    node;          // the other end
+        Scalar restLength;
+        Scalar stiffness;
+        Scalar damping;
+    };
+    std::vector<int>               linkStart;    // per point, offsets into links (size + 1 entries)
+    std::vector<Link>              links;
+    std::vector<int>               moving;       // points that are not fixed
+    std::vector<Scalar>            mass;
+    std::vector<cy::Vec3<Scalar>>  position[2];
+    std::vector<cy::Vec3<Scalar>>  velocity[2];
+    int                            current = 0;
+
+    size_t Size() const { return mass.size(); }
+
+    // Builds the adjacency and takes over the state. Call again after pins or springs change.
+    void Load(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs) {
+        const size_t n = mpoints.size();
+        linkStart.assign(n + 1, 0);
+        for (auto &s : springs) {
+            if (!mpoints[s.a].fixed) linkStart[s.a + 1]++;
+            if (!mpoints[s.b].fixed) linkStart[s.b + 1]++;
+        }
+        for (size_t i = 0; i < n; i++) linkStart[i + 1] += linkStart[i];
+        links.resize(linkStart[n]);
+        std::vector<int> fill(linkStart.begin(), linkStart.end() - 1);
+        for (auto &s : springs) {
+            if (!mpoints[s.a].fixed) links[fill[s.a]++] = { s.b, s.restLength, s.stiffness, s.damping };
+            if (!mpoints[s.b].fixed) links[fill[s.b]++] = { s.a, s.restLength, s.stiffness, s.damping };
+        }
+
+        moving.clear();
+        mass.resize(n);
+        for (int b = 0; b < 2; b++) {
+            position[b].resize(n);
+            velocity[b].resize(n);
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (!mpoints[i].fixed) moving.push_back(int(i));
+            mass[i] = mpoints[i].mass;
+            for (int b = 0; b < 2; b++) {
+                position[b][i] = mpoints[i].position;
+                velocity[b][i] = mpoints[i].velocity;
+            }
+        }
+        current = 0;
+    }
+
+    // Writes the current positions and velocities back to mpoints.
+    void Store(std::vector<MassPointT<P>>& mpoints) const {
+        for (int i : moving) {
+            mpoints[i].position = position[current][i];
+            mpoints[i].velocity = velocity[current][i];
+        }
+    }
+};
+
+using FusedState = FusedStateT<SimPrecision>;
+
+template <typename P, bool Damping>
+inline void FusedKernel(FusedStateT<P>& state, const cy::Vec3f externalForce, float deltaTime) {
+    using T    = typename P::Accum;
+    using Vec3 = cy::Vec3<T>;
+    using StorageVec3 = cy::Vec3<typename P::Storage>;
+    PHYSICS_PHASE("fused");
+    const auto &x = state.position[state.current];
+    const auto &v = state.velocity[state.current];
+    auto &xOut = state.position[1 - state.current];
+    auto &vOut = state.velocity[1 - state.current];
+    const Vec3 extForce(externalForce);
+    const T dt = deltaTime;
+    const int n = int(state.moving.size());
+
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++) {
+        const int i = state.moving[k];
+        const Vec3 pi(x[i]), vi(v[i]);
+        Vec3 force = Vec3(0, T(-9.8) * state.mass[i], 0) + extForce;
+        for (int l = state.linkStart[i]; l < state.linkStart[i + 1]; l++) {
+            const auto &link = state.links[l];
+            // SpringForce with this point as end a
+            Vec3 dir = Vec3(x[link.node]) - pi;
+            T    len = dir.Length();
+            T invLen = len > 0 ? T(1) / len : T(0);
+            Vec3 e = dir * invLen;
+            T fs = link.stiffness * (len - link.restLength);
+            if (Damping) fs += link.damping * ((Vec3(v[link.node]) - vi).Dot(e));
+            force += e * fs;
+        }
+        Vec3 vNew = vi + (dt / state.mass[i]) * force;
+        vOut[i] = StorageVec3(vNew);
+        xOut[i] = StorageVec3(pi + dt * vNew);
+    }
+    state.current = 1 - state.current;
+}
+
+// Fused explicit step; features as for PhysicsUpdate (only damping matters here).
+template <typename P>
+inline void PhysicsUpdateFused(FusedStateT<P>& state, StepFeatures features, const cy::Vec3f externalForce, float deltaTime) {
+    if (features.damping) FusedKernel<P, true>(state, externalForce, deltaTime);
+    else                  FusedKernel<P, false>(state, externalForce, deltaTime);
+}
+
+} // namespace Physics
+
+#endif // FUSEDSTEP_H
@@ -0,0 +1,280 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "cyVector.h"
+#include "cyGL.h"
+
+// On-screen performance overlay. Text is laid out into one vertex buffer of textured quads
+// over a bitmap-font atlas, so the whole panel is a single draw call.
+namespace Hud {
+
+const int GLYPH_W = 8, GLYPH_H = 16;
+const int ATLAS_COLS = 16, ATLAS_ROWS = 6;   // printable ASCII 32..126, then one solid cell
+const int SOLID_CELL = 95;
+
+// 8x16 glyphs for ASCII 32..126, one byte per row, bit x is pixel x.
+// Rasterized from Source Code Pro (SIL Open Font License 1.1).
+const uint8_t FONT[95][GLYPH_H] = {
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ' '
+        { 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '!'
+        { 0x00, 0x24, 0x24, 0x24, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '"'
+        { 0x00, 0x00, 0x28, 0x20, 0x7e, 0x24, 0x24, 0x7e, 0x14, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '#'
+        { 0x00, 0x10, 0x10, 0x3c, 0x04, 0x04, 0x18, 0x70, 0x40, 0x64, 0x3c, 0x10, 0x10, 0x00, 0x00, 0x00 },  // '$'
+        { 0x00, 0x00, 0x0e, 0xd2, 0x32, 0x0e, 0x60, 0xd8, 0x94, 0xd2, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '%'
+        { 0x00, 0x00, 0x18, 0x24, 0x24, 0x1c, 0x8c, 0x9e, 0x72, 0xe6, 0xbc, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '&'
+        { 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // "'"
+        { 0x00, 0x20, 0x30, 0x10, 0x18, 0x08, 0x08, 0x08, 0x08, 0x08, 0x18, 0x10, 0x20, 0x00, 0x00, 0x00 },  // '('
+        { 0x00, 0x06, 0x0c, 0x08, 0x18, 0x10, 0x10, 0x10, 0x10, 0x18, 0x08, 0x0c, 0x04, 0x00, 0x00, 0x00 },  // ')'
+        { 0x00, 0x00, 0x00, 0x10, 0x10, 0x7c, 0x38, 0x28, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '*'
+        { 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x7e, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '+'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x18, 0x08, 0x00, 0x00 },  // ','
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '-'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '.'
+        { 0x00, 0x20, 0x20, 0x20, 0x10, 0x10, 0x18, 0x08, 0x08, 0x0c, 0x04, 0x04, 0x06, 0x00, 0x00, 0x00 },  // '/'
+        { 0x00, 0x00, 0x3c, 0x26, 0x62, 0x4a, 0x4a, 0x42, 0x62, 0x26, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '0'
+        { 0x00, 0x00, 0x1c, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '1'
+        { 0x00, 0x00, 0x1c, 0x32, 0x20, 0x20, 0x10, 0x18, 0x08, 0x04, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '2'
+        { 0x00, 0x00, 0x1e, 0x32, 0x20, 0x30, 0x1c, 0x30, 0x20, 0x33, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '3'
+        { 0x00, 0x00, 0x30, 0x30, 0x28, 0x24, 0x26, 0x22, 0x7f, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '4'
+        { 0x00, 0x00, 0x7c, 0x04, 0x04, 0x3c, 0x60, 0x40, 0x40, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '5'
+        { 0x00, 0x00, 0x38, 0x04, 0x02, 0x3a, 0x66, 0x42, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '6'
+        { 0x00, 0x00, 0x7e, 0x20, 0x20, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '7'
+        { 0x00, 0x00, 0x3c, 0x66, 0x42, 0x66, 0x3c, 0x62, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '8'
+        { 0x00, 0x00, 0x1c, 0x26, 0x42, 0x66, 0x5c, 0x40, 0x60, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '9'
+        { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ':'
+        { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x18, 0x08, 0x00, 0x00 },  // ';'
+        { 0x00, 0x00, 0x00, 0x60, 0x30, 0x0c, 0x04, 0x18, 0x30, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '<'
+        { 0x00, 0x00, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '='
+        { 0x00, 0x00, 0x00, 0x06, 0x0c, 0x30, 0x20, 0x18, 0x0c, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '>'
+        { 0x00, 0x00, 0x3c, 0x64, 0x40, 0x20, 0x10, 0x08, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '?'
+        { 0x00, 0x00, 0x78, 0xcc, 0x86, 0xc2, 0xf2, 0x8a, 0xca, 0xba, 0x06, 0x0c, 0x78, 0x00, 0x00, 0x00 },  // '@'
+        { 0x00, 0x00, 0x18, 0x18, 0x14, 0x24, 0x24, 0x3e, 0x62, 0x42, 0x43, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'A'
+        { 0x00, 0x00, 0x1e, 0x32, 0x22, 0x32, 0x1e, 0x62, 0x42, 0x62, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'B'
+        { 0x00, 0x00, 0x38, 0x44, 0x02, 0x02, 0x02, 0x02, 0x02, 0x44, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'C'
+        { 0x00, 0x00, 0x1e, 0x32, 0x62, 0x42, 0x42, 0x42, 0x62, 0x32, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'D'
+        { 0x00, 0x00, 0x7c, 0x04, 0x04, 0x04, 0x7c, 0x04, 0x04, 0x04, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'E'
+        { 0x00, 0x00, 0x7c, 0x04, 0x04, 0x04, 0x7c, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'F'
+        { 0x00, 0x00, 0x38, 0x04, 0x02, 0x02, 0x72, 0x42, 0x42, 0x44, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'G'
+        { 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x7e, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'H'
+        { 0x00, 0x00, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'I'
+        { 0x00, 0x00, 0x3e, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x32, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'J'
+        { 0x00, 0x00, 0x62, 0x32, 0x12, 0x0a, 0x1e, 0x16, 0x32, 0x22, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'K'
+        { 0x00, 0x00, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'L'
+        { 0x00, 0x00, 0x66, 0x66, 0x66, 0x7e, 0x5a, 0x5a, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'M'
+        { 0x00, 0x00, 0x46, 0x46, 0x4e, 0x4a, 0x5a, 0x52, 0x72, 0x62, 0x62, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'N'
+        { 0x00, 0x00, 0x3c, 0x26, 0x62, 0x42, 0x42, 0x42, 0x62, 0x26, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'O'
+        { 0x00, 0x00, 0x3e, 0x62, 0x42, 0x62, 0x3e, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'P'
+        { 0x00, 0x00, 0x1c, 0x24, 0x62, 0x42, 0x42, 0x42, 0x42, 0x66, 0x24, 0x18, 0x10, 0x60, 0x00, 0x00 },  // 'Q'
+        { 0x00, 0x00, 0x3e, 0x62, 0x42, 0x62, 0x3e, 0x12, 0x32, 0x22, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'R'
+        { 0x00, 0x00, 0x3c, 0x22, 0x02, 0x06, 0x38, 0x60, 0x40, 0x62, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'S'
+        { 0x00, 0x00, 0x7f, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'T'
+        { 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'U'
+        { 0x00, 0x00, 0x42, 0x42, 0x66, 0x24, 0x24, 0x34, 0x1c, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'V'
+        { 0x00, 0x00, 0x83, 0xc3, 0xda, 0xda, 0x5a, 0x7a, 0x6e, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'W'
+        { 0x00, 0x00, 0x62, 0x24, 0x34, 0x18, 0x18, 0x18, 0x34, 0x26, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'X'
+        { 0x00, 0x00, 0x61, 0x22, 0x32, 0x14, 0x1c, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'Y'
+        { 0x00, 0x00, 0x7e, 0x60, 0x20, 0x10, 0x18, 0x08, 0x04, 0x06, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'Z'
+        { 0x00, 0x78, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x78, 0x00, 0x00 },  // '['
+        { 0x00, 0x06, 0x04, 0x04, 0x0c, 0x08, 0x08, 0x18, 0x10, 0x10, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00 },  // '\\'
+        { 0x00, 0x1e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1e, 0x00, 0x00 },  // ']'
+        { 0x00, 0x00, 0x18, 0x18, 0x34, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '^'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x00 },  // '_'
+        { 0x04, 0x08, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '`'
+        { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x62, 0x60, 0x7c, 0x42, 0x62, 0x5c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'a'
+        { 0x00, 0x02, 0x02, 0x02, 0x3a, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'b'
+        { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x06, 0x02, 0x02, 0x02, 0x46, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'c'
+        { 0x00, 0x40, 0x40, 0x40, 0x7c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x5c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'd'
+        { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x7e, 0x02, 0x06, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'e'
+        { 0x00, 0x70, 0x08, 0x08, 0x7e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'f'
+        { 0x00, 0x00, 0x00, 0x00, 0x7c, 0x32, 0x22, 0x32, 0x1e, 0x02, 0x7e, 0x42, 0x62, 0x3c, 0x00, 0x00 },  // 'g'
+        { 0x00, 0x02, 0x02, 0x02, 0x3a, 0x66, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'h'
+        { 0x00, 0x10, 0x10, 0x00, 0x1e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'i'
+        { 0x00, 0x10, 0x10, 0x00, 0x1e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x18, 0x0e, 0x00, 0x00 },  // 'j'
+        { 0x00, 0x04, 0x04, 0x04, 0x44, 0x24, 0x34, 0x3c, 0x2c, 0x44, 0xc4, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'k'
+        { 0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'l'
+        { 0x00, 0x00, 0x00, 0x00, 0xfe, 0x92, 0x92, 0x92, 0x92, 0x92, 0x92, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'm'
+        { 0x00, 0x00, 0x00, 0x00, 0x3a, 0x66, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'n'
+        { 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'o'
+        { 0x00, 0x00, 0x00, 0x00, 0x3a, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3e, 0x02, 0x02, 0x02, 0x00, 0x00 },  // 'p'
+        { 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x5c, 0x40, 0x40, 0x40, 0x00, 0x00 },  // 'q'
+        { 0x00, 0x00, 0x00, 0x00, 0x74, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'r'
+        { 0x00, 0x00, 0x00, 0x00, 0x1e, 0x02, 0x06, 0x1c, 0x30, 0x22, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 's'
+        { 0x00, 0x00, 0x08, 0x08, 0x7e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 't'
+        { 0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x32, 0x2e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'u'
+        { 0x00, 0x00, 0x00, 0x00, 0x42, 0x62, 0x26, 0x24, 0x34, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'v'
+        { 0x00, 0x00, 0x00, 0x00, 0xc1, 0xdb, 0x5b, 0x5a, 0x76, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'w'
+        { 0x00, 0x00, 0x00, 0x00, 0x66, 0x24, 0x18, 0x18, 0x1c, 0x24, 0x62, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'x'
+        { 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x24, 0x24, 0x3c, 0x18, 0x18, 0x18, 0x08, 0x06, 0x00, 0x00 },  // 'y'
+        { 0x00, 0x00, 0x00, 0x00, 0x7e, 0x20, 0x30, 0x18, 0x0c, 0x04, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00 },  // 'z'
+        { 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x0c, 0x06, 0x0c, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00 },  // '{'
+        { 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00 },  // '|'
+        { 0x00, 0x0e, 0x18, 0x10, 0x10, 0x10, 0x10, 0x70, 0x10, 0x10, 0x10, 0x10, 0x18, 0x0e, 0x00, 0x00 },  // '}'
+        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '~'
+};
+
+// Resident set size of the process, from /proc/self/statm (0 if unavailable).
+inline size_t ResidentBytes() {
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages = 0, resident = 0;
+    int read = std::fscanf(f, "%lu %lu", &pages, &resident);
+    std::fclose(f);
+    return read == 2 ? size_t(resident) * size_t(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+// Events per second over the last second.
+class RateCounter {
+public:
+    void Tick() {
+        auto now = std::chrono::steady_clock::now();
+        ticks.push_back(now);
+        while (now - ticks.front() > std::chrono::seconds(1)) ticks.pop_front();
+    }
+    double Rate() const {
+        if (ticks.size() < 2) return 0.0;
+        std::chrono::duration<double> span = ticks.back() - ticks.front();
+        return span.count() > 0.0 ? (ticks.size() - 1) / span.count() : 0.0;
+    }
+
+private:
+    std::deque<std::chrono::steady_clock::time_point> ticks;
+};
+
+class Overlay {
+public:
+    bool visible = true;
+
+    void Initialize() {
+        // font atlas: one byte per texel, 255 where a glyph pixel is set
+        std::vector<uint8_t> atlas(ATLAS_COLS * GLYPH_W * ATLAS_ROWS * GLYPH_H, 0);
+        const int pitch = ATLAS_COLS * GLYPH_W;
+        for (int cell = 0; cell <= SOLID_CELL; cell++) {
+            int cx = (cell % ATLAS_COLS) * GLYPH_W, cy = (cell / ATLAS_COLS) * GLYPH_H;
+            for (int y = 0; y < GLYPH_H; y++) {
+                for (int x = 0; x < GLYPH_W; x++) {
+                    bool on = cell == SOLID_CELL || ((FONT[cell][y] >> x) & 1);
+                    atlas[(cy + y) * pitch + cx + x] = on ? 255 : 0;
+                }
+            }
+        }
+        font.Initialize();
+        font.SetImage(GL_R8, GL_RED, atlas.data(), pitch, ATLAS_ROWS * GLYPH_H);
+        font.SetFilteringMode(GL_NEAREST, GL_NEAREST);
+        font.SetWrappingMode(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+        prog.BuildSources(
+            "#version 330 core\n"
+            "layout(location = 0) in vec2 aPos;\n"
+            "layout(location = 1) in vec2 aUV;\n"
+            "layout(location = 2) in vec4 aColor;\n"
+            "uniform vec2 screenSize;\n"
+            "out vec2 uv;\n"
+            "out vec4 color;\n"
+            "void main() {\n"
+            "    gl_Position = vec4(aPos / screenSize * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+            "    uv = aUV;\n"
+            "    color = aColor;\n"
+            "}\n",
+            "#version 330 core\n"
+            "uniform sampler2D font;\n"
+            "in vec2 uv;\n"
+            "in vec4 color;\n"
+            "out vec4 fragColor;\n"
+            "void main() {\n"
+            "    fragColor = vec4(color.rgb, color.a * texture(font, uv).r);\n"
+            "}\n");
+
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, r));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+    }
+
+    // starts a new panel; lines are added with Print()
+    void Begin() { lines.clear(); }
+
+    void Print(const std::string& line, const cy::Vec4f& color = cy::Vec4f(1.0f, 1.0f, 1.0f, 1.0f)) {
+        lines.push_back({ line, color });
+    }
+
+    // Draws the panel in the top-left corner: background and all text in one glDrawArrays.
+    void Draw(int screenWidth, int screenHeight) {
+        if (!visible || lines.empty()) return;
+        const float margin = 6.0f;
+        size_t columns = 0;
+        for (auto &l : lines) columns = std::max(columns, l.text.size());
+
+        vertices.clear();
+        AddQuad(0.0f, 0.0f, columns * GLYPH_W + 2 * margin, lines.size() * GLYPH_H + 2 * margin, SOLID_CELL, cy::Vec4f(0.0f, 0.0f, 0.0f, 0.6f));
+        for (size_t row = 0; row < lines.size(); row++) {
+            const auto &l = lines[row];
+            for (size_t col = 0; col < l.text.size(); col++) {
+                int c = (unsigned char)l.text[col];
+                if (c <= 32 || c > 126) continue;
+                AddQuad(margin + col * GLYPH_W, margin + row * GLYPH_H, GLYPH_W, GLYPH_H, c - 32, l.color);
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        prog.Bind();
+        prog["screenSize"] = cy::Vec2f(float(screenWidth), float(screenHeight));
+        prog["font"] = 0;
+        font.Bind(0);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+        glBindVertexArray(0);
+        glDisable(GL_BLEND);
+        if (depthTest) glEnable(GL_DEPTH_TEST);
+    }
+
+private:
+    struct Vertex { float x, y, u, v, r, g, b, a; };
+    struct Line { std::string text; cy::Vec4f color; };
+
+    cy::GLTexture2D     font;
+    cy::GLSLProgram     prog;
+    GLuint              vao = 0, vbo = 0;
+    std::vector<Line>   lines;
+    std::vector<Vertex> vertices;
+
+    void AddQuad(float x, float y, float w, float h, int cell, const cy::Vec4f& c) {
+        const float atlasW = float(ATLAS_COLS * GLYPH_W), atlasH = float(ATLAS_ROWS * GLYPH_H);
+        float u0 = (cell % ATLAS_COLS) * GLYPH_W / atlasW, v0 = (cell / ATLAS_COLS) * GLYPH_H / atlasH;
+        float u1 = u0 + GLYPH_W / atlasW, v1 = v0 + GLYPH_H / atlasH;
+        if (cell == SOLID_CELL) {   // sample the middle of the solid cell only
+            float du = 0.5f / atlasW, dv = 0.5f / atlasH;
+            u0 += du; v0 += dv; u1 -= du; v1 -= dv;
+        }
+        Vertex q[4] = { { x,     y,     u0, v0, c.x, c.y, c.z, c.w },
+                        { x + w, y,     u1, v0, c.x, c.y, c.z, c.w },
+                        { x + w, y + h, u1, v1, c.x, c.y, c.z, c.w },
+                        { x,     y + h, u0, v1, c.x, c.y, c.z, c.w } };
+        for (int i : { 0, 1, 2, 0, 2, 3 }) vertices.push_back(q[i]);
+    }
+};
+
+} // namespace Hud
+
+#endif // HUD_H
@@ -0,0 +1,113 @@
+#ifndef INSTANCES_H
+#define INSTANCES_H
+
+#include <memory>
+#include <vector>
+#include "Physics.h"
+#include "Sleep.h"
+
+// Many copies of one soft body. Everything that stays fixed while stepping (the springs with
+// their rest lengths, stiffness and damping, the initial state and the step features) lives in a
+// single Topology shared by all instances; an instance owns nothing but its mass points.
+// Instances keep their points in original node order, so the surface indices and normals of the
+// mesh apply to every instance unchanged and all of them render from one buffer.
+// An instance that comes to rest falls asleep and is skipped until an external force wakes it.
+namespace Instances {
+
+template <typename P>
+struct TopologyT {
+    std::vector<SpringT<P>>    springs;
+    std::vector<MassPointT<P>> rest;       // the state a new instance starts from
+    Physics::StepFeatures      features;
+
+    size_t Bytes() const { return springs.size() * sizeof(SpringT<P>) + rest.size() * sizeof(MassPointT<P>); }
+};
+
+// Builds the shared data from a body's points and springs, at rest.
+// nodeAt maps each slot of mpoints to its original node (identity if empty).
+template <typename P>
+inline std::shared_ptr<const TopologyT<P>> MakeTopology(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs, const std::vector<int>& nodeAt) {
+    auto topology = std::make_shared<TopologyT<P>>();
+    auto node = [&nodeAt](int slot) { return nodeAt.empty() ? slot : nodeAt[slot]; };
+    topology->rest.resize(mpoints.size());
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        auto &mp = topology->rest[node(int(i))];
+        mp = mpoints[i];
+        mp.velocity = cy::Vec3<typename P::Storage>(0, 0, 0);
+        mp.force    = cy::Vec3<typename P::Accum>(0, 0, 0);
+    }
+    topology->springs = springs;
+    for (auto &s : topology->springs) {
+        s.a = node(s.a);
+        s.b = node(s.b);
+    }
+    topology->features = Physics::DetectFeatures(topology->rest, topology->springs);
+    return topology;
+}
+
+template <typename P>
+class SceneT {
+public:
+    std::vector<std::vector<MassPointT<P>>> states;   // per instance, in node order
+    std::vector<Physics::SleepCounter>      sleep;    // per instance
+    Physics::SleepParams                    sleepParams;
+    bool                                    sleepEnabled = true;
+
+    void SetTopology(std::shared_ptr<const TopologyT<P>> shared) { topology = std::move(shared); }
+    const TopologyT<P>* Topology() const { return topology.get(); }
+
+    size_t Size() const     { return states.size(); }
+    size_t NumNodes() const { return topology ? topology->rest.size() : 0; }
+    size_t StateBytes() const { return NumNodes() * sizeof(MassPointT<P>); }   // per instance
+    size_t NumAsleep() const {
+        return std::count_if(sleep.begin(), sleep.end(), [](const Physics::SleepCounter &c) { return c.asleep; });
+    }
+
+    void WakeAll() { sleep.assign(states.size(), Physics::SleepCounter()); }
+
+    // Adds an instance in the rest state, moved by offset.
+    void Add(const cy::Vec3f& offset) {
+        states.push_back(topology->rest);
+        const cy::Vec3<typename P::Storage> move(offset);
+        for (auto &mp : states.back()) mp.position += move;
+    }
+
+    // Explicit step of every awake instance. Instances are independent, so they run in parallel.
+    void Step(const cy::Vec3f externalForce, float deltaTime) {
+        const int n = int(states.size());
+        if (sleep.size() != states.size() || externalForce.x != 0 || externalForce.y != 0 || externalForce.z != 0) WakeAll();
+        #pragma omp parallel for schedule(dynamic)
+        for (int k = 0; k < n; k++) {
+            if (sleep[k].asleep) continue;
+            Physics::PhysicsUpdate(states[k], topology->springs, topology->features, externalForce, deltaTime);
+            if (!sleepEnabled) continue;
+            if (sleep[k].Update(Physics::MeanKineticEnergy(states[k], 0, states[k].size()), sleepParams)) {
+                sleep[k].asleep = true;
+                for (auto &mp : states[k]) mp.velocity = cy::Vec3<typename P::Storage>(0, 0, 0);
+            }
+        }
+    }
+
+    // float3 positions of all instances, one instance after another.
+    void Gather(float* dst) const {
+        const int n = int(states.size());
+        const size_t nodes = NumNodes();
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; k++) {
+            float* out = dst + 3 * nodes * k;
+            for (const auto &mp : states[k]) {
+                *out++ = float(mp.position.x); *out++ = float(mp.position.y); *out++ = float(mp.position.z);
+            }
+        }
+    }
+
+private:
+    std::shared_ptr<const TopologyT<P>> topology;
+};
+
+using Topology = TopologyT<SimPrecision>;
+using Scene    = SceneT<SimPrecision>;
+
+} // namespace Instances
+
+#endif // INSTANCES_H
@@ -63,7 +63,9 @@ namespace Models {
         int v[4]; // indices to the node list
     };
     
-    bool loadNodes(const std::string &nodeFile, std::vector<cy::Vec3f>& nodes, cy::Vec3f &centroid) {
+    // firstIndex: the number of the first node; TetGen files number from 0 or 1 and the .ele file
+    // refers to the nodes by the same numbers
+    bool loadNodes(const std::string &nodeFile, std::vector<cy::Vec3f>& nodes, cy::Vec3f &centroid, int &firstIndex) {
         std::ifstream inFile(nodeFile);
         if (!inFile) {
             std::cerr << "Cannot open node file " << nodeFile << std::endl;
@@ -81,6 +83,7 @@ namespace Models {
             cy::Vec3f node;
             inFile >> index >> node.x >> node.y >> node.z;
             // Optionally read extra attributes...
+            if (i == 0) firstIndex = index;
             nodes.push_back(node);
         }
 
@@ -92,7 +95,8 @@ namespace Models {
         return true;
     }
     
-    bool loadTetrahedra(const std::string &tetFile, std::vector<Tetrahedron>& tets) {
+    // firstIndex: the number of the first node, from loadNodes; the indices are made 0-based
+    bool loadTetrahedra(const std::string &tetFile, std::vector<Tetrahedron>& tets, int firstIndex) {
         std::ifstream inFile(tetFile);
         if (!inFile) {
             std::cerr << "Cannot open tetrahedral file " << tetFile << std::endl;
@@ -114,11 +118,7 @@ namespace Models {
             Tetrahedron tet;
             int tetIndex;
             inFile >> tetIndex >> tet.v[0] >> tet.v[1] >> tet.v[2] >> tet.v[3];
-            // Convert from 1-indexed to 0-indexed
-            tet.v[0]--;
-            tet.v[1]--;
-            tet.v[2]--;
-            tet.v[3]--;
+            for (int k = 0; k < 4; k++) tet.v[k] -= firstIndex;
             tets.push_back(tet);
         }
 
@@ -184,6 +184,28 @@ namespace Models {
         return surfaceFaces;
     }
 
+    // Unique edges of the tetrahedral mesh, each stored as (min index, max index).
+    std::vector<std::pair<int,int>> extractEdges(const std::vector<Models::Tetrahedron> &tets) {
+        std::vector<std::pair<int,int>> rawEdges;
+        rawEdges.reserve(tets.size()*6);
+
+        for (auto &T : tets) {
+            int v[4] = {T.v[0], T.v[1], T.v[2], T.v[3]};
+            // the 6 edges
+            rawEdges.emplace_back(std::min(v[0],v[1]), std::max(v[0],v[1]));
+            rawEdges.emplace_back(std::min(v[0],v[2]), std::max(v[0],v[2]));
+            rawEdges.emplace_back(std::min(v[0],v[3]), std::max(v[0],v[3]));
+            rawEdges.emplace_back(std::min(v[1],v[2]), std::max(v[1],v[2]));
+            rawEdges.emplace_back(std::min(v[1],v[3]), std::max(v[1],v[3]));
+            rawEdges.emplace_back(std::min(v[2],v[3]), std::max(v[2],v[3]));
+        }
+
+        // sort & unique
+        std::sort(rawEdges.begin(), rawEdges.end());
+        rawEdges.erase(std::unique(rawEdges.begin(), rawEdges.end()), rawEdges.end());
+        return rawEdges;
+    }
+
 } // namespace models
 
 #endif 
\ No newline at end of file
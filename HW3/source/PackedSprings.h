@@ -0,0 +1,118 @@
+#ifndef PACKEDSPRINGS_H
+#define PACKEDSPRINGS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Physics.h"
+
+namespace Physics {
+
+// Spring parameters shared by every spring of one material.
+template <typename P>
+struct MaterialT {
+    typename P::Storage stiffness;
+    typename P::Storage damping;
+
+    bool operator==(const MaterialT& m) const { return stiffness == m.stiffness && damping == m.damping; }
+};
+
+// 12 bytes per spring in float (against Spring's 20): the end points and the rest length.
+template <typename P>
+struct PackedSpringT {
+    int32_t             a, b;
+    typename P::Storage restLength;
+};
+
+// Springs with their parameters moved to a small material table. Within each group of the step
+// layout (both ends moving, end a only) the springs are sorted by material and stored as runs,
+// so the material is implied by a spring's run and the kernel reads its parameters once per run.
+//
+// There is no measurable speedup from the smaller records. Across repeated hw3_bench packed runs
+// on one core the packed kernel ranged from 0.73x to 1.48x the speed of the Spring records on
+// the armadillo and from 0.96x to 1.09x on a 1024 x 1024 cloth, so the difference is within the
+// run-to-run noise. The machine measured reports a 300 MB last-level cache, which holds the
+// springs of both meshes (about 120 MB of records for the cloth), so the bytes saved do not show
+// up as time; a win needs springs that spill to memory.
+template <typename P>
+struct PackedSpringsT {
+    struct Run {
+        uint32_t begin, end;
+        uint16_t material;
+        bool     bothEnds;
+    };
+    std::vector<MaterialT<P>>     materials;
+    std::vector<PackedSpringT<P>> springs;
+    std::vector<Run>              runs;
+
+    // Packs springs [0, layout.oneEnd); the rest are never evaluated and are dropped. Springs that
+    // share stiffness and damping share a material. Call again whenever the springs change.
+    void Build(const std::vector<SpringT<P>>& source, const StepLayout layout) {
+        materials.clear();
+        springs.clear();
+        runs.clear();
+        std::vector<uint16_t> materialOf(layout.oneEnd);
+        for (size_t i = 0; i < layout.oneEnd; i++) {
+            MaterialT<P> m = { source[i].stiffness, source[i].damping };
+            auto it = std::find(materials.begin(), materials.end(), m);
+            if (it == materials.end()) it = materials.insert(materials.end(), m);
+            materialOf[i] = uint16_t(it - materials.begin());
+        }
+        for (int group = 0; group < 2; group++) {
+            const size_t begin = group == 0 ? 0 : layout.bothEnd;
+            const size_t end   = group == 0 ? layout.bothEnd : layout.oneEnd;
+            std::vector<uint32_t> order;
+            for (size_t i = begin; i < end; i++) order.push_back(uint32_t(i));
+            // stable, so a single material keeps the original order and gives identical results
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return materialOf[x] < materialOf[y]; });
+            for (uint32_t i : order) {
+                if (runs.empty() || runs.back().material != materialOf[i] || runs.back().bothEnds != (group == 0)) {
+                    runs.push_back({ uint32_t(springs.size()), uint32_t(springs.size()), materialOf[i], group == 0 });
+                }
+                springs.push_back({ source[i].a, source[i].b, source[i].restLength });
+                runs.back().end++;
+            }
+        }
+    }
+
+    size_t Bytes() const { return springs.size() * sizeof(PackedSpringT<P>) + materials.size() * sizeof(MaterialT<P>) + runs.size() * sizeof(Run); }
+};
+
+using PackedSprings = PackedSpringsT<SimPrecision>;
+
+// The spring phase of PhysicsUpdateKernel for packed springs.
+template <typename P, bool Damping>
+inline void AccumulateSpringForces(std::vector<MassPointT<P>> & mpoints, const PackedSpringsT<P> & packed, const StepLayout) {
+    using Vec3 = cy::Vec3<typename P::Accum>;
+    for (const auto &run : packed.runs) {
+        const MaterialT<P> m = packed.materials[run.material];
+        if (run.bothEnds) {
+            for (uint32_t i = run.begin; i < run.end; i++) {
+                auto &s = packed.springs[i];
+                auto &A = mpoints[s.a];
+                auto &B = mpoints[s.b];
+                Vec3 f = SpringForce<P, Damping>(A, B, s.restLength, m.stiffness, m.damping);
+                A.force +=  f;
+                B.force += -f;
+            }
+        } else {
+            for (uint32_t i = run.begin; i < run.end; i++) {
+                auto &s = packed.springs[i];
+                mpoints[s.a].force += SpringForce<P, Damping>(mpoints[s.a], mpoints[s.b], s.restLength, m.stiffness, m.damping);
+            }
+        }
+    }
+}
+
+// Explicit step over packed springs; layout gives the points to integrate (the springs were
+// packed with the same layout). Same kernels and results as PhysicsUpdate.
+template <typename P>
+inline void PhysicsUpdate(std::vector<MassPointT<P>> & mpoints, const PackedSpringsT<P> & packed, const StepLayout layout, StepFeatures features, const cy::Vec3f externalForce, float deltaTime) {
+    features.hasExternal = externalForce.x != 0 || externalForce.y != 0 || externalForce.z != 0;
+    UpdateKernel<P, PackedSpringsT<P>> kernel = SelectKernel<P, PackedSpringsT<P>>(features.Index(), std::make_integer_sequence<int, 16>());
+    kernel(mpoints, packed, layout, externalForce, deltaTime);
+}
+
+} // namespace Physics
+
+#endif // PACKEDSPRINGS_H
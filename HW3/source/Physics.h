@@ -3,24 +3,55 @@
 
 #include <iostream>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <utility>
 #include "Util.h"
+#include "Solver.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
+
+// Marks a phase of a step kernel for the profiler and the hardware counters.
+#define PHYSICS_PHASE(name) PROFILE_SCOPE(name); PERF_SCOPE(name)
+
+// Scalar policies: Storage is what particle and spring data are kept in,
+// Accum is what forces are accumulated and integrated in.
+struct FloatPrecision  { using Storage = float;  using Accum = float;  };
+struct DoublePrecision { using Storage = double; using Accum = double; };
+struct MixedPrecision  { using Storage = float;  using Accum = double; };
+
+// compile-time selection of the policy used by the apps
+#if defined(PHYSICS_DOUBLE_PRECISION)
+using SimPrecision = DoublePrecision;
+#elif defined(PHYSICS_MIXED_PRECISION)
+using SimPrecision = MixedPrecision;
+#else
+using SimPrecision = FloatPrecision;
+#endif
 
 // structs for nodes and springs
-struct MassPoint {
-    cy::Vec3f position;
-    cy::Vec3f velocity    = cy::Vec3f(0,0,0);
-    cy::Vec3f force       = cy::Vec3f(0,0,0);
-    float     mass        = 1.0f;
+template <typename P>
+struct MassPointT {
+    using Scalar = typename P::Storage;
+    cy::Vec3<Scalar> position;
+    cy::Vec3<Scalar> velocity = cy::Vec3<Scalar>(0,0,0);
+    cy::Vec3<typename P::Accum> force = cy::Vec3<typename P::Accum>(0,0,0);
+    Scalar    mass        = 1;
     bool      fixed       = false;        // anchors won’t move
 };
 
-struct Spring {
+template <typename P>
+struct SpringT {
+    using Scalar = typename P::Storage;
     int       a, b;        // indices into your MassPoint array
-    float     restLength;
-    float     stiffness;   // e.g. 50–200
-    float     damping;     // e.g. 0.1–1.0
+    Scalar    restLength;
+    Scalar    stiffness;   // e.g. 50–200
+    Scalar    damping;     // e.g. 0.1–1.0
 };
 
+using MassPoint = MassPointT<SimPrecision>;
+using Spring    = SpringT<SimPrecision>;
+
 // Global boundaries and restitution factor.
 float restitution = 0.8f; // restitution controls bounce energy loss
 cy::Vec3f minBounds = {-47.0f, -25.0f, -47.0f};
@@ -29,36 +60,449 @@ cy::Vec3f maxBounds = {47.0f, 25.0f, 47.0f};
 
 namespace Physics {
 
-// This function uses an explicit integration method for updating the physics state.
-inline void PhysicsUpdate(std::vector<MassPoint> & mpoints, std::vector<Spring> & springs, const cy::Vec3f externalForce, float deltaTime) {
-    // zero forces
+// Which optional terms a step needs. Each combination selects its own kernel instantiation,
+// so the inner loops carry no per-particle or per-spring feature tests.
+struct StepFeatures {
+    bool damping     = true;    // any spring has nonzero damping
+    bool hasFixed    = true;    // any mass point is fixed
+    bool uniformMass = false;   // all mass points share one mass
+    bool hasExternal = true;    // externalForce is nonzero
+
+    int Index() const { return int(damping) | int(hasFixed) << 1 | int(uniformMass) << 2 | int(hasExternal) << 3; }
+};
+
+// Scans the particles and springs for the structural features; call again when pins, masses or
+// spring parameters change. hasExternal is decided per step.
+template <typename P>
+inline StepFeatures DetectFeatures(const std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs) {
+    StepFeatures f;
+    f.damping = f.hasFixed = false;
+    f.uniformMass = true;
+    for (auto &s : springs) f.damping |= s.damping != 0;
     for (auto &mp : mpoints) {
-        if (!mp.fixed) mp.force = cy::Vec3f(0, -9.8f * mp.mass, 0) + externalForce;  // gravity
+        f.hasFixed    |= mp.fixed;
+        f.uniformMass &= mp.mass == mpoints[0].mass;
     }
+    return f;
+}
 
-    // spring forces
-    for (auto &s : springs) {
+// Index ranges a step visits. Points [0, numMoving) are integrated; springs [0, bothEnd)
+// push on both ends, springs [bothEnd, oneEnd) only on end a, and the rest are skipped.
+// The default layout visits everything and relies on the fixed flags instead.
+struct StepLayout {
+    size_t numMoving;
+    size_t bothEnd;
+    size_t oneEnd;
+};
+
+template <typename P>
+inline StepLayout FullLayout(const std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs) {
+    return { mpoints.size(), springs.size(), springs.size() };
+}
+
+// Force of a spring between A and B on its end A (end B receives the negation).
+template <typename P, bool Damping>
+inline cy::Vec3<typename P::Accum> SpringForce(const MassPointT<P> & A, const MassPointT<P> & B,
+                                               typename P::Storage restLength, typename P::Storage stiffness, typename P::Storage damping) {
+    using T    = typename P::Accum;
+    using Vec3 = cy::Vec3<T>;
+    Vec3 dir = Vec3(B.position) - Vec3(A.position);
+    T    len = dir.Length();
+    // a degenerate spring gets e = 0 and therefore no force
+    T invLen = len > 0 ? T(1) / len : T(0);
+    Vec3 e = dir * invLen;
+    // Hooke’s law: a stretched spring pulls A towards B
+    T fs = stiffness * (len - restLength);
+    if (Damping) {
+        // damping: relative velocity along the spring
+        fs += damping * ( (Vec3(B.velocity) - Vec3(A.velocity)).Dot(e) );
+    }
+    return e * fs;
+}
+
+template <typename P, bool Damping>
+inline cy::Vec3<typename P::Accum> SpringForce(const MassPointT<P> & A, const MassPointT<P> & B, const SpringT<P> & s) {
+    return SpringForce<P, Damping>(A, B, s.restLength, s.stiffness, s.damping);
+}
+
+// Adds the forces of springs [0, layout.oneEnd) to their end points (see StepLayout).
+// Other spring storages (PackedSprings.h) overload this for the kernel below.
+template <typename P, bool Damping>
+inline void AccumulateSpringForces(std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs, const StepLayout layout) {
+    using Vec3 = cy::Vec3<typename P::Accum>;
+    for (size_t i = 0; i < layout.bothEnd; i++) {
+        auto &s = springs[i];
         auto &A = mpoints[s.a];
         auto &B = mpoints[s.b];
-        cy::Vec3f dir   = B.position - A.position;
-        float      len  = dir.Length();
-        if (len > 0) {
-            cy::Vec3f e = dir / len;
-            // Hooke’s law
-            float fs = -s.stiffness * (len - s.restLength);
-            // damping: relative velocity along the spring
-            float fd = -s.damping * ( (B.velocity - A.velocity).Dot(e) );
-            cy::Vec3f f = e * (fs + fd);
-            if (!A.fixed) A.force +=  f;
-            if (!B.fixed) B.force += -f;
+        Vec3 f = SpringForce<P, Damping>(A, B, s);
+        A.force +=  f;
+        B.force += -f;
+    }
+    for (size_t i = layout.bothEnd; i < layout.oneEnd; i++) {
+        auto &s = springs[i];
+        mpoints[s.a].force += SpringForce<P, Damping>(mpoints[s.a], mpoints[s.b], s);
+    }
+}
+
+// Explicit (semi-implicit Euler) step specialized on the feature flags.
+// Forces and the integration itself are computed in P::Accum, then stored back as P::Storage.
+// Fixed points still accumulate force but are masked out of the integration.
+template <typename P, typename Springs, bool Damping, bool HasFixed, bool UniformMass, bool HasExternal>
+inline void PhysicsUpdateKernel(std::vector<MassPointT<P>> & mpoints, const Springs & springs, const StepLayout layout, const cy::Vec3f externalForce, float deltaTime) {
+    using T    = typename P::Accum;
+    using Vec3 = cy::Vec3<T>;
+    using StorageVec3 = cy::Vec3<typename P::Storage>;
+    if (layout.numMoving == 0) return;
+    const Vec3 extForce(externalForce);
+    const T dt = deltaTime;
+    const T uniformMass = mpoints[0].mass;
+    const Vec3 uniformGravity = Vec3(0, T(-9.8) * uniformMass, 0) + (HasExternal ? extForce : Vec3(T(0)));
+
+    {
+        PHYSICS_PHASE("forces");
+        // zero forces
+        for (size_t i = 0; i < layout.numMoving; i++) {
+            auto &mp = mpoints[i];
+            if (UniformMass) {
+                mp.force = uniformGravity;
+            } else {
+                mp.force = Vec3(0, T(-9.8) * mp.mass, 0);  // gravity
+                if (HasExternal) mp.force += extForce;
+            }
+        }
+    }
+
+    {
+        PHYSICS_PHASE("springs");
+        // spring forces
+        AccumulateSpringForces<P, Damping>(mpoints, springs, layout);
+    }
+
+    {
+        PHYSICS_PHASE("integrate");
+        // integrate (semi‑implicit Euler)
+        const T uniformStep = dt / uniformMass;
+        for (size_t i = 0; i < layout.numMoving; i++) {
+            auto &mp = mpoints[i];
+            T step = UniformMass ? uniformStep : dt / mp.mass;
+            T move = dt;
+            if (HasFixed) {
+                T freeMask = T(!mp.fixed);
+                step *= freeMask;
+                move *= freeMask;
+            }
+            Vec3 v = Vec3(mp.velocity) + step * mp.force;
+            mp.velocity = StorageVec3(v);
+            mp.position = StorageVec3(Vec3(mp.position) + move * v);
         }
     }
+}
+
+template <typename P, typename Springs = std::vector<SpringT<P>>>
+using UpdateKernel = void (*)(std::vector<MassPointT<P>> &, const Springs &, const StepLayout, const cy::Vec3f, float);
+
+template <typename P, typename Springs, int... I>
+inline UpdateKernel<P, Springs> SelectKernel(int index, std::integer_sequence<int, I...>) {
+    static const UpdateKernel<P, Springs> kernels[] = {
+        &PhysicsUpdateKernel<P, Springs, (I & 1) != 0, (I & 2) != 0, (I & 4) != 0, (I & 8) != 0>...
+    };
+    return kernels[index];
+}
+
+// This function uses an explicit integration method for updating the physics state.
+// The kernel matching the features is picked once, before any loop runs.
+template <typename P>
+inline void PhysicsUpdate(std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs, const StepLayout layout, StepFeatures features, const cy::Vec3f externalForce, float deltaTime) {
+    features.hasExternal = externalForce.x != 0 || externalForce.y != 0 || externalForce.z != 0;
+    UpdateKernel<P> kernel = SelectKernel<P, std::vector<SpringT<P>>>(features.Index(), std::make_integer_sequence<int, 16>());
+    kernel(mpoints, springs, layout, externalForce, deltaTime);
+}
+
+template <typename P>
+inline void PhysicsUpdate(std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs, StepFeatures features, const cy::Vec3f externalForce, float deltaTime) {
+    PhysicsUpdate(mpoints, springs, FullLayout(mpoints, springs), features, externalForce, deltaTime);
+}
+
+template <typename P>
+inline void PhysicsUpdate(std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs, const cy::Vec3f externalForce, float deltaTime) {
+    PhysicsUpdate(mpoints, springs, DetectFeatures(mpoints, springs), externalForce, deltaTime);
+}
+
+// One mass point per node, all free.
+template <typename P>
+inline std::vector<MassPointT<P>> MakeMassPoints(const std::vector<cy::Vec3f>& nodes, float mass) {
+    std::vector<MassPointT<P>> mpoints;
+    mpoints.reserve(nodes.size());
+    for (auto &p : nodes) {
+        MassPointT<P> mp;
+        mp.position = cy::Vec3<typename P::Storage>(p);
+        mp.mass     = mass;
+        mp.fixed    = false;
+        mpoints.push_back(mp);
+    }
+    return mpoints;
+}
+
+// Fixes the top `fraction` of the mass points along the y axis.
+template <typename P>
+inline void PinTop(std::vector<MassPointT<P>>& mpoints, float fraction) {
+    // first find min and max y
+    auto yMin = mpoints[0].position.y;
+    auto yMax = yMin;
+    for (auto &mp : mpoints) {
+        yMin = std::min(yMin, mp.position.y);
+        yMax = std::max(yMax, mp.position.y);
+    }
+    // cutoff: everything above (1–fraction) up from yMin → fix the top fraction
+    auto cutoff = yMin + (yMax - yMin)*(1 - fraction);
 
-    // integrate (semi‑implicit Euler)
     for (auto &mp : mpoints) {
-        if (mp.fixed) continue;
-        mp.velocity += (deltaTime/mp.mass) * mp.force;
-        mp.position += deltaTime * mp.velocity;
+        if (mp.position.y >= cutoff) {
+            mp.fixed = true;
+        }
+    }
+}
+
+// One spring per edge, with the rest length taken from the current positions.
+template <typename P>
+inline std::vector<SpringT<P>> BuildSprings(const std::vector<std::pair<int,int>>& edges, const std::vector<MassPointT<P>>& mpoints, float stiffness, float damping) {
+    std::vector<SpringT<P>> springs;
+    springs.reserve(edges.size());
+    for (auto &e : edges) {
+        SpringT<P> s;
+        s.a = e.first;
+        s.b = e.second;
+        s.restLength = (mpoints[s.a].position - mpoints[s.b].position).Length();
+        s.stiffness  = stiffness;
+        s.damping    = damping;
+        springs.push_back(s);
+    }
+    return springs;
+}
+
+// Persistent data for the implicit integrator. dv keeps the previous step's velocity
+// change, which is the initial guess for the next solve. The system is built and solved in P::Accum.
+template <typename P>
+struct ImplicitStateT {
+    using T = typename P::Accum;
+    Solver::PCG<T>           pcg;
+    bool                     assemble = false;  // assemble a CSR matrix instead of matrix-free products (IC0 always does)
+    Solver::CSRMatrix<T>     matrix;
+    std::vector<int>         springBlocks;      // per spring: offsets of blocks (a,a),(a,b),(b,a),(b,b) in their rows
+    std::vector<T>           dv;
+    std::vector<T>           rhs;
+    std::vector<T>           blocks;            // 3x3 diagonal blocks, 9 per node
+    std::vector<T>           springCoef;        // per spring: e.x, e.y, e.z, alpha, beta
+
+    // forces BuildSystemPattern to run again and drops the warm start, e.g. after points or
+    // springs were reordered
+    void ResetPattern() {
+        matrix.n = 0;
+        dv.clear();
+    }
+};
+
+using ImplicitState = ImplicitStateT<SimPrecision>;
+
+// Builds the CSR pattern of the 3n x 3n system: node i couples to itself and its spring neighbors.
+template <typename P>
+inline void BuildSystemPattern(size_t numPoints, const std::vector<SpringT<P>>& springs, ImplicitStateT<P>& state) {
+    using T = typename P::Accum;
+    const int n = int(numPoints);
+    std::vector<std::vector<int>> nbr(n);
+    for (int i = 0; i < n; i++) nbr[i].push_back(i);
+    for (auto &s : springs) {
+        nbr[s.a].push_back(s.b);
+        nbr[s.b].push_back(s.a);
+    }
+    for (auto &list : nbr) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    auto& A = state.matrix;
+    A.n = 3 * n;
+    A.rowStart.assign(A.n + 1, 0);
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++) A.rowStart[3*i + c + 1] = A.rowStart[3*i + c] + 3 * int(nbr[i].size());
+    }
+    A.col.resize(A.rowStart[A.n]);
+    A.val.assign(A.rowStart[A.n], T(0));
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++) {
+            int k = A.rowStart[3*i + c];
+            for (int j : nbr[i]) {
+                A.col[k++] = 3*j;
+                A.col[k++] = 3*j + 1;
+                A.col[k++] = 3*j + 2;
+            }
+        }
+    }
+
+    // block (i,j) starts at column offset 3*(position of j in nbr[i]) in each of node i's rows
+    auto blockOffset = [&](int i, int j) {
+        return 3 * int(std::lower_bound(nbr[i].begin(), nbr[i].end(), j) - nbr[i].begin());
+    };
+    state.springBlocks.resize(springs.size() * 4);
+    for (size_t si = 0; si < springs.size(); si++) {
+        const auto &s = springs[si];
+        state.springBlocks[4*si]     = blockOffset(s.a, s.a);
+        state.springBlocks[4*si + 1] = blockOffset(s.a, s.b);
+        state.springBlocks[4*si + 2] = blockOffset(s.b, s.a);
+        state.springBlocks[4*si + 3] = blockOffset(s.b, s.b);
+    }
+}
+
+// Linearized backward Euler: (M - h D - h^2 K) dv = h (f + h K v), solved with PCG.
+// Each spring contributes S = alpha e e^T + beta I to its diagonal blocks and -S off the diagonal,
+// where the transverse stiffness is clamped at zero so the system stays positive definite.
+// Fixed nodes are removed by giving them identity rows and a zero right-hand side.
+template <typename P>
+inline void PhysicsUpdateImplicit(std::vector<MassPointT<P>> & mpoints, const std::vector<SpringT<P>> & springs, const cy::Vec3f externalForce, float deltaTime, ImplicitStateT<P> & state) {
+    using T    = typename P::Accum;
+    using Vec3 = cy::Vec3<T>;
+    using StorageVec3 = cy::Vec3<typename P::Storage>;
+    const int n  = int(mpoints.size());
+    const int ns = int(springs.size());
+    const T h = deltaTime;
+
+    if (state.dv.size() != size_t(3 * n)) state.dv.assign(3 * n, T(0));
+    state.rhs.assign(3 * n, T(0));
+    state.blocks.assign(9 * n, T(0));
+    state.springCoef.resize(5 * ns);
+
+    auto addBlock = [](T* dst, const T* coef, T sign) {
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                dst[3*r + c] += sign * (coef[3] * coef[r] * coef[c] + (r == c ? coef[4] : T(0)));
+            }
+        }
+    };
+
+    {
+        PHYSICS_PHASE("springs");
+        // gravity and external forces
+        for (int i = 0; i < n; i++) {
+            const auto &mp = mpoints[i];
+            if (mp.fixed) continue;
+            Vec3 f = Vec3(0, T(-9.8) * mp.mass, 0) + Vec3(externalForce);
+            state.rhs[3*i] = h * f.x; state.rhs[3*i+1] = h * f.y; state.rhs[3*i+2] = h * f.z;
+        }
+
+        // per-spring linearization
+        #pragma omp parallel for schedule(static)
+        for (int si = 0; si < ns; si++) {
+            const auto &s = springs[si];
+            T* coef = &state.springCoef[5*si];
+            Vec3 dir = Vec3(mpoints[s.b].position) - Vec3(mpoints[s.a].position);
+            T len = dir.Length();
+            if (len <= 0) {
+                for (int k = 0; k < 5; k++) coef[k] = T(0);
+                continue;
+            }
+            Vec3 e = dir / len;
+            T kPerp = s.stiffness * std::max(T(0), 1 - s.restLength / len);
+            coef[0] = e.x; coef[1] = e.y; coef[2] = e.z;
+            coef[3] = h * s.damping + h * h * (s.stiffness - kPerp);
+            coef[4] = h * h * kPerp;
+        }
+
+        // spring forces and h^2 K v into the right-hand side
+        for (int si = 0; si < ns; si++) {
+            const auto &s = springs[si];
+            const T* coef = &state.springCoef[5*si];
+            const auto &A = mpoints[s.a];
+            const auto &B = mpoints[s.b];
+            Vec3 e(coef[0], coef[1], coef[2]);
+            Vec3 dir = Vec3(B.position) - Vec3(A.position);
+            T len = dir.Length();
+            if (len <= 0) continue;
+            Vec3 relVel = Vec3(B.velocity) - Vec3(A.velocity);
+            T fs = s.stiffness * (len - s.restLength) + s.damping * relVel.Dot(e);
+            // h^2 K (vb - va), using the same clamped stiffness as the system matrix
+            Vec3 kv = coef[4] * relVel + ((coef[3] - h * s.damping) * e.Dot(relVel)) * e;
+            Vec3 ba = (h * fs) * e + kv;
+            if (!A.fixed) { state.rhs[3*s.a] += ba.x; state.rhs[3*s.a+1] += ba.y; state.rhs[3*s.a+2] += ba.z; }
+            if (!B.fixed) { state.rhs[3*s.b] -= ba.x; state.rhs[3*s.b+1] -= ba.y; state.rhs[3*s.b+2] -= ba.z; }
+        }
+
+        // diagonal blocks: M plus S of every spring touching a free node
+        for (int i = 0; i < n; i++) {
+            T d = mpoints[i].fixed ? T(1) : mpoints[i].mass;
+            state.blocks[9*i] = state.blocks[9*i+4] = state.blocks[9*i+8] = d;
+        }
+        for (int si = 0; si < ns; si++) {
+            const auto &s = springs[si];
+            const T* coef = &state.springCoef[5*si];
+            if (!mpoints[s.a].fixed) addBlock(&state.blocks[9*s.a], coef, T(1));
+            if (!mpoints[s.b].fixed) addBlock(&state.blocks[9*s.b], coef, T(1));
+        }
+    }
+
+    {
+        PHYSICS_PHASE("solve");
+        const bool assemble = state.assemble || state.pcg.preconditioner == Solver::Preconditioner::IC0;
+        if (assemble) {
+            if (state.matrix.n != 3 * n || state.springBlocks.size() != size_t(4 * ns)) BuildSystemPattern(mpoints.size(), springs, state);
+            auto &A = state.matrix;
+            std::fill(A.val.begin(), A.val.end(), T(0));
+            for (int i = 0; i < n; i++) {
+                int self = A.Find(3*i, 3*i) - A.rowStart[3*i];
+                for (int r = 0; r < 3; r++) {
+                    for (int c = 0; c < 3; c++) A.val[A.rowStart[3*i + r] + self + c] = state.blocks[9*i + 3*r + c];
+                }
+            }
+            for (int si = 0; si < ns; si++) {
+                const auto &s = springs[si];
+                if (mpoints[s.a].fixed || mpoints[s.b].fixed) continue;
+                T block[9] = {};
+                addBlock(block, &state.springCoef[5*si], T(-1));
+                for (int r = 0; r < 3; r++) {
+                    for (int c = 0; c < 3; c++) {
+                        A.val[A.rowStart[3*s.a + r] + state.springBlocks[4*si + 1] + c] = block[3*r + c];
+                        A.val[A.rowStart[3*s.b + r] + state.springBlocks[4*si + 2] + c] = block[3*r + c];
+                    }
+                }
+            }
+            state.pcg.SetupFromMatrix(A);
+            state.pcg.Solve(A, state.rhs, state.dv);
+        } else {
+            state.pcg.SetupFromBlocks(state.blocks);
+            auto applyA = [&](const std::vector<T>& x, std::vector<T>& y) {
+                #pragma omp parallel for schedule(static)
+                for (int i = 0; i < n; i++) {
+                    T d = mpoints[i].fixed ? T(1) : mpoints[i].mass;
+                    y[3*i] = d * x[3*i]; y[3*i+1] = d * x[3*i+1]; y[3*i+2] = d * x[3*i+2];
+                }
+                for (int si = 0; si < ns; si++) {
+                    const auto &s = springs[si];
+                    const T* coef = &state.springCoef[5*si];
+                    bool freeA = !mpoints[s.a].fixed;
+                    bool freeB = !mpoints[s.b].fixed;
+                    // S (xa - xb), with the displacement of a fixed node taken as zero
+                    Vec3 xa = freeA ? Vec3(x[3*s.a], x[3*s.a+1], x[3*s.a+2]) : Vec3(T(0));
+                    Vec3 xb = freeB ? Vec3(x[3*s.b], x[3*s.b+1], x[3*s.b+2]) : Vec3(T(0));
+                    Vec3 e(coef[0], coef[1], coef[2]);
+                    Vec3 dx = xa - xb;
+                    Vec3 t = (coef[3] * e.Dot(dx)) * e + coef[4] * dx;
+                    if (freeA) { y[3*s.a] += t.x; y[3*s.a+1] += t.y; y[3*s.a+2] += t.z; }
+                    if (freeB) { y[3*s.b] -= t.x; y[3*s.b+1] -= t.y; y[3*s.b+2] -= t.z; }
+                }
+            };
+            state.pcg.Solve(applyA, state.rhs, state.dv);
+        }
+    }
+
+    {
+        PHYSICS_PHASE("integrate");
+        // integrate with the new velocities
+        for (int i = 0; i < n; i++) {
+            auto &mp = mpoints[i];
+            if (mp.fixed) continue;
+            Vec3 v = Vec3(mp.velocity) + Vec3(state.dv[3*i], state.dv[3*i+1], state.dv[3*i+2]);
+            mp.velocity = StorageVec3(v);
+            mp.position = StorageVec3(Vec3(mp.position) + h * v);
+        }
     }
 }
 
@@ -0,0 +1,61 @@
+#ifndef SCENESETUP_H
+#define SCENESETUP_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "Physics.h"
+
+// The hanging body every HW3 driver starts from (the app, the benchmark, the sweeps and the
+// tests): unit point masses at the nodes, the top third pinned and one spring per tetrahedron
+// edge, of a soft material unless told otherwise. Also the bounding box of a point set, which
+// places instances and quantizes cached positions.
+namespace SceneSetup {
+
+struct Material {
+    float stiffness;
+    float damping;
+};
+
+const Material Soft  = { 0.2f, 0.01f };    // the app's armadillo; never quite comes to rest
+const Material Stiff = { 100.0f, 2.0f };   // settles, for sleep and step control
+const float    PinFraction = 1.0f / 3.0f;
+
+template <typename P>
+struct Body {
+    std::vector<MassPointT<P>> mpoints;   // in node order
+    std::vector<SpringT<P>>    springs;
+};
+
+template <typename P>
+inline Body<P> MakeBody(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges,
+                        Material material = Soft, float pinFraction = PinFraction) {
+    Body<P> body;
+    body.mpoints = Physics::MakeMassPoints<P>(nodes, 1.0f);
+    Physics::PinTop(body.mpoints, pinFraction);
+    body.springs = Physics::BuildSprings(edges, body.mpoints, material.stiffness, material.damping);
+    return body;
+}
+
+struct Bounds {
+    cy::Vec3f min = cy::Vec3f(0.0f, 0.0f, 0.0f);
+    cy::Vec3f max = cy::Vec3f(0.0f, 0.0f, 0.0f);
+
+    cy::Vec3f Size() const { return max - min; }
+};
+
+// Axis-aligned bounds of points; zero for none.
+inline Bounds ComputeBounds(const std::vector<cy::Vec3f>& points) {
+    Bounds bounds;
+    if (points.empty()) return bounds;
+    bounds.min = bounds.max = points[0];
+    for (auto &p : points) {
+        bounds.min = cy::Vec3f(std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y), std::min(bounds.min.z, p.z));
+        bounds.max = cy::Vec3f(std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y), std::max(bounds.max.z, p.z));
+    }
+    return bounds;
+}
+
+} // namespace SceneSetup
+
+#endif // SCENESETUP_H
@@ -0,0 +1,208 @@
+#ifndef SLEEP_H
+#define SLEEP_H
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <vector>
+#include "ActiveSet.h"
+
+namespace Physics {
+
+// Kinetic energies here are per unit mass (half the mean squared speed), so the thresholds do
+// not depend on the point masses.
+struct SleepParams {
+    float energy     = 1e-3f;   // an island is calm below this
+    int   calmSteps  = 60;      // and falls asleep after this many calm steps in a row
+    float wakeFactor = 4.0f;    // a neighbour above wakeFactor * energy wakes it again
+    int   gridCells  = 4;       // islands per axis of the bounding box
+};
+
+// Consecutive calm steps of one body or island.
+struct SleepCounter {
+    int  calm   = 0;
+    bool asleep = false;
+
+    // Counts a step with the given energy; true when it should fall asleep now.
+    bool Update(float energy, const SleepParams& params) {
+        calm = energy < params.energy ? calm + 1 : 0;
+        return !asleep && calm >= params.calmSteps;
+    }
+};
+
+// Kinetic energy per unit mass of the free points in mpoints[begin, end).
+template <typename P>
+inline float MeanKineticEnergy(const std::vector<MassPointT<P>>& mpoints, size_t begin, size_t end) {
+    typename P::Accum energy = 0, mass = 0;
+    for (size_t i = begin; i < end; i++) {
+        if (mpoints[i].fixed) continue;
+        energy += typename P::Accum(mpoints[i].mass) * mpoints[i].velocity.LengthSquared();
+        mass   += mpoints[i].mass;
+    }
+    return mass > 0 ? float(0.5 * energy / mass) : 0.0f;
+}
+
+// Sleep for one large body, split into spatial islands (the cells of a coarse grid over the free
+// points of its rest shape). An island that stays calm falls asleep by fixing its free points
+// through the active set, so the step skips them like pins and a sleeping body costs nothing but
+// the energy check. Springs to awake neighbours keep acting on the neighbours only, as they do
+// for pinned points. A sleeping island wakes when a neighbour moves clearly faster than the calm
+// threshold, and a calm island waits while a neighbour moves that fast, so the two thresholds
+// keep islands at a boundary from flipping every few steps. All transitions of one step are
+// applied together with a single relayout of the active set. A pin change or an external force
+// should wake everything (WakeAll), and a pin change also rebuilds the islands (Build).
+template <typename P>
+struct SleepIslandsT {
+    SleepParams                   params;
+    std::vector<std::vector<int>> members;     // island -> original nodes
+    std::vector<std::vector<int>> neighbours;  // islands joined to it by a spring
+    std::vector<std::vector<int>> frozen;      // island -> nodes it fixed when it fell asleep
+    std::vector<SleepCounter>     counters;
+    std::vector<float>            energy;      // of the last step, 0 while asleep
+    std::vector<int>              islandOf;    // original node -> island or -1, derived from members
+    size_t                        numAsleep = 0;
+
+    size_t Size() const { return members.size(); }
+
+    // Splits the free points into islands; mpoints and springs are in the active-set layout of as.
+    // Pinned points belong to no island, so an all-pinned cell neither sleeps nor counts.
+    void Build(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs, const ActiveSetT<P>& as) {
+        using Vec3 = cy::Vec3<typename P::Storage>;
+        members.clear();
+        neighbours.clear();
+        islandOf.clear();
+        if (mpoints.empty()) return;
+        Vec3 boundMin = mpoints[0].position, boundMax = mpoints[0].position;
+        for (auto &mp : mpoints) {
+            for (int c = 0; c < 3; c++) {
+                boundMin[c] = std::min(boundMin[c], mp.position[c]);
+                boundMax[c] = std::max(boundMax[c], mp.position[c]);
+            }
+        }
+        std::map<std::tuple<int, int, int>, int> islandOfCell;
+        std::vector<int> islandOfSlot(mpoints.size(), -1);
+        for (size_t slot = 0; slot < mpoints.size(); slot++) {
+            if (mpoints[slot].fixed) continue;
+            int cell[3];
+            for (int c = 0; c < 3; c++) {
+                float extent = float(boundMax[c] - boundMin[c]);
+                float t = extent > 0 ? float(mpoints[slot].position[c] - boundMin[c]) / extent : 0.0f;
+                cell[c] = std::min(int(t * params.gridCells), params.gridCells - 1);
+            }
+            auto it = islandOfCell.emplace(std::make_tuple(cell[0], cell[1], cell[2]), int(members.size())).first;
+            if (it->second == int(members.size())) members.emplace_back();
+            members[it->second].push_back(as.nodeAt[slot]);
+            islandOfSlot[slot] = it->second;
+        }
+        neighbours.assign(members.size(), {});
+        for (auto &s : springs) {
+            int x = islandOfSlot[s.a], y = islandOfSlot[s.b];
+            if (x < 0 || y < 0 || x == y) continue;
+            neighbours[x].push_back(y);
+            neighbours[y].push_back(x);
+        }
+        for (auto &n : neighbours) {
+            std::sort(n.begin(), n.end());
+            n.erase(std::unique(n.begin(), n.end()), n.end());
+        }
+        frozen.assign(members.size(), {});
+        counters.assign(members.size(), SleepCounter());
+        energy.assign(members.size(), 0.0f);
+        numAsleep = 0;
+    }
+
+    // Measures the islands after a step, then puts calm ones to sleep and wakes the ones next to
+    // moving neighbours, all decided on the measured state and applied in one relayout. Returns
+    // true if the layout changed (points moved between free and fixed).
+    bool Update(std::vector<MassPointT<P>>& mpoints, std::vector<SpringT<P>>& springs, ActiveSetT<P>& as) {
+        using Accum = typename P::Accum;
+        if (islandOf.size() != as.slotOf.size()) {
+            islandOf.assign(as.slotOf.size(), -1);
+            for (size_t i = 0; i < Size(); i++) {
+                for (int node : members[i]) islandOf[node] = int(i);
+            }
+        }
+        // one pass over the free points in slot order; sleeping islands have none
+        sumEnergy.assign(Size(), Accum(0));
+        sumMass.assign(Size(), Accum(0));
+        for (size_t slot = 0; slot < as.numFree; slot++) {
+            int i = islandOf[as.nodeAt[slot]];
+            if (i < 0) continue;
+            const auto &mp = mpoints[slot];
+            sumEnergy[i] += Accum(mp.mass) * mp.velocity.LengthSquared();
+            sumMass[i] += mp.mass;
+        }
+        measured.assign(Size(), 0);
+        for (size_t i = 0; i < Size(); i++) {
+            if (counters[i].asleep) continue;
+            measured[i] = sumMass[i] > 0;
+            energy[i] = sumMass[i] > 0 ? float(0.5 * sumEnergy[i] / sumMass[i]) : 0.0f;
+        }
+        const float wakeEnergy = params.wakeFactor * params.energy;
+        auto movingNeighbour = [&](size_t i) {
+            for (int n : neighbours[i]) {
+                if (!counters[n].asleep && energy[n] > wakeEnergy) return true;
+            }
+            return false;
+        };
+        falling.clear();
+        waking.clear();
+        for (size_t i = 0; i < Size(); i++) {
+            if (counters[i].asleep) {
+                if (movingNeighbour(i)) waking.push_back(i);
+            } else if (measured[i] && counters[i].Update(energy[i], params) && !movingNeighbour(i)) {
+                falling.push_back(i);
+            }
+        }
+        if (falling.empty() && waking.empty()) return false;
+        for (size_t i : falling) Sleep(mpoints, as, i);
+        for (size_t i : waking) Wake(mpoints, as, i);
+        RelayoutActiveSet(mpoints, springs, as);
+        return true;
+    }
+
+    // Wakes every island; returns true if any was asleep.
+    bool WakeAll(std::vector<MassPointT<P>>& mpoints, std::vector<SpringT<P>>& springs, ActiveSetT<P>& as) {
+        if (numAsleep == 0) return false;
+        for (size_t i = 0; i < Size(); i++) {
+            if (counters[i].asleep) Wake(mpoints, as, i);
+        }
+        RelayoutActiveSet(mpoints, springs, as);
+        return true;
+    }
+
+private:
+    // scratch of Update, kept to avoid allocating every step
+    std::vector<typename P::Accum> sumEnergy, sumMass;   // per island: of m v^2 and of m over its free points
+    std::vector<char>              measured;   // awake with free points
+    std::vector<size_t>            falling, waking;
+
+    // Sleep and Wake only flip the fixed flags; the caller relayouts the active set after them.
+    void Sleep(std::vector<MassPointT<P>>& mpoints, const ActiveSetT<P>& as, size_t i) {
+        frozen[i].clear();
+        for (int node : members[i]) {
+            auto &mp = mpoints[as.slotOf[node]];
+            if (mp.fixed) continue;   // pinned, stays pinned
+            mp.fixed = true;
+            mp.velocity = cy::Vec3<typename P::Storage>(0, 0, 0);
+            frozen[i].push_back(node);
+        }
+        counters[i].asleep = true;
+        energy[i] = 0.0f;
+        numAsleep++;
+    }
+
+    // The velocities were zeroed when the island fell asleep, so it starts from rest.
+    void Wake(std::vector<MassPointT<P>>& mpoints, const ActiveSetT<P>& as, size_t i) {
+        for (int node : frozen[i]) mpoints[as.slotOf[node]].fixed = false;
+        frozen[i].clear();
+        counters[i] = SleepCounter();
+        numAsleep--;
+    }
+};
+
+using SleepIslands = SleepIslandsT<SimPrecision>;
+
+} // namespace Physics
+
+#endif // SLEEP_H
@@ -0,0 +1,336 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "cyMatrix.h"
+
+namespace Solver {
+
+// Square sparse matrix in compressed sparse row format.
+template <typename T>
+struct CSRMatrix {
+    int n = 0;                  // number of rows
+    std::vector<int> rowStart;  // n+1 offsets into col/val
+    std::vector<int> col;       // column of each entry, sorted within a row
+    std::vector<T>   val;
+
+    // y = A * x
+    void Multiply(const std::vector<T>& x, std::vector<T>& y) const {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++) {
+            T sum = 0;
+            for (int k = rowStart[i]; k < rowStart[i+1]; k++) sum += val[k] * x[col[k]];
+            y[i] = sum;
+        }
+    }
+
+    // index of entry (i,j) in val, or -1 if it is not part of the pattern
+    int Find(int i, int j) const {
+        auto first = col.begin() + rowStart[i];
+        auto last  = col.begin() + rowStart[i+1];
+        auto it = std::lower_bound(first, last, j);
+        return (it != last && *it == j) ? int(it - col.begin()) : -1;
+    }
+};
+
+enum class Preconditioner { Identity, Jacobi, BlockJacobi, IC0 };
+
+inline const char* PreconditionerName(Preconditioner p) {
+    switch (p) {
+        case Preconditioner::Jacobi:      return "Jacobi";
+        case Preconditioner::BlockJacobi: return "block-Jacobi";
+        case Preconditioner::IC0:         return "IC0";
+        default:                          return "none";
+    }
+}
+
+// Outcome of a single solve.
+struct SolveResult {
+    int    iterations = 0;
+    double residual   = 0.0;    // final ||r|| / ||b||
+    bool   converged  = false;
+};
+
+// Preconditioned conjugate gradient for symmetric positive definite systems.
+// Vectors are laid out as 3 scalars per node, so block-Jacobi works on 3x3 node blocks.
+template <typename T>
+class PCG {
+public:
+    Preconditioner preconditioner = Preconditioner::BlockJacobi;
+    int    maxIterations = 100;
+    double tolerance     = 1e-4;    // relative residual
+    bool   deterministic = false;   // reductions give the same bits for any number of threads
+
+    SolveResult lastResult;
+
+    // Builds the preconditioner from the 3x3 diagonal blocks of the operator (9 values per node).
+    // This is all a matrix-free operator can provide, so IC0 falls back to block-Jacobi here.
+    void SetupFromBlocks(const std::vector<T>& blocks) {
+        int nodes = int(blocks.size() / 9);
+        active = preconditioner == Preconditioner::IC0 ? Preconditioner::BlockJacobi : preconditioner;
+        if (active == Preconditioner::Jacobi) {
+            invDiag.resize(nodes * 3);
+            for (int i = 0; i < nodes; i++) {
+                for (int c = 0; c < 3; c++) {
+                    T d = blocks[9*i + 4*c];
+                    invDiag[3*i + c] = d != 0 ? T(1) / d : T(1);
+                }
+            }
+        } else if (active == Preconditioner::BlockJacobi) {
+            invBlocks.resize(blocks.size());
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < nodes; i++) {
+                InvertBlock(&blocks[9*i], &invBlocks[9*i]);
+            }
+        }
+    }
+
+    // Builds the preconditioner from an assembled matrix (full symmetric pattern).
+    void SetupFromMatrix(const CSRMatrix<T>& A) {
+        if (preconditioner != Preconditioner::IC0) {
+            std::vector<T> blocks((A.n / 3) * 9, T(0));
+            for (int i = 0; i < A.n; i++) {
+                int node = i / 3;
+                for (int k = A.rowStart[i]; k < A.rowStart[i+1]; k++) {
+                    int j = A.col[k];
+                    if (j / 3 == node) blocks[9*node + 3*(i%3) + (j%3)] = A.val[k];
+                }
+            }
+            SetupFromBlocks(blocks);
+            return;
+        }
+        active = Preconditioner::IC0;
+        FactorIC0(A);
+    }
+
+    // Solves A x = b. On entry x holds the initial guess, so passing last step's solution
+    // warm-starts the iteration; on exit it holds the solution.
+    // applyA(in, out) must compute out = A * in.
+    template <typename Op>
+    SolveResult Solve(Op applyA, const std::vector<T>& b, std::vector<T>& x) {
+        const int n = int(b.size());
+        x.resize(n, T(0));
+        r.resize(n); z.resize(n); p.resize(n); q.resize(n);
+
+        SolveResult result;
+
+        // r = b - A x
+        applyA(x, q);
+        double bb = 0.0;
+        Reduce<1>(n, &bb, [&](int i, double* sum) {
+            r[i] = b[i] - q[i];
+            sum[0] += double(b[i]) * b[i];
+        });
+        if (bb == 0.0) {
+            std::fill(x.begin(), x.end(), T(0));
+            result.converged = true;
+            lastResult = result;
+            return result;
+        }
+
+        double rr = 0.0;
+        double rz = Precondition(rr, [](int) {});
+        p = z;
+
+        const double threshold = tolerance * tolerance * bb;
+        int it = 0;
+        while (rr > threshold && it < maxIterations) {
+            applyA(p, q);
+            double pq = Dot(p, q);
+            if (pq <= 0.0) break;   // operator is not positive definite along p
+
+            T alpha = T(rz / pq);
+            // x += alpha p and r -= alpha q row by row inside the z = M^-1 r pass
+            double rzNew = Precondition(rr, [&](int i) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+            });
+
+            T beta = T(rzNew / rz);
+            rz = rzNew;
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; i++) p[i] = z[i] + beta * p[i];
+            it++;
+        }
+
+        result.iterations = it;
+        result.residual   = std::sqrt(rr / bb);
+        result.converged  = rr <= threshold;
+        lastResult = result;
+        return result;
+    }
+
+    SolveResult Solve(const CSRMatrix<T>& A, const std::vector<T>& b, std::vector<T>& x) {
+        return Solve([&A](const std::vector<T>& in, std::vector<T>& out) { A.Multiply(in, out); }, b, x);
+    }
+
+private:
+    Preconditioner active = Preconditioner::Identity;   // what was actually built
+    std::vector<T> invDiag;     // Jacobi
+    std::vector<T> invBlocks;   // block-Jacobi, 9 per node
+    CSRMatrix<T>   L;           // IC0 lower triangular factor, diagonal last in each row
+    std::vector<T> r, z, p, q;
+    std::vector<double> partials;   // per-block sums of deterministic reductions
+
+    static const int REDUCE_BLOCK = 2048;
+
+    // Runs body(i, sums) for i in [0, n) and adds the K sums it accumulates into result.
+    // OpenMP combines per-thread sums in whatever order threads finish, so the last bits depend
+    // on the thread count and timing. In deterministic mode the range is cut into fixed blocks
+    // instead, each summed in index order, and the block sums are added in block order.
+    template <int K, typename Body>
+    void Reduce(int n, double* result, Body body) {
+        if (!deterministic) {
+            #pragma omp parallel
+            {
+                double local[K] = {};
+                #pragma omp for schedule(static) nowait
+                for (int i = 0; i < n; i++) body(i, local);
+                #pragma omp critical
+                for (int k = 0; k < K; k++) result[k] += local[k];
+            }
+            return;
+        }
+        const int numBlocks = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+        partials.assign(size_t(numBlocks) * K, 0.0);
+        #pragma omp parallel for schedule(static)
+        for (int blk = 0; blk < numBlocks; blk++) {
+            double* local = &partials[size_t(blk) * K];
+            const int end = std::min(n, (blk + 1) * REDUCE_BLOCK);
+            for (int i = blk * REDUCE_BLOCK; i < end; i++) body(i, local);
+        }
+        for (int blk = 0; blk < numBlocks; blk++) {
+            for (int k = 0; k < K; k++) result[k] += partials[size_t(blk) * K + k];
+        }
+    }
+
+    double Dot(const std::vector<T>& a, const std::vector<T>& b) {
+        double sum = 0.0;
+        Reduce<1>(int(a.size()), &sum, [&](int i, double* acc) { acc[0] += double(a[i]) * b[i]; });
+        return sum;
+    }
+
+    static void InvertBlock(const T* m, T* inv) {
+        cy::Matrix3<T> block(m);
+        if (std::abs(block.GetDeterminant()) > T(1e-12)) {
+            cy::Matrix3<T> bi = block.GetInverse();
+            for (int k = 0; k < 9; k++) inv[k] = bi.cell[k];
+        } else {
+            // singular block, fall back to its diagonal
+            for (int k = 0; k < 9; k++) inv[k] = T(0);
+            for (int c = 0; c < 3; c++) inv[4*c] = m[4*c] != 0 ? T(1) / m[4*c] : T(1);
+        }
+    }
+
+    // z = M^-1 r; also returns r.z and writes r.r, in a single pass where possible.
+    // update(i) is called for each row just before r[i] is read, so the CG update of x and r
+    // rides along instead of taking a pass of its own.
+    template <typename Update>
+    double Precondition(double& rr, Update update) {
+        const int n = int(r.size());
+        double sums[2] = { 0.0, 0.0 };
+        switch (active) {
+            case Preconditioner::Jacobi:
+                Reduce<2>(n, sums, [&](int i, double* acc) {
+                    update(i);
+                    z[i] = invDiag[i] * r[i];
+                    acc[0] += double(r[i]) * r[i];
+                    acc[1] += double(r[i]) * z[i];
+                });
+                break;
+            case Preconditioner::BlockJacobi:
+                Reduce<2>(n / 3, sums, [&](int node, double* acc) {
+                    const T* m = &invBlocks[9*node];
+                    const T* ri = &r[3*node];
+                    T* zi = &z[3*node];
+                    for (int c = 0; c < 3; c++) update(3*node + c);
+                    for (int c = 0; c < 3; c++) {
+                        zi[c] = m[3*c] * ri[0] + m[3*c+1] * ri[1] + m[3*c+2] * ri[2];
+                        acc[0] += double(ri[c]) * ri[c];
+                        acc[1] += double(ri[c]) * zi[c];
+                    }
+                });
+                break;
+            case Preconditioner::IC0:
+                SolveIC0(update);
+                Reduce<2>(n, sums, [&](int i, double* acc) {
+                    acc[0] += double(r[i]) * r[i];
+                    acc[1] += double(r[i]) * z[i];
+                });
+                break;
+            default:
+                Reduce<1>(n, sums, [&](int i, double* acc) {
+                    update(i);
+                    z[i] = r[i];
+                    acc[0] += double(r[i]) * r[i];
+                });
+                sums[1] = sums[0];
+                break;
+        }
+        rr = sums[0];
+        return sums[1];
+    }
+
+    // Incomplete Cholesky with zero fill-in: L has the lower triangular pattern of A.
+    void FactorIC0(const CSRMatrix<T>& A) {
+        L.n = A.n;
+        L.rowStart.assign(A.n + 1, 0);
+        L.col.clear();
+        L.val.clear();
+        for (int i = 0; i < A.n; i++) {
+            for (int k = A.rowStart[i]; k < A.rowStart[i+1]; k++) {
+                if (A.col[k] > i) break;
+                L.col.push_back(A.col[k]);
+                L.val.push_back(A.val[k]);
+            }
+            L.rowStart[i+1] = int(L.col.size());
+        }
+
+        for (int i = 0; i < L.n; i++) {
+            const int start = L.rowStart[i];
+            const int diag  = L.rowStart[i+1] - 1;
+            for (int k = start; k < diag; k++) {
+                int j = L.col[k];
+                // subtract sum over m < j of L_im * L_jm, merging the two sorted rows
+                double s = L.val[k];
+                int a = start, b = L.rowStart[j];
+                const int bEnd = L.rowStart[j+1] - 1;
+                while (a < k && b < bEnd) {
+                    if (L.col[a] == L.col[b]) s -= double(L.val[a++]) * L.val[b++];
+                    else if (L.col[a] < L.col[b]) a++;
+                    else b++;
+                }
+                L.val[k] = T(s / L.val[bEnd]);
+            }
+            double d = L.val[diag];
+            for (int k = start; k < diag; k++) d -= double(L.val[k]) * L.val[k];
+            // breakdown: keep the original diagonal so the factor stays usable
+            if (d <= 0.0) d = std::abs(double(A.val[A.Find(i, i)]));
+            L.val[diag] = T(std::sqrt(d));
+        }
+    }
+
+    // z = (L L^T)^-1 r by forward and backward substitution; update(i) as in Precondition
+    template <typename Update>
+    void SolveIC0(Update update) {
+        const int n = L.n;
+        for (int i = 0; i < n; i++) {
+            update(i);
+            double s = r[i];
+            const int diag = L.rowStart[i+1] - 1;
+            for (int k = L.rowStart[i]; k < diag; k++) s -= double(L.val[k]) * z[L.col[k]];
+            z[i] = T(s / L.val[diag]);
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            const int diag = L.rowStart[i+1] - 1;
+            z[i] /= L.val[diag];
+            for (int k = L.rowStart[i]; k < diag; k++) z[L.col[k]] -= L.val[k] * z[i];
+        }
+    }
+};
+
+} // namespace Solver
+
+#endif // SOLVER_H
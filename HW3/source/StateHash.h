@@ -0,0 +1,143 @@
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Physics.h"
+
+// Per-step fingerprints of the particle state, for comparing two runs frame by frame.
+// Hash() is XXH64 (seed 0) of every point's position and velocity in slot order, so any bit
+// that differs shows up in the step where it first appears. Run both sides in deterministic
+// mode with the same fixed step, then diff their logs; the first differing line is where the
+// runs diverged.
+namespace StateHash {
+
+// Streaming XXH64.
+class Hasher {
+public:
+    explicit Hasher(uint64_t seed = 0) : total(0), buffered(0) {
+        v[0] = seed + P1 + P2;
+        v[1] = seed + P2;
+        v[2] = seed;
+        v[3] = seed - P1;
+    }
+
+    void Update(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        total += size;
+        if (buffered + size < 32) {
+            std::memcpy(buffer + buffered, p, size);
+            buffered += size;
+            return;
+        }
+        if (buffered > 0) {
+            size_t fill = 32 - buffered;
+            std::memcpy(buffer + buffered, p, fill);
+            Stripe(buffer);
+            p += fill;
+            size -= fill;
+            buffered = 0;
+        }
+        for (; size >= 32; p += 32, size -= 32) Stripe(p);
+        std::memcpy(buffer, p, size);
+        buffered = size;
+    }
+
+    uint64_t Digest() const {
+        uint64_t h;
+        if (total >= 32) {
+            h = Rotl(v[0], 1) + Rotl(v[1], 7) + Rotl(v[2], 12) + Rotl(v[3], 18);
+            for (int k = 0; k < 4; k++) h = (h ^ Round(0, v[k])) * P1 + P4;
+        } else {
+            h = v[2] + P5;  // the seed
+        }
+        h += total;
+        const uint8_t* p = buffer;
+        size_t left = buffered;
+        for (; left >= 8; p += 8, left -= 8) h = Rotl(h ^ Round(0, Read64(p)), 27) * P1 + P4;
+        if (left >= 4) {
+            uint32_t w;
+            std::memcpy(&w, p, 4);
+            h = Rotl(h ^ (uint64_t(w) * P1), 23) * P2 + P3;
+            p += 4;
+            left -= 4;
+        }
+        for (; left > 0; p++, left--) h = Rotl(h ^ (*p * P5), 11) * P1;
+        h ^= h >> 33; h *= P2;
+        h ^= h >> 29; h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const uint64_t P1 = 0x9E3779B185EBCA87ull;
+    static const uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    static const uint64_t P3 = 0x165667B19E3779F9ull;
+    static const uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+    static const uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t v[4];
+    uint64_t total;
+    uint8_t  buffer[32];
+    size_t   buffered;
+
+    static uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t Round(uint64_t acc, uint64_t input) { return Rotl(acc + input * P2, 31) * P1; }
+    static uint64_t Read64(const uint8_t* p) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        return w;
+    }
+
+    void Stripe(const uint8_t* p) {
+        for (int k = 0; k < 4; k++) v[k] = Round(v[k], Read64(p + 8*k));
+    }
+};
+
+template <typename P>
+inline uint64_t Hash(const std::vector<MassPointT<P>>& mpoints) {
+    Hasher hasher;
+    for (const auto &mp : mpoints) {
+        hasher.Update(&mp.position, sizeof(mp.position));
+        hasher.Update(&mp.velocity, sizeof(mp.velocity));
+    }
+    return hasher.Digest();
+}
+
+// One line per step: step number, simulated time and state hash.
+class Log {
+public:
+    ~Log() { Close(); }
+
+    bool Open(const std::string& fileName) {
+        Close();
+        file = std::fopen(fileName.c_str(), "w");
+        if (!file) {
+            std::cerr << "Cannot open hash log " << fileName << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+
+    void Write(uint64_t step, double time, uint64_t hash) {
+        if (!file) return;
+        std::fprintf(file, "%llu %.17g %016llx\n", (unsigned long long)step, time, (unsigned long long)hash);
+    }
+
+    void Close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    std::FILE* file = nullptr;
+};
+
+} // namespace StateHash
+
+#endif // STATEHASH_H
@@ -0,0 +1,195 @@
+#ifndef STEPCONTROL_H
+#define STEPCONTROL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "Physics.h"
+
+// Adaptive time stepping for integrators that work on the mass points in place. Each frame's
+// time is covered by substeps whose size is the smallest of
+//   - the stability limit of the explicit step, from the springs' stiffness and damping per mass,
+//   - a CFL bound: no point moves more than a fraction of the shortest spring per step,
+//   - the error controller's proposal,
+// clamped to [dtMin, dtMax]. The local error is estimated from the step itself: the position
+// update differs from a forward Euler step by dt * dv, so 0.5 * dt * |dv| is the error of the
+// lower order pair. A substep over the tolerance (or with a non-finite state) is rolled back and
+// retried smaller; accepted ones grow the next proposal. The substeps end exactly at the end of the
+// frame: the last one is clamped to the time left, and when less than two proposals are left the
+// rest is split in two equal halves, so no sliver of a step is taken (nor any time carried over to
+// the next frame, which would make the motion lag and stutter). The tolerance and the CFL bound
+// are relative to the median spring length, so they fit any mesh scale (the shortest spring would
+// let a few sliver tetrahedra decide).
+namespace StepControl {
+
+struct Params {
+    float dtMin       = 1e-4f;
+    float dtMax       = 0.1f;
+    float safety      = 0.9f;     // on the stability limit and the error proposal
+    float cfl         = 0.25f;    // largest move per step, in median rest lengths
+    float tolerance   = 0.01f;    // local position error per step, in median rest lengths
+    float maxGrow     = 2.0f;
+    float minShrink   = 0.2f;
+    int   maxSubsteps = 32;       // per frame; the rest of the frame's time is dropped
+};
+
+// Bounds that follow from the springs alone; recompute when pins, masses or springs change.
+struct Limits {
+    float stable  = std::numeric_limits<float>::infinity();   // explicit stability limit
+    float length  = 1.0f;                                     // median rest length of the springs of free points
+};
+
+// Per free point, the Gershgorin bound on the spring stiffness matrix gives w^2 <= 2 sum(k) / m,
+// and the damping ratio x = sum(c) / (m w). Symplectic Euler on a damped oscillator is stable for
+// dt <= (2 / w) (sqrt(1 + x^2) - x); the smallest over all points bounds the whole system.
+template <typename P>
+inline Limits ComputeLimits(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs) {
+    std::vector<double> stiffness(mpoints.size(), 0.0), damping(mpoints.size(), 0.0);
+    std::vector<float> lengths;
+    Limits limits;
+    for (auto &s : springs) {
+        if (mpoints[s.a].fixed && mpoints[s.b].fixed) continue;
+        for (int end : { s.a, s.b }) {
+            stiffness[end] += s.stiffness;
+            damping[end]   += s.damping;
+        }
+        lengths.push_back(float(s.restLength));
+    }
+    if (!lengths.empty()) {
+        std::nth_element(lengths.begin(), lengths.begin() + lengths.size() / 2, lengths.end());
+        limits.length = lengths[lengths.size() / 2];
+    }
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        if (mpoints[i].fixed || stiffness[i] <= 0) continue;
+        double w = std::sqrt(2.0 * stiffness[i] / mpoints[i].mass);
+        double x = damping[i] / (mpoints[i].mass * w);
+        limits.stable = std::min(limits.stable, float(2.0 / w * (std::sqrt(1.0 + x * x) - x)));
+    }
+    return limits;
+}
+
+// Which bound set the last substep.
+enum class Bound { Error, Stability, Speed, Minimum };
+
+inline const char* BoundName(Bound b) {
+    switch (b) {
+        case Bound::Error:     return "error";
+        case Bound::Stability: return "stability";
+        case Bound::Speed:     return "speed";
+        case Bound::Minimum:   return "minimum";
+    }
+    return "";
+}
+
+template <typename P>
+class ControllerT {
+public:
+    using Vec3 = cy::Vec3<typename P::Storage>;
+
+    Params params;
+    Limits limits;
+    float  dt      = 1.0f / 60.0f;   // proposal for the next substep
+    // statistics of the last Advance
+    int    substeps  = 0;
+    int    rejected  = 0;
+    float  lastError = 0.0f;
+    Bound  bound     = Bound::Error;
+
+    void SetLimits(const Limits& l) { limits = l; }
+
+    // Steps mpoints[0, numMoving) over frameTime with step(h), which advances the points by h.
+    // unstable: the integrator has an explicit stability limit (false for implicit Euler).
+    // Returns the simulated time covered: frameTime, unless the substeps ran out or a step could
+    // not be made acceptable at dtMin, in which case the rest of the frame is dropped.
+    template <typename Step>
+    float Advance(std::vector<MassPointT<P>>& mpoints, size_t numMoving, bool unstable, float frameTime, Step step) {
+        substeps = rejected = 0;
+        maxSpeed2 = -1.0f;   // the points may have been changed since the last frame
+        float covered = 0.0f;
+        while (substeps < params.maxSubsteps) {
+            float left = frameTime - covered;
+            if (left <= 1e-6f * frameTime) break;
+            float h = Propose(mpoints, numMoving, unstable);
+            bool clamped = 2.0f * h > left;
+            if (h >= left) h = left;
+            else if (clamped) h = 0.5f * left;
+            Save(mpoints, numMoving);
+            step(h);
+            const float tolerance = params.tolerance * limits.length;
+            float error = Error(mpoints, numMoving, h);
+            lastError = error;
+            if (!(error <= tolerance) && (h > params.dtMin || !std::isfinite(error))) {
+                Restore(mpoints, numMoving);
+                maxSpeed2 = -1.0f;
+                rejected++;
+                if (h <= params.dtMin || rejected > params.maxSubsteps) break;
+                dt = std::max(h * std::max(params.safety * std::sqrt(tolerance / error), params.minShrink), params.dtMin);
+                continue;
+            }
+            float factor = error > 0 ? params.safety * std::sqrt(tolerance / error) : params.maxGrow;
+            float next = h * std::min(factor, params.maxGrow);
+            covered += h;
+            substeps++;
+            // a step shortened to fit the frame says nothing about growing the proposal
+            dt = std::clamp(clamped ? std::min(dt, next) : next, params.dtMin, params.dtMax);
+        }
+        return covered;
+    }
+
+private:
+    std::vector<Vec3> position, velocity;   // rollback copy of the last substep
+    float maxSpeed2 = -1.0f;                // of the current state, measured by Error; < 0 if unknown
+
+    float Propose(const std::vector<MassPointT<P>>& mpoints, size_t numMoving, bool unstable) {
+        float h = dt;
+        bound = Bound::Error;
+        if (unstable && params.safety * limits.stable < h) { h = params.safety * limits.stable; bound = Bound::Stability; }
+        if (maxSpeed2 < 0) {
+            maxSpeed2 = 0.0f;
+            for (size_t i = 0; i < numMoving; i++) maxSpeed2 = std::max(maxSpeed2, float(mpoints[i].velocity.LengthSquared()));
+        }
+        if (maxSpeed2 > 0) {
+            float speedLimit = params.cfl * limits.length / std::sqrt(maxSpeed2);
+            if (speedLimit < h) { h = speedLimit; bound = Bound::Speed; }
+        }
+        if (h < params.dtMin) { h = params.dtMin; bound = Bound::Minimum; }
+        return std::min(h, params.dtMax);
+    }
+
+    void Save(const std::vector<MassPointT<P>>& mpoints, size_t numMoving) {
+        position.resize(numMoving);
+        velocity.resize(numMoving);
+        for (size_t i = 0; i < numMoving; i++) {
+            position[i] = mpoints[i].position;
+            velocity[i] = mpoints[i].velocity;
+        }
+    }
+
+    void Restore(std::vector<MassPointT<P>>& mpoints, size_t numMoving) const {
+        for (size_t i = 0; i < numMoving; i++) {
+            mpoints[i].position = position[i];
+            mpoints[i].velocity = velocity[i];
+        }
+    }
+
+    // largest 0.5 * h * |dv|, infinite if the step produced a non-finite velocity; also takes the
+    // largest speed for the next proposal
+    float Error(const std::vector<MassPointT<P>>& mpoints, size_t numMoving, float h) {
+        float maxDv2 = 0.0f, speed2 = 0.0f;
+        for (size_t i = 0; i < numMoving; i++) {
+            float dv2 = float((mpoints[i].velocity - velocity[i]).LengthSquared());
+            if (!std::isfinite(dv2)) return std::numeric_limits<float>::infinity();
+            maxDv2 = std::max(maxDv2, dv2);
+            speed2 = std::max(speed2, float(mpoints[i].velocity.LengthSquared()));
+        }
+        maxSpeed2 = speed2;
+        return 0.5f * h * std::sqrt(maxDv2);
+    }
+};
+
+using Controller = ControllerT<SimPrecision>;
+
+} // namespace StepControl
+
+#endif // STEPCONTROL_H
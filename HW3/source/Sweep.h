@@ -0,0 +1,287 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Physics.h"
+#include "SceneSetup.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Headless parameter sweeps. A spec lists values per parameter; every combination runs once,
+// one simulation per worker thread, and each finished run becomes a row of the results table.
+//
+// Spec file, one parameter per line, '#' starts a comment:
+//   mesh        armadillo_50k_tet dragon_8kface.1     (.node/.ele pair in the working directory)
+//   stiffness   0.1 0.2 0.4
+//   damping     0.01
+//   dt          0.0166667 0.00833333
+//   pin         0.333333                              (fraction of the height pinned at the top)
+//   integrator  explicit implicit
+//   duration    5                                     (simulated seconds, one value)
+// Parameters left out keep the values the interactive app uses.
+namespace Sweep {
+
+struct RunParams {
+    std::string mesh        = "armadillo_50k_tet";
+    float       stiffness   = 0.2f;
+    float       damping     = 0.01f;
+    float       dt          = 1.0f / 60.0f;
+    float       pinFraction = 1.0f / 3.0f;
+    bool        implicit    = false;
+    float       duration    = 5.0f;
+
+    int Steps() const { return std::max(1, int(std::lround(duration / dt))); }
+};
+
+struct Spec {
+    std::vector<std::string> meshes      = { "armadillo_50k_tet" };
+    std::vector<float>       stiffness   = { 0.2f };
+    std::vector<float>       damping     = { 0.01f };
+    std::vector<float>       dt          = { 1.0f / 60.0f };
+    std::vector<float>       pinFraction = { 1.0f / 3.0f };
+    std::vector<bool>        implicit    = { false };
+    float                    duration    = 5.0f;
+
+    // Every combination, mesh varying slowest.
+    std::vector<RunParams> Expand() const {
+        std::vector<RunParams> runs;
+        for (auto &mesh : meshes)
+        for (float k : stiffness)
+        for (float c : damping)
+        for (float h : dt)
+        for (float pin : pinFraction)
+        for (bool imp : implicit) {
+            RunParams r;
+            r.mesh = mesh; r.stiffness = k; r.damping = c; r.dt = h; r.pinFraction = pin; r.implicit = imp;
+            r.duration = duration;
+            runs.push_back(r);
+        }
+        return runs;
+    }
+};
+
+inline bool LoadSpec(const std::string& fileName, Spec& spec) {
+    std::ifstream in(fileName);
+    if (!in) {
+        std::cerr << "Cannot open sweep spec " << fileName << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string key, value;
+        if (!(words >> key)) continue;
+        std::vector<std::string> values;
+        while (words >> value) values.push_back(value);
+        if (values.empty()) {
+            std::cerr << fileName << ":" << lineNumber << ": no values for " << key << std::endl;
+            return false;
+        }
+        auto numbers = [&](std::vector<float>& out) {
+            out.clear();
+            for (auto &v : values) out.push_back(std::stof(v));
+        };
+        try {
+            if (key == "mesh") spec.meshes = values;
+            else if (key == "stiffness") numbers(spec.stiffness);
+            else if (key == "damping") numbers(spec.damping);
+            else if (key == "dt") numbers(spec.dt);
+            else if (key == "pin") numbers(spec.pinFraction);
+            else if (key == "duration") spec.duration = std::stof(values[0]);
+            else if (key == "integrator") {
+                spec.implicit.clear();
+                for (auto &v : values) {
+                    if (v != "explicit" && v != "implicit") throw std::invalid_argument(v);
+                    spec.implicit.push_back(v == "implicit");
+                }
+            } else {
+                std::cerr << fileName << ":" << lineNumber << ": unknown parameter " << key << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << fileName << ":" << lineNumber << ": bad value for " << key << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// A mesh loaded once and shared read-only by all runs that use it.
+struct Mesh {
+    std::vector<cy::Vec3f>           nodes;
+    std::vector<std::pair<int,int>>  edges;
+};
+
+struct RunResult {
+    RunParams params;
+    int       steps = 0;            // steps taken; fewer than params.Steps() if the run blew up
+    bool      stable = true;        // all positions stayed finite
+    double    maxDisplacement = 0;  // largest distance of any node from its start, over all steps
+    double    energyStart = 0;
+    double    energyEnd = 0;
+    double    energyDrift = 0;      // (end - start) / start
+    double    wallMs = 0;
+    int       worker = 0;
+};
+
+// Kinetic + spring + gravitational energy; heights are measured from the lowest node at rest
+// (groundY), so the total starts positive and the relative drift is meaningful.
+template <typename P>
+inline double Energy(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs, double groundY) {
+    double energy = 0.0;
+    for (auto &mp : mpoints) {
+        energy += 0.5 * double(mp.mass) * double(mp.velocity.Dot(mp.velocity));
+        energy += 9.8 * double(mp.mass) * (double(mp.position.y) - groundY);
+    }
+    for (auto &s : springs) {
+        double stretch = double((mpoints[s.b].position - mpoints[s.a].position).Length()) - double(s.restLength);
+        energy += 0.5 * double(s.stiffness) * stretch * stretch;
+    }
+    return energy;
+}
+
+// One run, on the calling thread only.
+template <typename P>
+inline RunResult Simulate(const RunParams& params, const Mesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges, { params.stiffness, params.damping }, params.pinFraction);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    Physics::ImplicitStateT<P> implicitState;
+    const cy::Vec3f externalForce(0.0f, 0.0f, 0.0f);
+
+    double groundY = mpoints[0].position.y;
+    for (auto &mp : mpoints) groundY = std::min(groundY, double(mp.position.y));
+    std::vector<cy::Vec3<typename P::Storage>> rest;
+    for (auto &mp : mpoints) rest.push_back(mp.position);
+
+    RunResult result;
+    result.params      = params;
+    result.energyStart = Energy(mpoints, springs, groundY);
+    const int steps = params.Steps();
+    for (int i = 0; i < steps && result.stable; i++) {
+        if (params.implicit) {
+            Physics::PhysicsUpdateImplicit(mpoints, springs, externalForce, params.dt, implicitState);
+        } else {
+            Physics::PhysicsUpdate(mpoints, springs, features, externalForce, params.dt);
+        }
+        result.steps++;
+        double maxSq = 0.0;
+        for (size_t n = 0; n < mpoints.size(); n++) {
+            maxSq = std::max(maxSq, double((mpoints[n].position - rest[n]).LengthSquared()));
+        }
+        if (!std::isfinite(maxSq)) result.stable = false;
+        else result.maxDisplacement = std::max(result.maxDisplacement, std::sqrt(maxSq));
+    }
+    result.energyEnd   = result.stable ? Energy(mpoints, springs, groundY) : NAN;
+    result.energyDrift = (result.energyEnd - result.energyStart) / result.energyStart;
+    result.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Runs job(index, worker) for every index in [0, count) on a fixed set of threads.
+// Each worker owns a deque of indices and takes from its front; a worker whose deque is empty
+// steals from the back of another's, so a few long runs cannot leave the other workers idle.
+// No job adds jobs, so a worker that finds every deque empty is done.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int workers) : queues(std::max(1, workers)) {}
+
+    int Workers() const { return int(queues.size()); }
+    size_t Steals() const { return steals; }
+
+    // Indices are dealt round-robin in the given order, so put the most expensive first.
+    template <typename Job>
+    void Run(const std::vector<size_t>& order, Job job) {
+        for (size_t i = 0; i < order.size(); i++) queues[i % queues.size()].items.push_back(order[i]);
+        std::vector<std::thread> threads;
+        for (int w = 0; w < Workers(); w++) {
+            threads.emplace_back([this, w, &job] {
+#ifdef _OPENMP
+                omp_set_num_threads(1);  // one simulation per core; the kernels would oversubscribe otherwise
+#endif
+                size_t index;
+                while (Take(w, index)) job(index, w);
+            });
+        }
+        for (auto &t : threads) t.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex         mutex;
+        std::deque<size_t> items;
+    };
+    std::vector<Queue>  queues;
+    std::atomic<size_t> steals{0};
+
+    bool Take(int worker, size_t& index) {
+        {
+            Queue &own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.items.empty()) {
+                index = own.items.front();
+                own.items.pop_front();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue &victim = queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.items.empty()) {
+                index = victim.items.back();
+                victim.items.pop_back();
+                steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Results table, one CSV row per run, flushed as each run finishes.
+class ResultsTable {
+public:
+    bool Open(const std::string& fileName) {
+        out.open(fileName);
+        if (!out) {
+            std::cerr << "Cannot open results file " << fileName << std::endl;
+            return false;
+        }
+        out << "mesh,stiffness,damping,dt,pin,integrator,steps,stable,max_displacement,energy_start,energy_end,energy_drift,wall_ms,worker\n";
+        out.flush();
+        return true;
+    }
+
+    void Write(const RunResult& r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const RunParams &p = r.params;
+        out << p.mesh << "," << p.stiffness << "," << p.damping << "," << p.dt << "," << p.pinFraction << ","
+            << (p.implicit ? "implicit" : "explicit") << "," << r.steps << "," << (r.stable ? 1 : 0) << ","
+            << r.maxDisplacement << "," << r.energyStart << "," << r.energyEnd << "," << r.energyDrift << ","
+            << r.wallMs << "," << r.worker << "\n";
+        out.flush();
+    }
+
+private:
+    std::mutex    mutex;
+    std::ofstream out;
+};
+
+} // namespace Sweep
+
+#endif // SWEEP_H
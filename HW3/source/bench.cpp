@@ -0,0 +1,792 @@
+// Headless benchmark for the HW3 mass-spring simulation.
+// precision: runs the armadillo with each scalar policy and reports time per step and
+//            drift from the double-precision run, plus hardware counters per physics phase
+//            (cycles, instructions, LLC misses, branch misses) where the machine exposes them.
+// codec:     records the armadillo into a compressed cache, decodes it back and checks
+//            every coordinate against the error bound; reports size and speed.
+// determinism: runs the implicit solver in float and double with 1, 2 and 4 threads and
+//            compares the per-step state hashes; deterministic runs must match bit for bit.
+// instances: steps 1, 4 and 16 armadillos sharing one topology; reports time per step and
+//            the memory each instance adds.
+// ensemble:  steps 8 and 16 stiffness variants as SIMD lanes of one ensemble and as separate
+//            scalar runs; reports both times, the largest difference and per-lane results.
+// verlet:    runs the explicit kernel and position Verlet on the same active-set layout, in float
+//            and double; reports time per step, bytes per particle and the largest difference.
+// fused:     runs the explicit kernel (over all points and over the active set) and the fused pull
+//            kernel with each scalar policy; reports the times and whether the fused state matches
+//            the active-set run bit for bit.
+// cloth:     steps 64x64 and 256x256 cloths with the grid stencil kernels and with PhysicsUpdate over
+//            the equivalent spring records; reports both times, the spring bytes the stencil does
+//            not read and whether the results match bit for bit.
+// packed:    runs the explicit kernel over Spring records and over packed springs with a material
+//            table, with one and with three materials; reports times, bytes per spring and the
+//            largest difference (zero for one material).
+// sleep:     settles a stiff pinned armadillo, then steps it with and without sleeping islands
+//            (poking it halfway) and 16 poked instances with and without per-instance sleep;
+//            reports time per step as the bodies come to rest, what is asleep and the largest
+//            difference from the body run without sleep.
+// adaptive:  runs the armadillo for a number of 60 Hz frames with one fixed step per frame and with
+//            the adaptive step controller, quiet and after a hard poke; reports steps, rejections,
+//            time and the largest distance from a reference run with 20 fixed steps per frame.
+//
+// usage: hw3_bench [precision|codec|determinism|instances|ensemble|verlet|fused|cloth|packed|sleep|adaptive] [steps] [output.json]   (run from the build directory)
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <map>
+#include "cyTriMesh.h"
+#include "cyMatrix.h"
+#include "Physics.h"
+#include "ActiveSet.h"
+#include "Models.h"
+#include "CacheCodec.h"
+#include "PerfCounters.h"
+#include "StateHash.h"
+#include "Instances.h"
+#include "Ensemble.h"
+#include "Verlet.h"
+#include "FusedStep.h"
+#include "Cloth.h"
+#include "PackedSprings.h"
+#include "Sleep.h"
+#include "StepControl.h"
+#include "SceneSetup.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+struct BenchResult {
+    std::string policy;
+    std::string integrator;
+    double msPerStep;
+    double maxDrift;    // largest distance from the double-precision run
+    double rmsDrift;
+    std::vector<cy::Vec3d> positions;
+    std::map<std::string, PerfCounters::PhaseTotals> counters;  // of the stepping thread only
+};
+
+const float dt = 1.0f / 60.0f;
+
+template <typename P>
+BenchResult runPolicy(const char* name, bool implicit, const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(nodes, edges);
+    Physics::ImplicitStateT<P> implicitState;
+    const cy::Vec3f externalForce(0.0f, 0.0f, 0.0f);
+
+    PerfCounters::TakeTotals();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) {
+        if (implicit) {
+            Physics::PhysicsUpdateImplicit(mpoints, springs, externalForce, dt, implicitState);
+        } else {
+            Physics::PhysicsUpdate(mpoints, springs, externalForce, dt);
+        }
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    BenchResult result;
+    result.policy     = name;
+    result.integrator = implicit ? "implicit" : "explicit";
+    result.msPerStep  = elapsed.count() / steps;
+    result.maxDrift   = 0.0;
+    result.rmsDrift   = 0.0;
+    result.counters   = PerfCounters::TakeTotals();
+    for (auto &mp : mpoints) result.positions.push_back(cy::Vec3d(mp.position));
+    return result;
+}
+
+void computeDrift(BenchResult& result, const BenchResult& reference) {
+    double sum = 0.0;
+    for (size_t i = 0; i < result.positions.size(); i++) {
+        double d = (result.positions[i] - reference.positions[i]).Length();
+        result.maxDrift = std::max(result.maxDrift, d);
+        sum += d * d;
+    }
+    result.rmsDrift = std::sqrt(sum / result.positions.size());
+}
+
+// {"springs": {"calls": n, "cycles": per call or null, ...}, ...}
+void writeCounters(std::ostream& json, const std::map<std::string, PerfCounters::PhaseTotals>& counters) {
+    json << "{";
+    bool first = true;
+    for (auto &entry : counters) {
+        const auto &t = entry.second;
+        json << (first ? "" : ", ") << "\"" << entry.first << "\": {\"calls\": " << t.calls;
+        for (int c = 0; c < PerfCounters::NUM_COUNTERS; c++) {
+            json << ", \"" << PerfCounters::CounterName(c) << "\": ";
+            if (t.values.valid[c]) json << double(t.values.count[c]) / t.calls;
+            else json << "null";
+        }
+        first = false;
+        json << "}";
+    }
+    json << "}";
+}
+
+int runPrecision(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::vector<BenchResult> results;
+    for (bool implicit : {false, true}) {
+        BenchResult reference = runPolicy<DoublePrecision>("double", implicit, nodes, edges, steps);
+        BenchResult single    = runPolicy<FloatPrecision>("float", implicit, nodes, edges, steps);
+        BenchResult mixed     = runPolicy<MixedPrecision>("mixed", implicit, nodes, edges, steps);
+        computeDrift(single, reference);
+        computeDrift(mixed, reference);
+        results.push_back(single);
+        results.push_back(mixed);
+        results.push_back(reference);
+    }
+
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"nodes\": " << nodes.size()
+         << ",\n  \"springs\": " << edges.size() << ",\n  \"steps\": " << steps
+         << ",\n  \"dt\": " << dt << ",\n  \"counters_available\": " << (PerfCounters::Thread().Available() ? "true" : "false")
+         << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        cout << r.integrator << "\t" << r.policy << "\t" << r.msPerStep << " ms/step\tmax drift " << r.maxDrift << "\trms drift " << r.rmsDrift << endl;
+        json << "    {\"integrator\": \"" << r.integrator << "\", \"policy\": \"" << r.policy
+             << "\", \"ms_per_step\": " << r.msPerStep << ", \"max_drift\": " << r.maxDrift
+             << ", \"rms_drift\": " << r.rmsDrift << ", \"counters\": ";
+        writeCounters(json, r.counters);
+        json << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return 0;
+}
+
+// Explicit float run of the armadillo; calls frame(time, mpoints) after every step.
+template <typename Fn>
+void simulate(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, Fn frame) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(nodes, edges);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    for (int i = 0; i < steps; i++) {
+        Physics::PhysicsUpdate(mpoints, springs, externalForce, dt);
+        frame((i + 1) * double(dt), mpoints);
+    }
+}
+
+int runCodec(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    const char* cacheFile = "bench_quantized.cache";
+    const std::vector<int> identity;
+    const SceneSetup::Bounds bounds = SceneSetup::ComputeBounds(nodes);
+
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"nodes\": " << nodes.size()
+         << ",\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    bool failed = false;
+    const double rawBytes = double(steps) * Cache::FrameBytes(uint32_t(nodes.size()), 0);
+
+    std::vector<std::pair<float, Cache::Predictor>> configs = {
+        { 1e-3f, Cache::Predictor::Previous }, { 1e-3f, Cache::Predictor::Linear }, { 1e-4f, Cache::Predictor::Linear } };
+    for (size_t c = 0; c < configs.size(); c++) {
+        Cache::CodecSettings settings;
+        settings.errorBound = configs[c].first;
+        settings.predictor  = configs[c].second;
+
+        Cache::QuantizedWriter writer;
+        writer.Open(cacheFile, uint32_t(nodes.size()), bounds.min, bounds.max, settings);
+        double pushMs = 0.0;
+        auto encodeStart = std::chrono::steady_clock::now();
+        simulate(nodes, edges, steps, [&](double t, const std::vector<MassPoint>& mpoints) {
+            auto start = std::chrono::steady_clock::now();
+            writer.Push(t, mpoints, identity);
+            pushMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        });
+        writer.Close();
+        double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - encodeStart).count();
+
+        std::ifstream sizeProbe(cacheFile, std::ios::binary | std::ios::ate);
+        double fileBytes = double(sizeProbe.tellg());
+
+        // sequential decode speed
+        Cache::QuantizedPlayer player;
+        if (!player.Open(cacheFile) || player.NumFrames() != size_t(steps)) {
+            cout << "FAILED: cache has " << player.NumFrames() << " frames, expected " << steps << endl;
+            return 1;
+        }
+        auto decodeStart = std::chrono::steady_clock::now();
+        for (size_t f = 0; f < player.NumFrames(); f++) player.Decode(f);
+        double decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count() / steps;
+
+        // error bound: re-run the (deterministic) simulation and compare every frame;
+        // every 7th frame is also sought after a jump elsewhere, so it decodes from its keyframe
+        double maxError = 0.0, maxExcess = -INFINITY;
+        int frame = 0;
+        Cache::QuantizedPlayer seeker;
+        seeker.Open(cacheFile);
+        simulate(nodes, edges, steps, [&](double, const std::vector<MassPoint>& mpoints) {
+            const float* decoded = player.Decode(frame);
+            const float* sought = nullptr;
+            if (frame % 7 == 0) {
+                seeker.Decode((frame + steps / 2) % steps);
+                sought = seeker.Decode(frame);
+            }
+            for (size_t i = 0; i < mpoints.size(); i++) {
+                for (int k = 0; k < 3; k++) {
+                    float x = mpoints[i].position[k];
+                    double error = std::abs(double(decoded[3*i + k]) - double(x));
+                    maxError = std::max(maxError, error);
+                    // the bound holds on the grid; storing the result as float adds up to one ulp
+                    double ulp = std::nextafter(std::abs(x), INFINITY) - std::abs(x);
+                    maxExcess = std::max(maxExcess, error - settings.errorBound - ulp);
+                    if (sought && sought[3*i + k] != decoded[3*i + k]) maxExcess = INFINITY;
+                }
+            }
+            frame++;
+        });
+        bool ok = maxExcess <= 0.0;
+        failed |= !ok;
+
+        const char* predictor = settings.predictor == Cache::Predictor::Linear ? "linear" : "previous";
+        cout << "bound " << settings.errorBound << "\t" << predictor << "\tratio " << rawBytes / fileBytes
+             << "\tpush " << pushMs / steps << " ms\tencode " << encodeMs / steps << " ms/frame\tdecode " << decodeMs
+             << " ms/frame\tmax error " << maxError << (ok ? "" : "\tFAILED") << endl;
+        json << "    {\"error_bound\": " << settings.errorBound << ", \"predictor\": \"" << predictor
+             << "\", \"bytes\": " << fileBytes << ", \"raw_bytes\": " << rawBytes << ", \"ratio\": " << rawBytes / fileBytes
+             << ", \"push_ms\": " << pushMs / steps << ", \"decode_ms_per_frame\": " << decodeMs
+             << ", \"max_error\": " << maxError << ", \"ok\": " << (ok ? "true" : "false") << "}"
+             << (c + 1 < configs.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    std::remove(cacheFile);
+    return failed ? 1 : 0;
+}
+
+// Per-step state hashes of an implicit run with the given number of OpenMP threads.
+template <typename P>
+std::vector<uint64_t> hashRun(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, int threads, bool deterministic) {
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(nodes, edges);
+    Physics::ImplicitStateT<P> implicitState;
+    implicitState.pcg.deterministic = deterministic;
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    std::vector<uint64_t> hashes;
+    for (int i = 0; i < steps; i++) {
+        Physics::PhysicsUpdateImplicit(mpoints, springs, externalForce, dt, implicitState);
+        hashes.push_back(StateHash::Hash(mpoints));
+    }
+    return hashes;
+}
+
+// Compares runs with 2 and 4 threads against the 1-thread run, with and without deterministic
+// reductions. Returns false if a deterministic run diverged.
+template <typename P>
+bool compareThreads(const char* policy, const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, std::ostream& json, bool& first) {
+    bool ok = true;
+    for (bool deterministic : {true, false}) {
+        std::vector<uint64_t> reference = hashRun<P>(nodes, edges, steps, 1, deterministic);
+        for (int threads : {1, 2, 4}) {
+            std::vector<uint64_t> hashes = threads == 1 ? reference : hashRun<P>(nodes, edges, steps, threads, deterministic);
+            int diverged = -1;   // first step whose state differs from the 1-thread run
+            for (int i = 0; i < steps && diverged < 0; i++) {
+                if (hashes[i] != reference[i]) diverged = i + 1;
+            }
+            if (deterministic && diverged >= 0) ok = false;
+            char hash[17];
+            std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)hashes.back());
+            cout << policy << "\t" << (deterministic ? "deterministic" : "default") << "\t" << threads << " threads\tfinal hash " << hash
+                 << "\t" << (diverged < 0 ? "matches 1 thread" : "diverges at step " + std::to_string(diverged)) << endl;
+            json << (first ? "" : ",\n") << "    {\"policy\": \"" << policy << "\", \"deterministic\": " << (deterministic ? "true" : "false")
+                 << ", \"threads\": " << threads << ", \"final_hash\": \"" << hash << "\", \"first_divergence\": ";
+            if (diverged < 0) json << "null";
+            else json << diverged;
+            json << "}";
+            first = false;
+        }
+    }
+    return ok;
+}
+
+int runDeterminism(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    bool first = true;
+    bool ok = compareThreads<FloatPrecision>("float", nodes, edges, steps, json, first);
+    ok &= compareThreads<DoublePrecision>("double", nodes, edges, steps, json, first);
+    json << "\n  ]\n}\n";
+    return ok ? 0 : 1;
+}
+
+int runInstances(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(nodes, edges);
+    auto topology = Instances::MakeTopology(mpoints, springs, {});
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"steps\": " << steps
+         << ",\n  \"shared_bytes\": " << topology->Bytes() << ",\n  \"results\": [\n";
+    for (int count : {1, 4, 16}) {
+        Instances::Scene scene;
+        scene.SetTopology(topology);
+        for (int k = 0; k < count; k++) scene.Add(cy::Vec3f(150.0f * k, 0.0f, 0.0f));
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < steps; i++) scene.Step(externalForce, dt);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        double msPerStep = elapsed.count() / steps;
+        cout << count << " instances\t" << msPerStep << " ms/step\t" << msPerStep / count << " ms/instance\t"
+             << scene.StateBytes() << " bytes/instance (shared " << topology->Bytes() << ")" << endl;
+        json << "    {\"instances\": " << count << ", \"ms_per_step\": " << msPerStep << ", \"ms_per_instance\": " << msPerStep / count
+             << ", \"bytes_per_instance\": " << scene.StateBytes() << "}" << (count != 16 ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return 0;
+}
+
+template <int L>
+bool compareEnsemble(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, std::ostream& json) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<FloatPrecision>(nodes, edges);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+
+    Ensemble::EnsembleT<L> ensemble;
+    ensemble.Init(mpoints, springs);
+    for (int k = 0; k < L; k++) ensemble.stiffnessScale[k] = 0.5f + 1.5f * k / (L - 1);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) ensemble.Step(externalForce, dt);
+    std::chrono::duration<double, std::milli> ensembleTime = std::chrono::steady_clock::now() - start;
+
+    // the same variants one at a time through the regular kernel
+    double scalarMs = 0.0, maxDifference = 0.0;
+    json << "    {\"lanes\": " << L << ", \"per_lane\": [";
+    for (int k = 0; k < L; k++) {
+        auto scalarPoints = mpoints;
+        auto scalarSprings = springs;
+        for (auto &s : scalarSprings) s.stiffness *= ensemble.stiffnessScale[k];
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(scalarPoints, scalarSprings, externalForce, dt);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        scalarMs += elapsed.count();
+
+        auto lane = mpoints;
+        ensemble.GetLane(k, lane);
+        float lowest = lane[0].position.y;
+        for (size_t i = 0; i < lane.size(); i++) {
+            maxDifference = std::max(maxDifference, double((lane[i].position - scalarPoints[i].position).Length()));
+            lowest = std::min(lowest, lane[i].position.y);
+        }
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)StateHash::Hash(lane));
+        json << (k ? ", " : "") << "{\"stiffness_scale\": " << ensemble.stiffnessScale[k] << ", \"lowest_y\": " << lowest
+             << ", \"hash\": \"" << hash << "\"}";
+    }
+    double ensembleMs = ensembleTime.count() / steps;
+    scalarMs /= steps;
+    cout << L << " lanes\tensemble " << ensembleMs << " ms/step\tscalar " << scalarMs << " ms/step\tspeedup "
+         << scalarMs / ensembleMs << "\tmax difference " << maxDifference << endl;
+    json << "], \"ensemble_ms_per_step\": " << ensembleMs << ", \"scalar_ms_per_step\": " << scalarMs
+         << ", \"speedup\": " << scalarMs / ensembleMs << ", \"max_difference\": " << maxDifference << "}";
+    return maxDifference <= 1e-3;
+}
+
+int runEnsemble(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    bool ok = compareEnsemble<8>(nodes, edges, steps, json);
+    json << ",\n";
+    ok &= compareEnsemble<16>(nodes, edges, steps, json);
+    json << "\n  ]\n}\n";
+    return ok ? 0 : 1;
+}
+
+template <typename P>
+void compareVerlet(const char* policy, const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, std::ostream& json) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(nodes, edges);
+    Physics::ActiveSetT<P> activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+
+    Verlet::VerletStateT<P> verlet;
+    verlet.Load(mpoints, dt);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+    std::chrono::duration<double, std::milli> explicitTime = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Verlet::VerletUpdate(verlet, springs, activeSet.Layout(), features, externalForce, dt);
+    std::chrono::duration<double, std::milli> verletTime = std::chrono::steady_clock::now() - start;
+
+    double maxDifference = 0.0;
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        maxDifference = std::max(maxDifference, double((verlet.position[i] - mpoints[i].position).Length()));
+    }
+    double explicitMs = explicitTime.count() / steps, verletMs = verletTime.count() / steps;
+    cout << policy << "\texplicit " << explicitMs << " ms/step (" << sizeof(MassPointT<P>) << " B/particle)\tverlet " << verletMs
+         << " ms/step (" << verlet.BytesPerParticle() << " B/particle)\tspeedup " << explicitMs / verletMs << "\tmax difference " << maxDifference << endl;
+    json << "    {\"policy\": \"" << policy << "\", \"explicit_ms_per_step\": " << explicitMs << ", \"verlet_ms_per_step\": " << verletMs
+         << ", \"explicit_bytes_per_particle\": " << sizeof(MassPointT<P>) << ", \"verlet_bytes_per_particle\": " << verlet.BytesPerParticle()
+         << ", \"speedup\": " << explicitMs / verletMs << ", \"max_difference\": " << maxDifference << "}";
+}
+
+int runVerlet(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    compareVerlet<FloatPrecision>("float", nodes, edges, steps, json);
+    json << ",\n";
+    compareVerlet<DoublePrecision>("double", nodes, edges, steps, json);
+    json << "\n  ]\n}\n";
+    return 0;
+}
+
+template <typename P>
+bool compareFused(const char* policy, const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, std::ostream& json) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(nodes, edges);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+
+    auto allPoints = mpoints;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(allPoints, springs, features, externalForce, dt);
+    std::chrono::duration<double, std::milli> allTime = std::chrono::steady_clock::now() - start;
+
+    Physics::ActiveSetT<P> activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    Physics::FusedStateT<P> fused;
+    fused.Load(mpoints, springs);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+    std::chrono::duration<double, std::milli> explicitTime = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdateFused(fused, features, externalForce, dt);
+    std::chrono::duration<double, std::milli> fusedTime = std::chrono::steady_clock::now() - start;
+
+    auto result = mpoints;
+    fused.Store(result);
+    bool identical = StateHash::Hash(result) == StateHash::Hash(mpoints);
+    double allMs = allTime.count() / steps, explicitMs = explicitTime.count() / steps, fusedMs = fusedTime.count() / steps;
+    cout << policy << "\texplicit " << allMs << " ms/step\tactive set " << explicitMs << " ms/step\tfused " << fusedMs << " ms/step\t"
+         << (identical ? "identical" : "DIFFERENT") << endl;
+    json << "    {\"policy\": \"" << policy << "\", \"explicit_ms_per_step\": " << allMs << ", \"active_set_ms_per_step\": " << explicitMs
+         << ", \"fused_ms_per_step\": " << fusedMs << ", \"identical\": " << (identical ? "true" : "false") << "}";
+    return identical;
+}
+
+int runFused(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"mesh\": \"armadillo_50k_tet\",\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    bool ok = compareFused<FloatPrecision>("float", nodes, edges, steps, json);
+    json << ",\n";
+    ok &= compareFused<MixedPrecision>("mixed", nodes, edges, steps, json);
+    json << ",\n";
+    ok &= compareFused<DoublePrecision>("double", nodes, edges, steps, json);
+    json << "\n  ]\n}\n";
+    return ok ? 0 : 1;
+}
+
+template <typename P>
+bool compareCloth(const char* policy, int size, int steps, std::ostream& json) {
+    Cloth::ClothT<P> cloth;
+    cloth.Init(size, size, Cloth::Params(), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(1.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, -0.5f, 0.866f));
+    auto mpoints = cloth.MassPoints();
+    Physics::PinTop(mpoints, 0.0f);   // the top row
+    cloth.Load(mpoints, {});
+    auto springs = cloth.Springs();
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    const cy::Vec3f externalForce(0.0f, 0.0f, -0.5f);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(mpoints, springs, features, externalForce, dt);
+    std::chrono::duration<double, std::milli> springTime = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) cloth.Step(externalForce, dt);
+    std::chrono::duration<double, std::milli> stencilTime = std::chrono::steady_clock::now() - start;
+
+    auto result = mpoints;
+    cloth.Store(result, {});
+    bool identical = StateHash::Hash(result) == StateHash::Hash(mpoints);
+    double springMs = springTime.count() / steps, stencilMs = stencilTime.count() / steps;
+    size_t springBytes = springs.size() * sizeof(SpringT<P>);
+    cout << policy << "\t" << size << "x" << size << "\t" << springs.size() << " springs (" << springBytes / 1024 << " KB)\tsprings "
+         << springMs << " ms/step\tstencil " << stencilMs << " ms/step\tspeedup " << springMs / stencilMs << "\t"
+         << (identical ? "identical" : "DIFFERENT") << endl;
+    json << "    {\"policy\": \"" << policy << "\", \"grid\": " << size << ", \"springs\": " << springs.size() << ", \"spring_bytes\": " << springBytes
+         << ", \"springs_ms_per_step\": " << springMs << ", \"stencil_ms_per_step\": " << stencilMs << ", \"speedup\": " << springMs / stencilMs
+         << ", \"identical\": " << (identical ? "true" : "false") << "}";
+    return identical;
+}
+
+int runCloth(int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    bool ok = true;
+    bool first = true;
+    for (int size : {64, 256}) {
+        json << (first ? "" : ",\n");
+        ok &= compareCloth<FloatPrecision>("float", size, steps, json);
+        json << ",\n";
+        ok &= compareCloth<DoublePrecision>("double", size, steps, json);
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+    return ok ? 0 : 1;
+}
+
+// variants > 1 scales the parameters of every variants-th spring differently, giving more materials
+bool comparePacked(const char* mesh, int variants, std::vector<MassPointT<FloatPrecision>> mpoints, std::vector<SpringT<FloatPrecision>> springs, int steps, std::ostream& json) {
+    for (size_t i = 0; i < springs.size(); i++) {
+        springs[i].stiffness *= 1.0f + float(i % variants);
+        springs[i].damping   *= 1.0f + float(i % variants);
+    }
+    Physics::ActiveSetT<FloatPrecision> activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    features.hasFixed = false;
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    Physics::PackedSpringsT<FloatPrecision> packed;
+    packed.Build(springs, activeSet.Layout());
+
+    auto packedPoints = mpoints;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(mpoints, springs, activeSet.Layout(), features, externalForce, dt);
+    std::chrono::duration<double, std::milli> recordTime = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(packedPoints, packed, activeSet.Layout(), features, externalForce, dt);
+    std::chrono::duration<double, std::milli> packedTime = std::chrono::steady_clock::now() - start;
+
+    double maxDifference = 0.0;
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        maxDifference = std::max(maxDifference, double((packedPoints[i].position - mpoints[i].position).Length()));
+    }
+    double recordMs = recordTime.count() / steps, packedMs = packedTime.count() / steps;
+    double recordBytes = double(activeSet.freePinnedEnd * sizeof(Spring)) / packed.springs.size();
+    double packedBytes = double(packed.Bytes()) / packed.springs.size();
+    cout << mesh << "\t" << packed.materials.size() << " materials\t" << packed.runs.size() << " runs\trecords " << recordMs << " ms/step (" << recordBytes << " B/spring)\tpacked "
+         << packedMs << " ms/step (" << packedBytes << " B/spring)\tspeedup " << recordMs / packedMs << "\tmax difference " << maxDifference << endl;
+    json << "    {\"mesh\": \"" << mesh << "\", \"materials\": " << packed.materials.size() << ", \"runs\": " << packed.runs.size() << ", \"records_ms_per_step\": " << recordMs
+         << ", \"packed_ms_per_step\": " << packedMs << ", \"record_bytes_per_spring\": " << recordBytes << ", \"packed_bytes_per_spring\": " << packedBytes
+         << ", \"speedup\": " << recordMs / packedMs << ", \"max_difference\": " << maxDifference << "}";
+    return packed.materials.size() > 1 || maxDifference == 0.0;
+}
+
+int runPacked(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"steps\": " << steps << ",\n  \"results\": [\n";
+    auto [mpoints, springs] = SceneSetup::MakeBody<FloatPrecision>(nodes, edges);
+    bool ok = comparePacked("armadillo_50k_tet", 1, mpoints, springs, steps, json);
+    json << ",\n";
+    ok &= comparePacked("armadillo_50k_tet", 3, mpoints, springs, steps, json);
+
+    // a mesh whose springs do not fit in cache: the springs of a 1024x1024 cloth
+    Cloth::ClothT<FloatPrecision> cloth;
+    cloth.Init(1024, 1024, Cloth::Params(), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(1.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, -0.5f, 0.866f));
+    mpoints = cloth.MassPoints();
+    Physics::PinTop(mpoints, 0.0f);
+    springs = cloth.Springs();
+    json << ",\n";
+    ok &= comparePacked("cloth_1024", 1, mpoints, springs, std::min(steps, 20), json);
+    json << "\n  ]\n}\n";
+    return ok ? 0 : 1;
+}
+
+// Stiff, damped armadillo brought to its hanging rest shape with large implicit steps (the app's
+// soft armadillo never comes to rest). Islands should fall asleep, wake on a poke and settle again.
+int runSleep(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int steps, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"steps\": " << steps << ",\n  \"body\": [\n";
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(nodes, edges, SceneSetup::Stiff);
+    const cy::Vec3f externalForce(0.0f, 0.0f, 0.0f);
+    {
+        Physics::ImplicitState settle;
+        for (int i = 0; i < 400; i++) Physics::PhysicsUpdateImplicit(mpoints, springs, externalForce, 1.0f, settle);
+        for (auto &mp : mpoints) mp.velocity = decltype(mp.velocity)(0, 0, 0);
+    }
+    Physics::ActiveSet activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    features.hasFixed = false;
+    const int windows = 10, window = std::max(steps / windows, 1);
+
+    // halfway through, the lowest tenth of the body is poked sideways
+    float pokeBelow = mpoints[0].position.y;
+    {
+        std::vector<float> heights;
+        for (auto &mp : mpoints) heights.push_back(mp.position.y);
+        std::nth_element(heights.begin(), heights.begin() + heights.size() / 10, heights.end());
+        pokeBelow = heights[heights.size() / 10];
+    }
+    auto poke = [pokeBelow](std::vector<MassPoint>& points) {
+        for (auto &mp : points) if (!mp.fixed && mp.position.y < pokeBelow) mp.velocity = decltype(mp.velocity)(1, 0, 0);
+    };
+
+    auto restPoints = mpoints;
+    auto restSprings = springs;
+    Physics::ActiveSet restSet = activeSet;
+
+    // the same packed explicit step the app runs, with and without islands
+    auto awakePoints = mpoints;
+    auto awakeSprings = springs;
+    Physics::ActiveSet awakeSet = activeSet;
+    Physics::PackedSprings packed, awakePacked;
+    awakePacked.Build(awakeSprings, awakeSet.Layout());
+    packed.Build(springs, activeSet.Layout());
+    Physics::SleepIslands islands;
+    islands.Build(mpoints, springs, activeSet);
+    double sleepTotal = 0.0, awakeTotal = 0.0;
+    for (int w = 0; w < windows; w++) {
+        if (w == windows / 2) {
+            if (islands.WakeAll(mpoints, springs, activeSet)) packed.Build(springs, activeSet.Layout());
+            poke(mpoints);
+            poke(awakePoints);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < window; i++) Physics::PhysicsUpdate(awakePoints, awakePacked, awakeSet.Layout(), features, externalForce, dt);
+        std::chrono::duration<double, std::milli> awakeTime = std::chrono::steady_clock::now() - start;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < window; i++) {
+            Physics::PhysicsUpdate(mpoints, packed, activeSet.Layout(), features, externalForce, dt);
+            if (islands.Update(mpoints, springs, activeSet)) packed.Build(springs, activeSet.Layout());
+        }
+        std::chrono::duration<double, std::milli> sleepTime = std::chrono::steady_clock::now() - start;
+        awakeTotal += awakeTime.count();
+        sleepTotal += sleepTime.count();
+        cout << "body\tsteps " << (w + 1) * window << (w == windows / 2 ? " (poked)" : "") << "\tawake " << awakeTime.count() / window << " ms/step\tsleep "
+             << sleepTime.count() / window << " ms/step\tislands asleep " << islands.numAsleep << "/" << islands.Size() << "\tfree points " << activeSet.numFree << endl;
+        json << (w ? ",\n" : "") << "    {\"steps\": " << (w + 1) * window << ", \"awake_ms_per_step\": " << awakeTime.count() / window
+             << ", \"sleep_ms_per_step\": " << sleepTime.count() / window << ", \"islands_asleep\": " << islands.numAsleep << ", \"free_points\": " << activeSet.numFree << "}";
+    }
+    double maxDifference = 0.0;
+    for (size_t slot = 0; slot < mpoints.size(); slot++) {
+        const auto &other = awakePoints[awakeSet.slotOf[activeSet.nodeAt[slot]]];
+        maxDifference = std::max(maxDifference, double((mpoints[slot].position - other.position).Length()));
+    }
+    cout << "body\ttotal awake " << awakeTotal << " ms\tsleep " << sleepTotal << " ms\tspeedup " << awakeTotal / sleepTotal << "\tmax difference " << maxDifference << endl;
+    json << "\n  ],\n  \"body_speedup\": " << awakeTotal / sleepTotal << ",\n  \"body_max_difference\": " << maxDifference << ",\n  \"instances\": [\n";
+
+    // 16 copies of the resting body; every other one is poked at the start
+    auto topology = Instances::MakeTopology(restPoints, restSprings, restSet.nodeAt);
+    Instances::Scene sleeping, awake;
+    for (auto *scene : { &sleeping, &awake }) {
+        scene->SetTopology(topology);
+        for (int k = 0; k < 16; k++) {
+            scene->Add(cy::Vec3f(0.0f, 0.0f, 0.0f));
+            if (k % 2) poke(scene->states[k]);
+        }
+    }
+    awake.sleepEnabled = false;
+    double sleepingTotal = 0.0, awakeInstancesTotal = 0.0;
+    for (int w = 0; w < windows; w++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < window; i++) awake.Step(externalForce, dt);
+        std::chrono::duration<double, std::milli> awakeTime = std::chrono::steady_clock::now() - start;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < window; i++) sleeping.Step(externalForce, dt);
+        std::chrono::duration<double, std::milli> sleepTime = std::chrono::steady_clock::now() - start;
+        awakeInstancesTotal += awakeTime.count();
+        sleepingTotal += sleepTime.count();
+        cout << "instances\tsteps " << (w + 1) * window << "\tawake " << awakeTime.count() / window << " ms/step\tsleep "
+             << sleepTime.count() / window << " ms/step\tasleep " << sleeping.NumAsleep() << "/" << sleeping.Size() << endl;
+        json << (w ? ",\n" : "") << "    {\"steps\": " << (w + 1) * window << ", \"awake_ms_per_step\": " << awakeTime.count() / window
+             << ", \"sleep_ms_per_step\": " << sleepTime.count() / window << ", \"asleep\": " << sleeping.NumAsleep() << "}";
+    }
+    cout << "instances\ttotal awake " << awakeInstancesTotal << " ms\tsleep " << sleepingTotal << " ms\tspeedup " << awakeInstancesTotal / sleepingTotal << endl;
+    json << "\n  ],\n  \"instances_speedup\": " << awakeInstancesTotal / sleepingTotal << "\n}\n";
+    return 0;
+}
+
+// frames: 60 Hz frames to simulate; poke: sideways speed given to the lowest tenth at the start
+bool compareAdaptive(const char* name, std::vector<MassPoint> mpoints, std::vector<Spring> springs, float poke, int frames, std::ostream& json) {
+    const float frame = 1.0f / 60.0f;
+    const cy::Vec3f externalForce(0.0f, 0.0f, 0.0f);
+    Physics::ActiveSet activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    features.hasFixed = false;
+    std::vector<float> heights;
+    for (auto &mp : mpoints) heights.push_back(mp.position.y);
+    std::nth_element(heights.begin(), heights.begin() + heights.size() / 10, heights.end());
+    for (auto &mp : mpoints) if (!mp.fixed && mp.position.y < heights[heights.size() / 10]) mp.velocity = decltype(mp.velocity)(poke, 0, 0);
+
+    auto step = [&](std::vector<MassPoint>& points, float h) { Physics::PhysicsUpdate(points, springs, activeSet.Layout(), features, externalForce, h); };
+    auto reference = mpoints, fixed = mpoints, adaptive = mpoints;
+    const int refine = 20;
+    for (int f = 0; f < frames * refine; f++) step(reference, frame / refine);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) step(fixed, frame);
+    std::chrono::duration<double, std::milli> fixedTime = std::chrono::steady_clock::now() - start;
+
+    StepControl::Controller controller;
+    controller.SetLimits(StepControl::ComputeLimits(mpoints, springs));
+    int steps = 0, rejected = 0;
+    double covered = 0.0;
+    start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        covered += controller.Advance(adaptive, activeSet.numFree, true, frame, [&](float h) { step(adaptive, h); });
+        steps += controller.substeps;
+        rejected += controller.rejected;
+    }
+    std::chrono::duration<double, std::milli> adaptiveTime = std::chrono::steady_clock::now() - start;
+    // a run that dropped time is not at the reference's time, so its error is meaningless
+    bool complete = std::abs(covered - frames * double(frame)) < 1e-4;
+
+    auto maxDistance = [&](const std::vector<MassPoint>& points) {
+        double d = 0.0;
+        for (size_t i = 0; i < points.size(); i++) {
+            double di = (points[i].position - reference[i].position).Length();
+            d = std::isfinite(di) ? std::max(d, di) : std::numeric_limits<double>::infinity();
+        }
+        return d;
+    };
+    double fixedError = maxDistance(fixed), adaptiveError = maxDistance(adaptive);
+    cout << name << "\tfixed " << frames << " steps " << fixedTime.count() << " ms error " << fixedError << "\tadaptive " << steps << " steps ("
+         << rejected << " rejected) " << adaptiveTime.count() << " ms error " << adaptiveError << (complete ? "" : " (dropped time)") << "\tstability limit " << controller.limits.stable << endl;
+    json << "    {\"case\": \"" << name << "\", \"frames\": " << frames << ", \"fixed_ms\": " << fixedTime.count() << ", \"fixed_error\": " << fixedError
+         << ", \"adaptive_steps\": " << steps << ", \"adaptive_rejected\": " << rejected << ", \"adaptive_ms\": " << adaptiveTime.count()
+         << ", \"adaptive_error\": " << adaptiveError << ", \"adaptive_complete\": " << (complete ? "true" : "false") << ", \"stability_limit\": " << controller.limits.stable << "}";
+    return complete && std::isfinite(adaptiveError);
+}
+
+int runAdaptive(const std::vector<cy::Vec3f>& nodes, const std::vector<std::pair<int,int>>& edges, int frames, const char* jsonFile) {
+    std::ofstream json(jsonFile);
+    json << "{\n  \"frames\": " << frames << ",\n  \"results\": [\n";
+    auto soft = SceneSetup::MakeBody<SimPrecision>(nodes, edges);
+    auto stiff = SceneSetup::MakeBody<SimPrecision>(nodes, edges, SceneSetup::Stiff);
+    bool ok = compareAdaptive("soft quiet", soft.mpoints, soft.springs, 0.0f, frames, json);
+    json << ",\n";
+    ok &= compareAdaptive("soft poked", soft.mpoints, soft.springs, 200.0f, frames, json);
+    json << ",\n";
+    ok &= compareAdaptive("stiff quiet", stiff.mpoints, stiff.springs, 0.0f, frames, json);
+    json << ",\n";
+    ok &= compareAdaptive("stiff poked", stiff.mpoints, stiff.springs, 200.0f, frames, json);
+    json << "\n  ]\n}\n";
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int arg = 1;
+    std::string mode = "precision";
+    if (argc > 1 && !isdigit(argv[1][0])) mode = argv[arg++];
+    int steps = argc > arg ? atoi(argv[arg]) : (mode == "codec" ? 600 : 200);
+    const char* jsonFile = argc > arg + 1 ? argv[arg + 1] : "bench.json";
+    PerfCounters::enabled = true;
+    if (mode == "cloth") return runCloth(steps, jsonFile);   // no mesh needed
+
+    std::vector<cy::Vec3f> nodes;
+    cy::Vec3f centroid(0.0f, 0.0f, 0.0f);
+    std::vector<Models::Tetrahedron> tetrahedra;
+    int firstIndex = 0;
+    if (!Models::loadNodes("armadillo_50k_tet.node", nodes, centroid, firstIndex)) return 1;
+    if (!Models::loadTetrahedra("armadillo_50k_tet.ele", tetrahedra, firstIndex)) return 1;
+    auto edges = Models::extractEdges(tetrahedra);
+
+    cout << nodes.size() << " nodes, " << edges.size() << " springs, " << steps << " steps" << endl;
+
+    if (mode == "codec") return runCodec(nodes, edges, steps, jsonFile);
+    if (mode == "determinism") return runDeterminism(nodes, edges, steps, jsonFile);
+    if (mode == "instances") return runInstances(nodes, edges, steps, jsonFile);
+    if (mode == "ensemble") return runEnsemble(nodes, edges, steps, jsonFile);
+    if (mode == "verlet") return runVerlet(nodes, edges, steps, jsonFile);
+    if (mode == "fused") return runFused(nodes, edges, steps, jsonFile);
+    if (mode == "packed") return runPacked(nodes, edges, steps, jsonFile);
+    if (mode == "sleep") return runSleep(nodes, edges, steps, jsonFile);
+    if (mode == "adaptive") return runAdaptive(nodes, edges, steps, jsonFile);
+    if (mode != "precision") {
+        cout << "usage: hw3_bench [precision|codec|determinism|instances|ensemble|verlet|fused|cloth|packed|sleep|adaptive] [steps] [output.json]" << endl;
+        return 1;
+    }
+    return runPrecision(nodes, edges, steps, jsonFile);
+}
@@ -6,7 +6,23 @@
 #include "cyGL.h"
 #include "Camera.h"
 #include "Physics.h"
+#include "ActiveSet.h"
+#include "Instances.h"
+#include "Verlet.h"
+#include "FusedStep.h"
+#include "PackedSprings.h"
+#include "Sleep.h"
+#include "StepControl.h"
+#include "Cloth.h"
+#include "Cache.h"
+#include "CacheCodec.h"
+#include "Checkpoint.h"
+#include "StateHash.h"
+#include "Profiler.h"
+#include "Hud.h"
 #include "Models.h"
+#include "Transform.h"
+#include "SceneSetup.h"
 #include <iostream>
 #include <chrono>
 
@@ -25,16 +41,88 @@ bool leftButtonPressed = false;
 int num_vertices;
 std::vector<cy::Vec3f> nodes;
 cy::Vec3f centroid(0.0f, 0.0f, 0.0f);
+std::vector<unsigned int> surfaceIndices;
+std::vector<cy::Vec3f> surfaceNormals;
 cy::Vec3f lightPosLocalSpace = cy::Vec3f(15.0, -15.0, 15.0);
 
 // init physics variables
 
 std::vector<MassPoint> mpoints;
 std::vector<Spring> springs;
+Physics::StepFeatures stepFeatures;
+
+// free points are kept at the front of mpoints (toggle the pins with U)
+Physics::ActiveSet activeSet;
+std::vector<int> pinnedNodes;
+bool pinsReleased = false;
 std::vector<cy::Vec3f> verticesWorldSpace;
 
+// extra armadillos sharing the springs and render data of the first one (--instances N, add one with N).
+// They always step explicitly and are drawn with one instanced call from a buffer texture.
+Instances::Scene instanceScene;
+cy::GLSLProgram instancedProg;
+GLuint instanceBuffer = 0;
+GLuint instanceTexture = 0;
+GLint maxInstanceFloats = 0;             // GL_MAX_TEXTURE_BUFFER_SIZE
+std::vector<float> instancePositions;
+
+// implicit integration (toggle with I, cycle preconditioner with P)
+bool implicitMode = false;
+Physics::ImplicitState implicitState;
+
+// position-Verlet integration (toggle with V). verletState holds the particles while it is on;
+// positions and velocities are written back to mpoints after every step for everything else.
+bool verletMode = false;
+Verlet::VerletState verletState;
+
+// fused single-pass explicit step (toggle with F), same results as the regular one; like Verlet
+// it keeps its own copy of the particles and writes them back to mpoints after every step
+bool fusedStep = false;
+Physics::FusedState fusedState;
+bool fusedLoaded = false;      // fusedState holds the current state
+
+// the regular explicit step reads the springs packed against a material table (12 bytes each);
+// rebuilt from `springs` before the next step whenever the pins change
+Physics::PackedSprings packedSprings;
+bool packedBuilt = false;
+
+// islands of the body that have come to rest are fixed until something moves them (toggle with Z).
+// Only the regular explicit step puts them to sleep; everything else wakes them first.
+bool sleepEnabled = true;
+Physics::SleepIslands sleepIslands;
+
+// adaptive substeps for the regular explicit and the implicit step (toggle with T); the other
+// integrators keep one step per frame
+bool adaptiveStep = false;
+StepControl::Controller stepControl;
+
+// --cloth WxH: a hanging grid cloth instead of the armadillo. Explicit steps run the grid stencil
+// kernels; the other integrators, instances and caches use the equivalent springs in `springs`.
+int clothWidth = 0, clothHeight = 0;
+Cloth::Cloth cloth;
+bool clothLoaded = false;      // cloth holds the current state
+
 // simulation/render time steps
 auto lastTime = std::chrono::high_resolution_clock::now();
+double simTime = 0.0;
+uint64_t stepCount = 0;
+
+// --deterministic: fixed time step and solver reductions that do not depend on the thread count,
+// so a run reproduces bit for bit. --hash-log FILE writes a hash of the particle state every step.
+bool deterministic = false;
+const float fixedStep = 1.0f / 60.0f;
+StateHash::Log hashLog;
+
+// record (R, or shift+R to include velocities) and play back (L) a simulation cache
+const char* cacheFile = "hw3.cache";
+Cache::Writer cacheWriter;
+Cache::Player cachePlayer;
+// compressed cache: record with C, play back with shift+L
+const char* quantizedCacheFile = "hw3_quantized.cache";
+Cache::QuantizedWriter quantizedWriter;
+Cache::QuantizedPlayer quantizedPlayer;
+bool playbackPaused = false;   // space
+size_t playbackFrame = 0;      // scrub with the arrow keys, page up/down, home/end
 
 // init camera
 bool rightButtonPressed = false;
@@ -42,14 +130,173 @@ float lastClickX = 400, lastClickY = 300;
 float lastX = 400, lastY = 300;
 Camera camera(cy::Vec3f(0.0f, 0.0f, 50.0f)); // camera at 0,0,50
 float scaleFactor = 0.06f;; // scale factor for armadillo model
+Transform::ModelTransform meshTransform;
 
 cy::Vec3f externalForce(0.0f,0.0f,0.0f);
 
+// performance overlay (toggle with H)
+Hud::Overlay hud;
+Hud::RateCounter frameRate;
+Hud::RateCounter stepRate;
+double physicsMs = 0.0;         // smoothed time per physics step
+
+// checkpoints: K saves one now, and one is taken every checkpointInterval seconds of simulated time.
+// Start with --resume to continue from the last one without loading the mesh.
+Checkpoint::Saver checkpointSaver("hw3.checkpoint");
+double checkpointInterval = 30.0;
+double nextCheckpoint = checkpointInterval;
+
+// the complete state a resumed run needs, in file order
+template <typename Archive>
+void transferState(Archive& ar) {
+    ar(simTime);
+    ar(stepCount);
+    ar(nextCheckpoint);
+    ar(externalForce);
+    ar(mpoints);
+    ar(springs);
+    ar(stepFeatures);
+    ar(activeSet.numFree);
+    ar(activeSet.freeFreeEnd);
+    ar(activeSet.freePinnedEnd);
+    ar(activeSet.nodeAt);
+    ar(activeSet.slotOf);
+    ar(activeSet.incident);
+    ar(pinnedNodes);
+    ar(pinsReleased);
+    ar(clothWidth);
+    ar(clothHeight);
+    ar(instanceScene.states);
+    ar(instanceScene.sleep);
+    ar(sleepEnabled);
+    ar(sleepIslands.params);
+    ar(sleepIslands.members);
+    ar(sleepIslands.neighbours);
+    ar(sleepIslands.frozen);
+    ar(sleepIslands.counters);
+    ar(sleepIslands.energy);
+    ar(sleepIslands.numAsleep);
+    ar(adaptiveStep);
+    ar(stepControl.params);
+    ar(stepControl.dt);
+    // implicit solver settings, warm start and system pattern
+    ar(implicitMode);
+    ar(verletMode);
+    ar(fusedStep);
+    // the Verlet particles: the previous positions and the last step do not follow from mpoints
+    // (the fused copy does, it is written back whole after every step)
+    ar(verletState.position);
+    ar(verletState.previous);
+    ar(verletState.invMass);
+    ar(verletState.uniformInvMass);
+    ar(verletState.lastStep);
+    ar(implicitState.pcg.preconditioner);
+    ar(implicitState.assemble);
+    ar(implicitState.dv);
+    ar(implicitState.matrix.n);
+    ar(implicitState.matrix.rowStart);
+    ar(implicitState.matrix.col);
+    ar(implicitState.springBlocks);
+    // render data derived from the mesh files
+    ar(nodes);
+    ar(centroid);
+    ar(surfaceIndices);
+    ar(surfaceNormals);
+}
+
+void saveCheckpoint() {
+    auto start = std::chrono::high_resolution_clock::now();
+    checkpointSaver.Save([](Checkpoint::Writer& ar) { transferState(ar); });
+    std::chrono::duration<double, std::milli> copyTime = std::chrono::high_resolution_clock::now() - start;
+    cout << "Checkpoint at t=" << simTime << " (" << copyTime.count() << " ms copy)" << endl;
+}
+
+void uploadInstances() {
+    instancePositions.resize(3 * instanceScene.NumNodes() * instanceScene.Size());
+    instanceScene.Gather(instancePositions.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, instancePositions.size() * sizeof(float), instancePositions.data(), GL_STREAM_DRAW);
+}
+
+// Places the next instance on a grid beside the first armadillo.
+void addInstance() {
+    size_t floats = 3 * instanceScene.NumNodes() * (instanceScene.Size() + 1);
+    if (floats > size_t(maxInstanceFloats)) {
+        cout << "Instance buffer is full (" << instanceScene.Size() << " instances)" << endl;
+        return;
+    }
+    cy::Vec3f size = SceneSetup::ComputeBounds(nodes).Size();
+    float spacing = 1.2f * std::max(size.x, size.z);
+    int slot = int(instanceScene.Size()) + 1;   // slot 0 is the first armadillo
+    instanceScene.Add(cy::Vec3f((slot % 4) * spacing, 0.0f, -(slot / 4) * spacing));
+    uploadInstances();
+}
+
+
+// After mpoints and springs were reordered (pins changed, islands fell asleep or woke up):
+// everything that indexes them by slot follows the new layout.
+void layoutChanged() {
+    implicitState.ResetPattern();
+    packedBuilt = false;
+    clothLoaded = false;
+    fusedLoaded = false;
+    if (verletMode) verletState.Load(mpoints, verletState.lastStep);
+}
+
+// Wakes the body and the instances.
+void wakeAll() {
+    if (sleepIslands.WakeAll(mpoints, springs, activeSet)) layoutChanged();
+    instanceScene.WakeAll();
+}
+
+void buildHud() {
+    if (!hud.visible) return;
+    char line[128];
+    hud.Begin();
+    std::snprintf(line, sizeof(line), "FPS %5.1f  steps/s %5.1f  physics %.2f ms", frameRate.Rate(), stepRate.Rate(), physicsMs);
+    hud.Print(line);
+    std::snprintf(line, sizeof(line), "nodes %zu (free %zu)  springs %zu", mpoints.size(), activeSet.numFree, springs.size());
+    hud.Print(line);
+    if (implicitMode) {
+        const auto &r = implicitState.pcg.lastResult;
+        std::snprintf(line, sizeof(line), "implicit %s  iters %d  residual %.1e", Solver::PreconditionerName(implicitState.pcg.preconditioner), r.iterations, r.residual);
+        hud.Print(line, r.converged ? cy::Vec4f(1.0f, 1.0f, 1.0f, 1.0f) : cy::Vec4f(1.0f, 0.4f, 0.3f, 1.0f));
+    } else if (verletMode) {
+        std::snprintf(line, sizeof(line), "verlet  %zu bytes/particle", verletState.BytesPerParticle());
+        hud.Print(line);
+    } else {
+        hud.Print(fusedStep ? "explicit (fused)" : (cloth.Size() > 0 ? "explicit (cloth stencil)" : "explicit"));
+    }
+    if (adaptiveStep && (implicitMode || (!verletMode && !fusedStep && cloth.Size() == 0))) {
+        std::snprintf(line, sizeof(line), "adaptive dt %.4f (%s)  substeps %d  rejected %d", stepControl.dt, StepControl::BoundName(stepControl.bound),
+                      stepControl.substeps, stepControl.rejected);
+        hud.Print(line);
+    }
+    if (sleepEnabled) {
+        std::snprintf(line, sizeof(line), "asleep: islands %zu/%zu  instances %zu/%zu", sleepIslands.numAsleep, sleepIslands.Size(),
+                      instanceScene.NumAsleep(), instanceScene.Size());
+        hud.Print(line);
+    }
+    if (instanceScene.Size() > 0) {
+        std::snprintf(line, sizeof(line), "instances %zu  %.2f MB each  shared %.2f MB", instanceScene.Size(),
+                      instanceScene.StateBytes() / (1024.0 * 1024.0), instanceScene.Topology()->Bytes() / (1024.0 * 1024.0));
+        hud.Print(line);
+    }
+    std::snprintf(line, sizeof(line), "mem %.1f MB", Hud::ResidentBytes() / (1024.0 * 1024.0));
+    hud.Print(line);
+#ifdef PROFILER_ENABLED
+    hud.Print("phase            p50     p95     p99 ms", cy::Vec4f(0.6f, 0.8f, 1.0f, 1.0f));
+    for (auto &s : Profiler::LatestSummary()) {
+        std::snprintf(line, sizeof(line), "%-14s %7.3f %7.3f %7.3f", s.name.c_str(), s.p50Ms, s.p95Ms, s.p99Ms);
+        hud.Print(line);
+    }
+#endif
+}
 
 void display() {
-    // Adjust the model transformation matrix to center the object (reverse matrix multiplication order)
-    cy::Matrix4f model = cy::Matrix4f::Scale(scaleFactor) *
-                         cy::Matrix4f::Translation(-centroid);
+    // model matrix centres the object on its centroid; rebuilt only when that changes (a restored checkpoint)
+    meshTransform.SetFrame(centroid, scaleFactor);
+    cy::Matrix4f model = meshTransform.Matrix();
 
 
     cy::Matrix4f view = camera.getLookAtMatrix();
@@ -59,34 +306,158 @@ void display() {
     // Your rendering code goes here
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // Draw your graphics here
-    prog.Bind();
-    prog["lightPosLocalSpace"] = lightPosLocalSpace;
-    prog["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
-    prog["model"] = model;
-    prog["view"] = view;
-    prog["projection"] =  proj;
-    prog["normalTransform"] = (view*model).GetSubMatrix3();
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, num_vertices, GL_UNSIGNED_INT, 0);
-
-    planeProg.Bind();
-    planeProg["lightPosLocalSpace"] = lightPosLocalSpace;
-    planeProg["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
-    model = cy::Matrix4f(1.0);
-    planeProg["model"] = model;
-    planeProg["view"] = view;
-    planeProg["projection"] =  proj;
-    planeProg["normalTransform"] = (view*model).GetSubMatrix3();
-    glBindVertexArray(planeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    {
+        PROFILE_SCOPE("uniforms");
+        prog.Bind();
+        prog["lightPosLocalSpace"] = lightPosLocalSpace;
+        prog["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
+        prog["model"] = model;
+        prog["view"] = view;
+        prog["projection"] =  proj;
+        prog["normalTransform"] = (view*model).GetSubMatrix3();
+    }
+    {
+        PROFILE_SCOPE("draw");
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, num_vertices, GL_UNSIGNED_INT, 0);
+    }
+    if (instanceScene.Size() > 0) {
+        PROFILE_SCOPE("instances draw");
+        instancedProg.Bind();
+        instancedProg["lightPosLocalSpace"] = lightPosLocalSpace;
+        instancedProg["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
+        instancedProg["model"] = model;
+        instancedProg["view"] = view;
+        instancedProg["projection"] =  proj;
+        instancedProg["normalTransform"] = (view*model).GetSubMatrix3();
+        instancedProg["numNodes"] = int(nodes.size());
+        instancedProg["positions"] = 0;
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, num_vertices, GL_UNSIGNED_INT, 0, GLsizei(instanceScene.Size()));
+    }
+
+    {
+        PROFILE_SCOPE("plane");
+        planeProg.Bind();
+        planeProg["lightPosLocalSpace"] = lightPosLocalSpace;
+        planeProg["lightRot"] = cy::Matrix4f::RotationY(light_rot_y * 3.14 /180.0) * cy::Matrix4f::RotationZ(light_rot_z * 3.14 /180.0);
+        model = cy::Matrix4f(1.0);
+        planeProg["model"] = model;
+        planeProg["view"] = view;
+        planeProg["projection"] =  proj;
+        planeProg["normalTransform"] = (view*model).GetSubMatrix3();
+        glBindVertexArray(planeVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
 
-    glutSwapBuffers();
+    {
+        PROFILE_SCOPE("hud");
+        frameRate.Tick();
+        buildHud();
+        hud.Draw(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+    }
+
+    {
+        PROFILE_SCOPE("swap");
+        glutSwapBuffers();
+    }
+    PROFILE_FRAME();
 }
 
 
 void keyboard(unsigned char key, int x, int y) {
     if (key == 27) {  // Esc key
+        cacheWriter.Close();
+        quantizedWriter.Close();
+        checkpointSaver.Stop();
+        PROFILE_SHUTDOWN();
         glutLeaveMainLoop();
+    } else if (key == 'r' || key == 'R') {
+        if (cacheWriter.IsOpen()) {
+            cacheWriter.Close();
+            cout << "Recorded " << cacheWriter.FramesWritten() << " frames to " << cacheFile << endl;
+        } else if (cacheWriter.Open(cacheFile, uint32_t(mpoints.size()), key == 'R')) {
+            cout << "Recording to " << cacheFile << (key == 'R' ? " with velocities" : "") << endl;
+        }
+    } else if (key == 'c' || key == 'C') {
+        if (quantizedWriter.IsOpen()) {
+            quantizedWriter.Close();
+            cout << "Recorded " << quantizedWriter.FramesWritten() << " frames to " << quantizedCacheFile << endl;
+        } else {
+            SceneSetup::Bounds bounds = SceneSetup::ComputeBounds(nodes);
+            if (quantizedWriter.Open(quantizedCacheFile, uint32_t(mpoints.size()), bounds.min, bounds.max)) {
+                cout << "Recording compressed to " << quantizedCacheFile << endl;
+            }
+        }
+    } else if (key == 'l') {
+        if (cachePlayer.IsOpen()) {
+            cachePlayer.Close();
+            cout << "Playback stopped." << endl;
+        } else if (cachePlayer.Open(cacheFile) && cachePlayer.NumNodes() == nodes.size()) {
+            quantizedPlayer.Close();
+            playbackFrame = 0;
+            cout << "Playing " << cachePlayer.NumFrames() << " frames from " << cacheFile << endl;
+        } else {
+            cachePlayer.Close();
+        }
+    } else if (key == 'L') {
+        if (quantizedPlayer.IsOpen()) {
+            quantizedPlayer.Close();
+            cout << "Playback stopped." << endl;
+        } else if (quantizedPlayer.Open(quantizedCacheFile) && quantizedPlayer.NumNodes() == nodes.size()) {
+            cachePlayer.Close();
+            playbackFrame = 0;
+            cout << "Playing " << quantizedPlayer.NumFrames() << " frames from " << quantizedCacheFile << endl;
+        } else {
+            quantizedPlayer.Close();
+        }
+    } else if (key == ' ') {
+        playbackPaused = !playbackPaused;
+    } else if (key == 'i' || key == 'I') {
+        wakeAll();
+        implicitMode = !implicitMode;
+        verletMode = false;
+        cout << (implicitMode ? "Implicit" : "Explicit") << " integration." << endl;
+    } else if (key == 'v' || key == 'V') {
+        wakeAll();
+        verletMode = !verletMode;
+        implicitMode = false;
+        if (verletMode) verletState.Load(mpoints, fixedStep);
+        cout << (verletMode ? "Verlet" : "Explicit") << " integration." << endl;
+    } else if (key == 'f' || key == 'F') {
+        wakeAll();
+        fusedStep = !fusedStep;
+        cout << (fusedStep ? "Fused" : "Separate") << " explicit step." << endl;
+    } else if (key == 'u' || key == 'U') {
+        wakeAll();
+        pinsReleased = !pinsReleased;
+        for (int node : pinnedNodes) {
+            Physics::SetPinned(mpoints, springs, activeSet, node, !pinsReleased);
+        }
+        sleepIslands.Build(mpoints, springs, activeSet);   // islands hold the free points only
+        layoutChanged();
+        stepControl.SetLimits(StepControl::ComputeLimits(mpoints, springs));
+        cout << (pinsReleased ? "Pins released." : "Pins restored.") << endl;
+    } else if (key == 'h' || key == 'H') {
+        hud.visible = !hud.visible;
+    } else if (key == 'k' || key == 'K') {
+        saveCheckpoint();
+    } else if (key == 'n' || key == 'N') {
+        addInstance();
+    } else if (key == 'z' || key == 'Z') {
+        sleepEnabled = !sleepEnabled;
+        instanceScene.sleepEnabled = sleepEnabled;
+        if (!sleepEnabled) wakeAll();
+        cout << "Sleep " << (sleepEnabled ? "on." : "off.") << endl;
+    } else if (key == 't' || key == 'T') {
+        adaptiveStep = !adaptiveStep;
+        cout << (adaptiveStep ? "Adaptive" : "Frame") << " time step." << endl;
+    } else if (key == 'p' || key == 'P') {
+        auto &pc = implicitState.pcg.preconditioner;
+        pc = Solver::Preconditioner((int(pc) + 1) % 4);
+        cout << "Preconditioner: " << Solver::PreconditionerName(pc) << endl;
     } else {
         camera.processKeyboard(key);
     }
@@ -101,10 +472,18 @@ void specialKeyboard(int key, int x, int y) {
         case GLUT_KEY_F6:
             // Reload shaders when F6 key is pressed
             prog.BuildFiles("vs.txt", "fs.txt");
+            instancedProg.BuildFiles("instanced_vs.txt", "fs.txt");
             prog.Bind();
             cout << "Shaders recompiled successfully." << endl;
             glutPostRedisplay();
             break;
+        // scrubbing through a cache being played back
+        case GLUT_KEY_LEFT:      playbackFrame = playbackFrame > 0 ? playbackFrame - 1 : 0; break;
+        case GLUT_KEY_RIGHT:     playbackFrame++; break;
+        case GLUT_KEY_PAGE_DOWN: playbackFrame = playbackFrame > 100 ? playbackFrame - 100 : 0; break;
+        case GLUT_KEY_PAGE_UP:   playbackFrame += 100; break;
+        case GLUT_KEY_HOME:      playbackFrame = 0; break;
+        case GLUT_KEY_END:       playbackFrame = std::max(cachePlayer.NumFrames(), quantizedPlayer.NumFrames()); break;
     }
 }
 void handleMouse(int button, int state, int x, int y) {
@@ -116,6 +495,7 @@ void handleMouse(int button, int state, int x, int y) {
     // Check for left mouse button click
     if (button == GLUT_LEFT_BUTTON && state == GLUT_UP) {
         Physics::OnMouseClick(x,y,externalForce);
+        wakeAll();
     }
 
     // Update last mouse position
@@ -135,77 +515,127 @@ void mouseMotion(int x, int y) {
 }
 
 
-void idle() {
-    // first, update physics
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> elapsedTime = currentTime - lastTime;
-    float deltaTime = elapsedTime.count();
-
-    //Physics::ProcessFloorCollision(physicsState, verticesWorldSpace);
-    Physics::PhysicsUpdate(mpoints, springs, externalForce, deltaTime);
-    externalForce = {0.0f,0.0f,0.0f};
-    for (size_t i = 0; i < mpoints.size(); ++i) {
-        nodes[i] = mpoints[i].position;
-    }
-    
-    // now push that updated block of memory into the VBO:
+// push a block of float3 positions in original node order into the VBO
+void uploadNodes(const void* positions) {
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     // offset = 0, size = whole buffer
     glBufferSubData(
         GL_ARRAY_BUFFER,
         0,
         nodes.size() * sizeof(cy::Vec3f),
-        nodes.data()
+        positions
     );
-
-    lastTime = currentTime;
-
-
-    glutPostRedisplay();
 }
 
-int main(int argc, char** argv) {
-    // Initialize GLUT
-    glutInit(&argc, argv);
-
-    // Set OpenGL version and profile
-    glutInitContextVersion(3, 3);
-    glutInitContextProfile(GLUT_CORE_PROFILE);
-
-    // Set up a double-buffered window with RGBA color
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
-
-    // some default settings
-    glutInitWindowSize(800, 600);
-    glutInitWindowPosition(100, 100);
+void idle() {
+    // first, update physics
+    auto currentTime = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> elapsedTime = currentTime - lastTime;
+    float deltaTime = deterministic ? fixedStep : elapsedTime.count();
+    lastTime = currentTime;
 
+    // playback feeds cached frames straight to the VBO, no physics
+    if (cachePlayer.IsOpen() || quantizedPlayer.IsOpen()) {
+        PROFILE_SCOPE("playback");
+        size_t numFrames = cachePlayer.IsOpen() ? cachePlayer.NumFrames() : quantizedPlayer.NumFrames();
+        if (numFrames > 0) {
+            playbackFrame = std::min(playbackFrame, numFrames - 1);
+            uploadNodes(cachePlayer.IsOpen() ? cachePlayer.Positions(playbackFrame) : quantizedPlayer.Decode(playbackFrame));
+            if (!playbackPaused) playbackFrame = (playbackFrame + 1) % numFrames;
+        }
+        glutPostRedisplay();
+        return;
+    }
 
-    // Create a window with a title
-    glutCreateWindow("HW3");
+    //Physics::ProcessFloorCollision(physicsState, verticesWorldSpace);
+    {
+        PROFILE_SCOPE("physics");
+        auto stepStart = std::chrono::high_resolution_clock::now();
+        // the cloth and fused copies go stale while another integrator steps
+        bool clothStep = cloth.Size() > 0 && !implicitMode && !verletMode && !fusedStep;
+        if (clothStep && !clothLoaded) cloth.Load(mpoints, activeSet.slotOf);
+        clothLoaded = clothStep;
+        bool fusedActive = fusedStep && !implicitMode && !verletMode;
+        if (fusedActive && !fusedLoaded) fusedState.Load(mpoints, springs);
+        fusedLoaded = fusedActive;
+        // adaptive steps cover the frame (less if they run out); deltaTime becomes the time simulated
+        if (implicitMode) {
+            auto step = [](float h) { Physics::PhysicsUpdateImplicit(mpoints, springs, externalForce, h, implicitState); };
+            if (adaptiveStep) deltaTime = stepControl.Advance(mpoints, activeSet.numFree, false, deltaTime, step);
+            else step(deltaTime);
+        } else if (verletMode) {
+            Verlet::VerletUpdate(verletState, springs, activeSet.Layout(), stepFeatures, externalForce, deltaTime);
+            verletState.Store(mpoints);
+        } else if (fusedActive) {
+            Physics::PhysicsUpdateFused(fusedState, stepFeatures, externalForce, deltaTime);
+            fusedState.Store(mpoints);
+        } else if (clothStep) {
+            cloth.Step(externalForce, deltaTime);
+            cloth.Store(mpoints, activeSet.slotOf);
+        } else {
+            if (!packedBuilt) packedSprings.Build(springs, activeSet.Layout());
+            packedBuilt = true;
+            Physics::StepFeatures features = stepFeatures;
+            features.hasFixed = false;   // fixed points sit behind the layout
+            auto step = [&features](float h) { Physics::PhysicsUpdate(mpoints, packedSprings, activeSet.Layout(), features, externalForce, h); };
+            if (adaptiveStep) deltaTime = stepControl.Advance(mpoints, activeSet.numFree, true, deltaTime, step);
+            else step(deltaTime);
+            if (sleepEnabled) {
+                PROFILE_SCOPE("sleep");
+                if (sleepIslands.Update(mpoints, springs, activeSet)) layoutChanged();
+            }
+        }
+        std::chrono::duration<double, std::milli> stepTime = std::chrono::high_resolution_clock::now() - stepStart;
+        physicsMs += 0.1 * (stepTime.count() - physicsMs);
+        stepRate.Tick();
+    }
+    if (instanceScene.Size() > 0) {
+        {
+            PROFILE_SCOPE("instances");
+            instanceScene.Step(externalForce, deltaTime);
+        }
+        PROFILE_SCOPE("instances upload");
+        uploadInstances();
+    }
+    externalForce = {0.0f,0.0f,0.0f};
+    simTime += deltaTime;
+    stepCount++;
+    if (hashLog.IsOpen()) {
+        PROFILE_SCOPE("hash");
+        hashLog.Write(stepCount, simTime, StateHash::Hash(mpoints));
+    }
+    if (simTime >= nextCheckpoint) {
+        PROFILE_SCOPE("checkpoint");
+        saveCheckpoint();
+        nextCheckpoint = simTime + checkpointInterval;
+    }
+    {
+        PROFILE_SCOPE("cache");
+        cacheWriter.Push(simTime, mpoints, activeSet.nodeAt);
+        quantizedWriter.Push(simTime, mpoints, activeSet.nodeAt);
+    }
 
-    // Initialize GLEW
-    glewInit();
-    glEnable(GL_DEPTH_TEST);  
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    {
+        PROFILE_SCOPE("nodes copy");
+        for (size_t i = 0; i < mpoints.size(); ++i) {
+            nodes[activeSet.nodeAt[i]] = cy::Vec3f(mpoints[i].position);
+        }
+    }
+    {
+        PROFILE_SCOPE("upload");
+        uploadNodes(nodes.data());
+    }
 
-    // Set up callbacks
-    glutDisplayFunc(display);
-    glutKeyboardFunc(keyboard);
-    glutSpecialFunc(specialKeyboard);
-    glutIdleFunc(idle);
-    glutMouseFunc(handleMouse);
-    glutMotionFunc(mouseMotion);
 
-    
-    //init camera
-    camera.setPerspectiveMatrix(65,800.0f/600.0f, 2.0f, 600.0f);
+    glutPostRedisplay();
+}
 
-    // load volumetric model
+// Loads the armadillo and builds its render data; returns the tetrahedra for the physics setup.
+std::vector<Models::Tetrahedron> loadMesh() {
     std::vector<Models::Tetrahedron> tetrahedra;
-
-
-    if (!Models::loadNodes("armadillo_50k_tet.node", nodes, centroid)) { /* error handling */ }
-    if (!Models::loadTetrahedra("armadillo_50k_tet.ele", tetrahedra)) { /* error handling */ }
+    int firstIndex = 0;
+    if (!Models::loadNodes("armadillo_50k_tet.node", nodes, centroid, firstIndex)) { /* error handling */ }
+    if (!Models::loadTetrahedra("armadillo_50k_tet.ele", tetrahedra, firstIndex)) { /* error handling */ }
 
 
     // Extract the surface triangles from the tetrahedral mesh
@@ -214,7 +644,7 @@ int main(int argc, char** argv) {
     std::cout << "No. of surface faces = " << surfaceFaces.size() << std::endl;
 
     // Build the surface mesh data for OpenGL rendering
-    std::vector<unsigned int> surfaceIndices;
+    surfaceIndices.clear();
 
 
     // Populate the indices using the surfaceFaces
@@ -224,11 +654,7 @@ int main(int argc, char** argv) {
         surfaceIndices.push_back(face.c);
     }
 
-    num_vertices = surfaceIndices.size();
-    verticesWorldSpace.resize(num_vertices);
-
-
-    std::vector<cy::Vec3f> surfaceNormals(nodes.size(), cy::Vec3f(0.0f, 0.0f, 0.0f));
+    surfaceNormals.assign(nodes.size(), cy::Vec3f(0.0f, 0.0f, 0.0f));
 
     // Loop through each face and add its normal to its vertices.
     for (const auto &face : surfaceFaces) {
@@ -255,6 +681,147 @@ int main(int argc, char** argv) {
         if (len > 0.0f)
             surfaceNormals[i] /= len;
     }
+
+    return tetrahedra;
+}
+
+// a clothWidth x clothHeight grid hanging from its top row, tilted so it swings
+void initCloth() {
+    cloth.Init(clothWidth, clothHeight, Cloth::Params(), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(1.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, -0.5f, 0.866f));
+}
+
+// Builds the cloth grid (--cloth) and its render data, in place of loadMesh.
+void loadCloth() {
+    initCloth();
+    nodes.clear();
+    centroid = cy::Vec3f(0.0f, 0.0f, 0.0f);
+    for (auto &mp : cloth.MassPoints()) {
+        nodes.push_back(cy::Vec3f(mp.position));
+        centroid += nodes.back();
+    }
+    centroid /= float(nodes.size());
+    surfaceIndices = cloth.Triangles();
+
+    surfaceNormals.assign(nodes.size(), cy::Vec3f(0.0f, 0.0f, 0.0f));
+    for (size_t t = 0; t < surfaceIndices.size(); t += 3) {
+        unsigned int a = surfaceIndices[t], b = surfaceIndices[t + 1], c = surfaceIndices[t + 2];
+        cy::Vec3f faceNormal = (nodes[b] - nodes[a]).Cross(nodes[c] - nodes[a]).GetNormalized();
+        surfaceNormals[a] += faceNormal;
+        surfaceNormals[b] += faceNormal;
+        surfaceNormals[c] += faceNormal;
+    }
+    for (auto &n : surfaceNormals) n.Normalize();
+}
+
+void setupPhysics(const std::vector<Models::Tetrahedron>& tetrahedra) {
+    if (cloth.Size() > 0) {
+        mpoints = cloth.MassPoints();
+        Physics::PinTop(mpoints, 0.0f);   // the top row
+        springs = cloth.Springs();
+    } else {
+        // the top 1/3 fixed, soft springs
+        auto body = SceneSetup::MakeBody<SimPrecision>(nodes, Models::extractEdges(tetrahedra));
+        mpoints = std::move(body.mpoints);
+        springs = std::move(body.springs);
+    }
+    stepFeatures = Physics::DetectFeatures(mpoints, springs);
+
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        if (mpoints[i].fixed) pinnedNodes.push_back(int(i));
+    }
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    sleepIslands.Build(mpoints, springs, activeSet);
+    stepControl.SetLimits(StepControl::ComputeLimits(mpoints, springs));
+}
+
+int main(int argc, char** argv) {
+    // Initialize GLUT
+    glutInit(&argc, argv);
+
+    // Set OpenGL version and profile
+    glutInitContextVersion(3, 3);
+    glutInitContextProfile(GLUT_CORE_PROFILE);
+
+    // Set up a double-buffered window with RGBA color
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+
+    // some default settings
+    glutInitWindowSize(800, 600);
+    glutInitWindowPosition(100, 100);
+
+
+    // Create a window with a title
+    glutCreateWindow("HW3");
+
+    // Initialize GLEW
+    glewInit();
+    glEnable(GL_DEPTH_TEST);  
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Set up callbacks
+    glutDisplayFunc(display);
+    glutKeyboardFunc(keyboard);
+    glutSpecialFunc(specialKeyboard);
+    glutIdleFunc(idle);
+    glutMouseFunc(handleMouse);
+    glutMotionFunc(mouseMotion);
+
+    
+    //init camera
+    camera.setPerspectiveMatrix(65,800.0f/600.0f, 2.0f, 600.0f);
+
+    bool resume = false;
+    int numInstances = 0;
+    int clothSize[2] = { 0, 0 };
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--resume") resume = true;
+        else if (arg == "--deterministic") deterministic = true;
+        else if (arg == "--hash-log" && i + 1 < argc) hashLog.Open(argv[++i]);
+        else if (arg == "--instances" && i + 1 < argc) numInstances = atoi(argv[++i]);
+        else if (arg == "--cloth" && i + 1 < argc) std::sscanf(argv[++i], "%dx%d", &clothSize[0], &clothSize[1]);
+        else cout << "Unknown option " << arg << endl;
+    }
+
+    // resuming restores everything below from the checkpoint, so no mesh parsing or topology building
+    bool resumed = resume && Checkpoint::Load("hw3.checkpoint", [](Checkpoint::Reader& ar) { transferState(ar); });
+    if (resumed) {
+        // matrix values are reassembled every step, only the pattern is stored
+        implicitState.matrix.val.assign(implicitState.matrix.col.size(), 0);
+        verletState.accel.resize(verletState.position.size());   // scratch
+        instanceScene.sleepEnabled = sleepEnabled;
+        stepControl.SetLimits(StepControl::ComputeLimits(mpoints, springs));
+        cout << "Resumed at t=" << simTime << endl;
+    } else {
+        // a failed load may have filled part of the state
+        nodes.clear();
+        pinnedNodes.clear();
+        pinsReleased = false;
+        instanceScene.states.clear();
+        implicitMode = false;
+        implicitState = Physics::ImplicitState();
+        verletMode = false;
+        fusedStep = false;
+        clothWidth = clothSize[0];
+        clothHeight = clothSize[1];
+        simTime = 0.0;
+        stepCount = 0;
+        nextCheckpoint = checkpointInterval;
+    }
+    implicitState.pcg.deterministic = deterministic;
+
+    // load volumetric model
+    std::vector<Models::Tetrahedron> tetrahedra;
+    if (resumed) {
+        if (clothWidth > 0) initCloth();   // the state itself comes from mpoints
+    } else if (clothWidth > 1 && clothHeight > 1) {
+        loadCloth();
+    } else {
+        tetrahedra = loadMesh();
+    }
+
+    num_vertices = surfaceIndices.size();
+    verticesWorldSpace.resize(num_vertices);
     
     // set up VAO and VBO and EBO and NBO
     glGenVertexArrays(1, &VAO); 
@@ -302,67 +869,27 @@ int main(int argc, char** argv) {
     // link shaders
     prog.BuildFiles("vs.txt", "fs.txt");
     planeProg.BuildFiles("plane_vs.txt", "plane_fs.txt");
+    instancedProg.BuildFiles("instanced_vs.txt", "fs.txt");
+    hud.Initialize();
 
 
     // physics stuff: set up mass points and springs
-    mpoints.reserve(nodes.size());
-
-    for (auto &p : nodes) {
-        MassPoint mp;
-        mp.position = p;
-        mp.mass     = 1.0f;
-        mp.fixed    = false;
-        mpoints.push_back(mp);
-    }
-
-    // say you want the top 1/3 fixed:
-    const float fraction = 1.0f/3.0f;
-
-    // first find min and max y
-    float yMin = mpoints[0].position.y;
-    float yMax = yMin;
-    for (auto &mp : mpoints) {
-        yMin = std::min(yMin, mp.position.y);
-        yMax = std::max(yMax, mp.position.y);
-    }
-    // cutoff: everything above (1–fraction) up from yMin → fix the top fraction
-    float cutoff = yMin + (yMax - yMin)*(1.0f - fraction);
-
-    for (auto &mp : mpoints) {
-        if (mp.position.y >= cutoff) {
-            mp.fixed = true;
-        }
-    }
-
-    std::vector<std::pair<int,int>> rawEdges;
-    rawEdges.reserve(tetrahedra.size()*6);
-
-    for (auto &T : tetrahedra) {
-        int v[4] = {T.v[0], T.v[1], T.v[2], T.v[3]};
-        // the 6 edges
-        rawEdges.emplace_back(std::min(v[0],v[1]), std::max(v[0],v[1]));
-        rawEdges.emplace_back(std::min(v[0],v[2]), std::max(v[0],v[2]));
-        rawEdges.emplace_back(std::min(v[0],v[3]), std::max(v[0],v[3]));
-        rawEdges.emplace_back(std::min(v[1],v[2]), std::max(v[1],v[2]));
-        rawEdges.emplace_back(std::min(v[1],v[3]), std::max(v[1],v[3]));
-        rawEdges.emplace_back(std::min(v[2],v[3]), std::max(v[2],v[3]));
-    }
-
-    // sort & unique
-    std::sort(rawEdges.begin(), rawEdges.end());
-    rawEdges.erase(std::unique(rawEdges.begin(), rawEdges.end()), rawEdges.end());
-
-    springs.reserve(rawEdges.size());
-
-    for (auto &e : rawEdges) {
-        Spring s;
-        s.a = e.first;
-        s.b = e.second;
-        // rest length from initial positions
-        s.restLength = (mpoints[s.a].position - mpoints[s.b].position).Length();
-        s.stiffness  = 0.2f;
-        s.damping    = 0.01f;
-        springs.push_back(s);
+    if (!resumed) setupPhysics(tetrahedra);
+
+    // new instances start from the first armadillo's state (its rest pose unless resumed), with the original pins
+    std::vector<MassPoint> rest = mpoints;
+    for (int node : pinnedNodes) rest[activeSet.slotOf[node]].fixed = true;
+    instanceScene.SetTopology(Instances::MakeTopology(rest, springs, activeSet.nodeAt));
+    glGenBuffers(1, &instanceBuffer);
+    glGenTextures(1, &instanceTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, instanceBuffer);
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxInstanceFloats);
+    if (resumed) {
+        uploadInstances();
+    } else {
+        for (int i = 0; i < numInstances; i++) addInstance();
     }
 
 
@@ -0,0 +1,69 @@
+// Batch driver for HW3 parameter sweeps (see Sweep.h for the spec format).
+// Runs every combination of the spec headlessly, one simulation per worker thread, and appends
+// a row to the results table as each run finishes.
+//
+// usage: hw3_sweep spec.txt [results.csv] [workers]   (run from the build directory)
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "cyTriMesh.h"
+#include "cyMatrix.h"
+#include "Physics.h"
+#include "Models.h"
+#include "Sweep.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "usage: hw3_sweep spec.txt [results.csv] [workers]" << endl;
+        return 1;
+    }
+    const char* resultsFile = argc > 2 ? argv[2] : "sweep_results.csv";
+    int workers = argc > 3 ? atoi(argv[3]) : int(std::thread::hardware_concurrency());
+
+    Sweep::Spec spec;
+    if (!Sweep::LoadSpec(argv[1], spec)) return 1;
+    std::vector<Sweep::RunParams> runs = spec.Expand();
+
+    std::map<std::string, Sweep::Mesh> meshes;
+    for (auto &name : spec.meshes) {
+        Sweep::Mesh &mesh = meshes[name];
+        cy::Vec3f centroid(0.0f, 0.0f, 0.0f);
+        std::vector<Models::Tetrahedron> tetrahedra;
+        int firstIndex = 0;
+        if (!Models::loadNodes(name + ".node", mesh.nodes, centroid, firstIndex)) return 1;
+        if (!Models::loadTetrahedra(name + ".ele", tetrahedra, firstIndex)) return 1;
+        mesh.edges = Models::extractEdges(tetrahedra);
+    }
+
+    // most expensive first, so the last runs to start are short ones
+    auto cost = [&](const Sweep::RunParams& r) { return double(meshes[r.mesh].edges.size()) * r.Steps() * (r.implicit ? 10 : 1); };
+    std::vector<size_t> order(runs.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return cost(runs[a]) > cost(runs[b]); });
+
+    Sweep::ResultsTable table;
+    if (!table.Open(resultsFile)) return 1;
+    Sweep::WorkStealingPool pool(workers);
+    cout << runs.size() << " runs on " << pool.Workers() << " workers" << endl;
+
+    std::mutex consoleMutex;
+    std::atomic<size_t> finished{0};
+    auto start = std::chrono::steady_clock::now();
+    pool.Run(order, [&](size_t index, int worker) {
+        const Sweep::RunParams &r = runs[index];
+        Sweep::RunResult result = Sweep::Simulate<SimPrecision>(r, meshes.at(r.mesh));
+        result.worker = worker;
+        table.Write(result);
+        std::lock_guard<std::mutex> lock(consoleMutex);
+        cout << "[" << ++finished << "/" << runs.size() << "] " << r.mesh << " k " << r.stiffness << " c " << r.damping
+             << " dt " << r.dt << " pin " << r.pinFraction << " " << (r.implicit ? "implicit" : "explicit")
+             << (result.stable ? "" : " UNSTABLE") << "\tmax displacement " << result.maxDisplacement
+             << "\tenergy drift " << result.energyDrift << "\t" << result.wallMs << " ms" << endl;
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    cout << "done in " << elapsed.count() << " s, " << pool.Steals() << " runs stolen, results in " << resultsFile << endl;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef TESTSCENE_H
+#define TESTSCENE_H
+
+// Shared by the HW3 tests (one per feature, run by ctest): CHECK, which reports a failed
+// condition and lets the test go on, and a small tetrahedral block that stands in for the
+// armadillo, so the tests need no data files and finish in well under a second each.
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "cyTriMesh.h"
+#include "cyMatrix.h"
+#include "Models.h"
+#include "SceneSetup.h"
+
+namespace TestScene {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition << std::endl; \
+            TestScene::Failures()++; \
+        } \
+    } while (0)
+
+// The exit code of a test: 0 if every CHECK held.
+inline int Finish(const char* name) {
+    std::cout << name << ": " << (Failures() ? "FAILED" : "passed") << std::endl;
+    return Failures() ? 1 : 0;
+}
+
+struct Mesh {
+    std::vector<cy::Vec3f>            nodes;
+    std::vector<std::pair<int,int>>   edges;
+};
+
+// nx * ny * nz nodes at unit spacing, each cell split into the six tetrahedra around its
+// diagonal; hung from its top third like the armadillo.
+inline Mesh Block(int nx, int ny, int nz) {
+    Mesh mesh;
+    auto node = [&](int x, int y, int z) { return (z * ny + y) * nx + x; };
+    for (int z = 0; z < nz; z++) {
+        for (int y = 0; y < ny; y++) {
+            for (int x = 0; x < nx; x++) mesh.nodes.push_back(cy::Vec3f(float(x), float(y), float(z)));
+        }
+    }
+    // cell corners by bits (x, y, z) = (1, 2, 4); every tetrahedron holds corners 0 and 7
+    const int tets[6][2] = { {1, 3}, {3, 2}, {2, 6}, {6, 4}, {4, 5}, {5, 1} };
+    std::vector<Models::Tetrahedron> tetrahedra;
+    for (int z = 0; z + 1 < nz; z++) {
+        for (int y = 0; y + 1 < ny; y++) {
+            for (int x = 0; x + 1 < nx; x++) {
+                int corner[8];
+                for (int c = 0; c < 8; c++) corner[c] = node(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1));
+                for (auto &t : tets) tetrahedra.push_back({ { corner[0], corner[t[0]], corner[t[1]], corner[7] } });
+            }
+        }
+    }
+    mesh.edges = Models::extractEdges(tetrahedra);
+    return mesh;
+}
+
+// Brings a stiff body to its hanging rest shape with large implicit steps, as the sleep bench
+// does; the explicit step alone takes thousands of steps to damp it out.
+template <typename P>
+inline void Settle(std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs) {
+    Physics::ImplicitStateT<P> settle;
+    for (int i = 0; i < 400; i++) Physics::PhysicsUpdateImplicit(mpoints, springs, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f, settle);
+    for (auto &mp : mpoints) mp.velocity = cy::Vec3<typename P::Storage>(0, 0, 0);
+}
+
+} // namespace TestScene
+
+#endif // TESTSCENE_H
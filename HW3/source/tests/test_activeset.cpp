@@ -0,0 +1,115 @@
+// Active-set layout (ActiveSet.h): BuildActiveSet and every SetPinned keep free points ahead of
+// pinned ones and each spring in the group of its ends, with the free end of a free-pinned
+// spring in a; SetPinned leaves the point it pins or releases at rest; the incremental layout
+// after a run of pins and releases groups the springs like a rebuild, as does RelayoutActiveSet
+// after many flags flip at once; and a step over the free points moves them like the full step
+// over all of them.
+
+#include <set>
+#include "TestScene.h"
+#include "ActiveSet.h"
+
+using P = SimPrecision;
+
+static bool LayoutHolds(const std::vector<MassPointT<P>>& mpoints, const std::vector<SpringT<P>>& springs, const Physics::ActiveSetT<P>& as) {
+    bool holds = as.freeFreeEnd <= as.freePinnedEnd && as.freePinnedEnd <= springs.size();
+    for (size_t slot = 0; slot < mpoints.size(); slot++) {
+        holds &= mpoints[slot].fixed == (slot >= as.numFree);
+        holds &= as.slotOf[as.nodeAt[slot]] == int(slot);
+    }
+    for (size_t si = 0; si < springs.size(); si++) {
+        const auto &s = springs[si];
+        int group = int(mpoints[s.a].fixed) + int(mpoints[s.b].fixed);
+        holds &= group == (si < as.freeFreeEnd ? 0 : (si < as.freePinnedEnd ? 1 : 2));
+        if (group == 1) holds &= !mpoints[s.a].fixed;
+    }
+    if (as.incident.empty()) return holds;   // dropped by a relayout until SetPinned needs them
+    size_t incidences = 0;
+    for (auto &list : as.incident) incidences += list.size();
+    for (size_t si = 0; si < springs.size(); si++) {
+        for (int slot : { springs[si].a, springs[si].b }) holds &= std::count(as.incident[slot].begin(), as.incident[slot].end(), int(si)) == 1;
+    }
+    return holds && incidences == 2 * springs.size();
+}
+
+// The springs as sets of original node pairs, one set per group.
+static std::set<std::pair<int,int>> Group(const std::vector<SpringT<P>>& springs, const Physics::ActiveSetT<P>& as, size_t begin, size_t end) {
+    std::set<std::pair<int,int>> group;
+    for (size_t si = begin; si < end; si++) {
+        int a = as.nodeAt[springs[si].a], b = as.nodeAt[springs[si].b];
+        group.insert({ std::min(a, b), std::max(a, b) });
+    }
+    return group;
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(4, 6, 4);
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+
+    // the active-set step against the full step, compared in node order
+    {
+        auto fullPoints = mpoints;
+        auto fullSprings = springs;
+        auto activePoints = mpoints;
+        auto activeSprings = springs;
+        Physics::ActiveSetT<P> as;
+        Physics::BuildActiveSet(activePoints, activeSprings, as);
+        CHECK(LayoutHolds(activePoints, activeSprings, as));
+        CHECK(as.numFree > 0 && as.numFree < activePoints.size() && as.freePinnedEnd < activeSprings.size());
+        Physics::StepFeatures features = Physics::DetectFeatures(fullPoints, fullSprings);
+        for (int step = 0; step < 200; step++) {
+            Physics::PhysicsUpdate(fullPoints, fullSprings, features, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f / 60.0f);
+            Physics::PhysicsUpdate(activePoints, activeSprings, as, features, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f / 60.0f);
+        }
+        float difference = 0.0f;
+        for (size_t slot = 0; slot < activePoints.size(); slot++) {
+            difference = std::max(difference, float((activePoints[slot].position - fullPoints[as.nodeAt[slot]].position).Length()));
+        }
+        CHECK(difference < 1e-3f);
+    }
+
+    // pins and releases in a fixed pseudo-random order, checked after each, against a rebuild
+    {
+        Physics::ActiveSetT<P> as;
+        Physics::BuildActiveSet(mpoints, springs, as);
+        bool holds = true, releasedAtRest = true, pinnedAtRest = true;
+        unsigned state = 12345;
+        for (int i = 0; i < 300; i++) {
+            state = state * 1664525u + 1013904223u;
+            int node = int((state >> 8) % mpoints.size());
+            bool pinned = (state >> 4) & 1;
+            mpoints[as.slotOf[node]].velocity = decltype(mpoints[0].velocity)(1, 2, 3);
+            bool wasPinned = mpoints[as.slotOf[node]].fixed;
+            Physics::SetPinned(mpoints, springs, as, node, pinned);
+            if (wasPinned && !pinned) releasedAtRest &= mpoints[as.slotOf[node]].velocity == decltype(mpoints[0].velocity)(0, 0, 0);
+            if (!wasPinned && pinned) pinnedAtRest &= mpoints[as.slotOf[node]].velocity == decltype(mpoints[0].velocity)(0, 0, 0);
+            holds &= LayoutHolds(mpoints, springs, as);
+        }
+        CHECK(holds);
+        CHECK(releasedAtRest);
+        CHECK(pinnedAtRest);
+
+        auto rebuiltPoints = mpoints;
+        auto rebuiltSprings = springs;
+        Physics::ActiveSetT<P> rebuilt;
+        Physics::BuildActiveSet(rebuiltPoints, rebuiltSprings, rebuilt);
+        for (auto &slot : rebuilt.nodeAt) slot = as.nodeAt[slot];   // rebuilt slots were the incremental ones
+        CHECK(rebuilt.numFree == as.numFree);
+        CHECK(Group(springs, as, 0, as.freeFreeEnd) == Group(rebuiltSprings, rebuilt, 0, rebuilt.freeFreeEnd));
+        CHECK(Group(springs, as, as.freeFreeEnd, as.freePinnedEnd) == Group(rebuiltSprings, rebuilt, rebuilt.freeFreeEnd, rebuilt.freePinnedEnd));
+        CHECK(Group(springs, as, as.freePinnedEnd, springs.size()) == Group(rebuiltSprings, rebuilt, rebuilt.freePinnedEnd, rebuiltSprings.size()));
+
+        // many flags flipped in place at once, then one relayout
+        for (size_t slot = 0; slot < mpoints.size(); slot += 3) mpoints[slot].fixed = !mpoints[slot].fixed;
+        std::vector<int> nodesBefore = as.nodeAt;
+        Physics::RelayoutActiveSet(mpoints, springs, as);
+        CHECK(LayoutHolds(mpoints, springs, as));
+        std::sort(nodesBefore.begin(), nodesBefore.end());
+        std::vector<int> nodesAfter = as.nodeAt;
+        std::sort(nodesAfter.begin(), nodesAfter.end());
+        CHECK(nodesBefore == nodesAfter);
+        Physics::SetPinned(mpoints, springs, as, as.nodeAt[0], true);   // rebuilds the incident lists
+        CHECK(LayoutHolds(mpoints, springs, as) && !as.incident.empty());
+    }
+    return TestScene::Finish("activeset");
+}
@@ -0,0 +1,74 @@
+// Adaptive step control (StepControl.h): the stability limit of a single damped spring matches
+// the closed form, a hard-poked stiff body stays finite and close to a finely stepped reference
+// while the fixed step is far off, frame time is neither lost nor invented, and a step that
+// produces a non-finite state is rolled back.
+
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "StepControl.h"
+
+int main() {
+    const float frame = 1.0f / 60.0f;
+    const cy::Vec3f externalForce(0.0f, 0.0f, 0.0f);
+
+    // one free point on a spring to a pin: w = sqrt(2 k / m), x = c / (m w)
+    {
+        std::vector<MassPoint> pair(2);
+        pair[0].position = decltype(pair[0].position)(0, 0, 0);
+        pair[1].position = decltype(pair[1].position)(0, 1, 0);
+        pair[0].mass = pair[1].mass = 2.0f;
+        pair[1].fixed = true;
+        std::vector<Spring> spring = { { 0, 1, 1.0f, 50.0f, 3.0f } };
+        auto limits = StepControl::ComputeLimits(pair, spring);
+        double w = std::sqrt(2.0 * 50.0 / 2.0), x = 3.0 / (2.0 * w);
+        CHECK(std::abs(limits.stable - 2.0 / w * (std::sqrt(1.0 + x * x) - x)) < 1e-6);
+        CHECK(limits.length == 1.0f);
+    }
+
+    TestScene::Mesh mesh = TestScene::Block(4, 6, 4);
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(mesh.nodes, mesh.edges, SceneSetup::Stiff);
+    Physics::ActiveSet activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    features.hasFixed = false;
+    for (size_t slot = 0; slot < activeSet.numFree; slot++) {
+        if (mesh.nodes[activeSet.nodeAt[slot]].y == 0.0f) mpoints[slot].velocity = decltype(mpoints[slot].velocity)(200, 0, 0);
+    }
+    auto step = [&](std::vector<MassPoint>& points, float h) { Physics::PhysicsUpdate(points, springs, activeSet.Layout(), features, externalForce, h); };
+
+    const int frames = 30, refine = 40;
+    auto reference = mpoints, fixed = mpoints, adaptive = mpoints;
+    for (int f = 0; f < frames * refine; f++) step(reference, frame / refine);
+    for (int f = 0; f < frames; f++) step(fixed, frame);
+
+    StepControl::Controller controller;
+    controller.SetLimits(StepControl::ComputeLimits(mpoints, springs));
+    int substeps = 0;
+    for (int f = 0; f < frames; f++) {
+        float covered = controller.Advance(adaptive, activeSet.numFree, true, frame, [&](float h) { step(adaptive, h); });
+        CHECK(std::abs(covered - frame) < 1e-6f);
+        substeps += controller.substeps;
+    }
+    CHECK(substeps > frames);
+
+    auto maxDistance = [&](const std::vector<MassPoint>& points) {
+        double d = 0.0;
+        for (size_t i = 0; i < points.size(); i++) {
+            double di = (points[i].position - reference[i].position).Length();
+            d = std::isfinite(di) ? std::max(d, di) : std::numeric_limits<double>::infinity();
+        }
+        return d;
+    };
+    double fixedError = maxDistance(fixed), adaptiveError = maxDistance(adaptive);
+    CHECK(std::isfinite(adaptiveError));
+    CHECK(adaptiveError < 0.5 * fixedError);
+
+    // a step that blows up is undone and retried smaller, down to dtMin, then the frame is dropped
+    auto before = adaptive;
+    StepControl::Controller failing;
+    failing.SetLimits(controller.limits);
+    failing.Advance(adaptive, activeSet.numFree, true, frame, [&](float) { adaptive[0].velocity.x = NAN; });
+    CHECK(failing.substeps == 0 && failing.rejected > 0);
+    CHECK(std::memcmp(before.data(), adaptive.data(), adaptive.size() * sizeof(MassPoint)) == 0);
+    return TestScene::Finish("adaptive");
+}
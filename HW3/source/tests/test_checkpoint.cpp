@@ -0,0 +1,108 @@
+// Checkpoint/restart (Checkpoint.h): a run resumed from a snapshot ends bit-exact with the run
+// that took it, explicit or Verlet, and a snapshot with a flipped byte or a missing tail is rejected.
+
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "Checkpoint.h"
+#include "Verlet.h"
+
+struct State {
+    double simTime = 0.0;
+    std::vector<MassPoint> mpoints;
+    std::vector<Spring> springs;
+    Physics::ActiveSet activeSet;
+    bool verletMode = false;
+    Verlet::VerletState verletState;
+
+    template <typename Archive>
+    void Transfer(Archive& ar) {
+        ar(simTime);
+        ar(mpoints);
+        ar(springs);
+        ar(activeSet.numFree);
+        ar(activeSet.freeFreeEnd);
+        ar(activeSet.freePinnedEnd);
+        ar(activeSet.nodeAt);
+        ar(activeSet.slotOf);
+        ar(verletMode);
+        ar(verletState.position);
+        ar(verletState.previous);
+        ar(verletState.invMass);
+        ar(verletState.uniformInvMass);
+        ar(verletState.lastStep);
+    }
+
+    void Run(int steps) {
+        const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+        const float dt = 1.0f / 60.0f;
+        auto features = Physics::DetectFeatures(mpoints, springs);
+        verletState.accel.resize(verletState.position.size());
+        for (int i = 0; i < steps; i++) {
+            if (verletMode) {
+                Verlet::VerletUpdate(verletState, springs, activeSet.Layout(), features, externalForce, dt);
+                verletState.Store(mpoints);
+            } else {
+                Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+            }
+            simTime += dt;
+        }
+    }
+};
+
+static bool SameBytes(const std::vector<MassPoint>& a, const std::vector<MassPoint>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(MassPoint)) == 0;
+}
+
+// Rewrites the checkpoint after edit() changed its bytes.
+template <typename Edit>
+static void Damage(const char* fileName, const char* damagedName, Edit edit) {
+    std::ifstream in(fileName, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    edit(bytes);
+    std::ofstream out(damagedName, std::ios::binary);
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+// Saves halfway through a run and checks that the resumed half ends where the original did.
+static void CheckResume(const TestScene::Mesh& mesh, const char* checkpointFile, bool verletMode) {
+    State original;
+    auto body = SceneSetup::MakeBody<SimPrecision>(mesh.nodes, mesh.edges);
+    original.mpoints = std::move(body.mpoints);
+    original.springs = std::move(body.springs);
+    Physics::BuildActiveSet(original.mpoints, original.springs, original.activeSet);
+    original.verletMode = verletMode;
+    if (verletMode) original.verletState.Load(original.mpoints, 1.0f / 60.0f);
+    original.Run(30);
+    const double savedTime = original.simTime;
+    {
+        Checkpoint::Saver saver(checkpointFile);
+        saver.Save([&](Checkpoint::Writer& ar) { original.Transfer(ar); });
+        original.Run(30);   // keeps stepping while the snapshot is written
+    }
+
+    State resumed;
+    CHECK(Checkpoint::Load(checkpointFile, [&](Checkpoint::Reader& ar) { resumed.Transfer(ar); }));
+    CHECK(resumed.simTime == savedTime);
+    resumed.Run(30);
+    CHECK(resumed.simTime == original.simTime);
+    CHECK(SameBytes(resumed.mpoints, original.mpoints));
+    CHECK(resumed.activeSet.nodeAt == original.activeSet.nodeAt);
+}
+
+int main() {
+    const char* checkpointFile = "test_checkpoint.checkpoint";
+    const char* damagedFile = "test_checkpoint.damaged";
+    TestScene::Mesh mesh = TestScene::Block(4, 6, 4);
+    CheckResume(mesh, checkpointFile, true);
+    CheckResume(mesh, checkpointFile, false);
+
+    State rejected;
+    Damage(checkpointFile, damagedFile, [](std::vector<char>& bytes) { bytes[bytes.size() / 2] ^= 0x10; });
+    CHECK(!Checkpoint::Load(damagedFile, [&](Checkpoint::Reader& ar) { rejected.Transfer(ar); }));
+    Damage(checkpointFile, damagedFile, [](std::vector<char>& bytes) { bytes.resize(bytes.size() - 8); });
+    CHECK(!Checkpoint::Load(damagedFile, [&](Checkpoint::Reader& ar) { rejected.Transfer(ar); }));
+
+    std::remove(checkpointFile);
+    std::remove(damagedFile);
+    return TestScene::Finish("checkpoint");
+}
@@ -0,0 +1,132 @@
+// Quantized cache codec (CacheCodec.h): every decoded coordinate stays within the error bound
+// with either predictor, a frame sought from another keyframe decodes to the same values as in
+// sequence, a quiet body compresses well below the raw cache, and a damaged index is rebuilt
+// from the records.
+
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "CacheCodec.h"
+
+// Records frames of a hanging block and checks the decoded cache against them.
+static void checkPredictor(Cache::Predictor predictor, float errorBound) {
+    const char* cacheFile = "test_codec.cache";
+    TestScene::Mesh mesh = TestScene::Block(5, 8, 5);
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(mesh.nodes, mesh.edges);
+    Physics::ActiveSet activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    SceneSetup::Bounds bounds = SceneSetup::ComputeBounds(mesh.nodes);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    const float dt = 1.0f / 60.0f;
+    const int frames = 50;
+
+    Cache::CodecSettings settings;
+    settings.errorBound  = errorBound;
+    settings.keyInterval = 16;
+    settings.predictor   = predictor;
+    Cache::QuantizedWriter writer;
+    CHECK(writer.Open(cacheFile, uint32_t(mpoints.size()), bounds.min, bounds.max, settings));
+    std::vector<std::vector<MassPoint>> recorded;
+    for (int i = 0; i < frames; i++) {
+        Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+        writer.Push((i + 1) * double(dt), mpoints, activeSet.nodeAt);
+        recorded.push_back(mpoints);
+    }
+    CHECK(writer.FramesWritten() == size_t(frames));
+    writer.Close();
+
+    std::ifstream sizeProbe(cacheFile, std::ios::binary | std::ios::ate);
+    CHECK(double(sizeProbe.tellg()) < 0.5 * frames * Cache::FrameBytes(uint32_t(mpoints.size()), 0));
+
+    Cache::QuantizedPlayer player, seeker;
+    CHECK(player.Open(cacheFile));
+    CHECK(seeker.Open(cacheFile));
+    CHECK(player.NumFrames() == size_t(frames));
+    double maxExcess = -1.0;
+    bool seekMatches = true;
+    for (int f = 0; f < frames && player.NumFrames() == size_t(frames); f++) {
+        CHECK(player.Time(f) == (f + 1) * double(dt));
+        const float* decoded = player.Decode(f);
+        std::vector<float> sequential(decoded, decoded + 3 * mpoints.size());
+        seeker.Decode((f + frames / 2) % frames);
+        const float* sought = seeker.Decode(f);
+        for (size_t slot = 0; slot < mpoints.size(); slot++) {
+            size_t i = size_t(activeSet.nodeAt[slot]);
+            for (int k = 0; k < 3; k++) {
+                float x = float(recorded[f][slot].position[k]);
+                // the bound holds on the grid; storing the result as float adds up to one ulp
+                double ulp = std::nextafter(std::abs(x), INFINITY) - std::abs(x);
+                maxExcess = std::max(maxExcess, std::abs(double(sequential[3 * i + k]) - x) - errorBound - ulp);
+                seekMatches &= sought[3 * i + k] == sequential[3 * i + k];
+            }
+        }
+    }
+    CHECK(maxExcess <= 0.0);
+    CHECK(seekMatches);
+    std::remove(cacheFile);
+}
+
+// Damages the index of a short cache in several ways; each copy must open with the frames its
+// records still hold and decode them as the intact file does.
+static void checkDamagedIndex() {
+    const char* cacheFile = "test_codec.cache";
+    TestScene::Mesh mesh = TestScene::Block(3, 4, 3);
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(mesh.nodes, mesh.edges);
+    Physics::ActiveSet activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    SceneSetup::Bounds bounds = SceneSetup::ComputeBounds(mesh.nodes);
+    const int frames = 10;
+    Cache::QuantizedWriter writer;
+    CHECK(writer.Open(cacheFile, uint32_t(mpoints.size()), bounds.min, bounds.max, Cache::CodecSettings()));
+    for (int i = 0; i < frames; i++) {
+        Physics::PhysicsUpdate(mpoints, springs, activeSet, features, cy::Vec3f(0.0f, -0.05f, 0.0f), 1.0f / 60.0f);
+        writer.Push(i, mpoints, activeSet.nodeAt);
+    }
+    writer.Close();
+    std::vector<char> intact;
+    {
+        std::ifstream in(cacheFile, std::ios::binary);
+        intact.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    Cache::QuantizedPlayer reference;
+    CHECK(reference.Open(cacheFile) && reference.NumFrames() == size_t(frames));
+    std::vector<float> last(reference.Decode(frames - 1), reference.Decode(frames - 1) + 3 * mpoints.size());
+    reference.Close();
+
+    const size_t footer = intact.size() - 12;   // the frame count, then "HW3I"
+    auto damaged = [&](auto damage, size_t expectedFrames) {
+        std::vector<char> bytes = intact;
+        damage(bytes);
+        {
+            std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), std::streamsize(bytes.size()));
+        }
+        Cache::QuantizedPlayer player;
+        CHECK(player.Open(cacheFile));
+        CHECK(player.NumFrames() == expectedFrames);
+        if (player.NumFrames() == size_t(frames)) {
+            CHECK(player.Time(frames - 1) == frames - 1);
+            CHECK(std::memcmp(player.Decode(frames - 1), last.data(), last.size() * sizeof(float)) == 0);
+        }
+    };
+    auto setCount = [&](uint64_t count) { return [=](std::vector<char>& b) { std::memcpy(&b[footer], &count, sizeof(count)); }; };
+    damaged(setCount(uint64_t(1) << 61), frames);       // count * 8 wraps around
+    damaged(setCount(footer), frames);                  // more offsets than the file holds
+    damaged([&](std::vector<char>& b) {                 // an offset past the end of the file
+        uint64_t far = b.size() + 100;
+        std::memcpy(&b[footer - sizeof(uint64_t)], &far, sizeof(far));
+    }, frames);
+    damaged([&](std::vector<char>& b) {                 // cut inside the last record: no footer
+        b.resize(footer - frames * sizeof(uint64_t) - 1);
+    }, frames - 1);
+    std::remove(cacheFile);
+}
+
+int main() {
+    checkPredictor(Cache::Predictor::Previous, 1e-3f);
+    checkPredictor(Cache::Predictor::Linear, 1e-3f);
+    checkPredictor(Cache::Predictor::Linear, 1e-4f);
+    checkDamagedIndex();
+    return TestScene::Finish("codec");
+}
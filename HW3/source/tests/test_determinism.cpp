@@ -0,0 +1,41 @@
+// Deterministic reductions (Solver.h): implicit runs with deterministic reductions give the same
+// state hash after every step with 1, 2 and 4 OpenMP threads, in float and in double.
+
+#include "TestScene.h"
+#include "StateHash.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Per-step state hashes of a deterministic implicit run on the given number of threads.
+template <typename P>
+static std::vector<uint64_t> HashRun(const TestScene::Mesh& mesh, int threads, int steps) {
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+    Physics::ImplicitStateT<P> implicitState;
+    implicitState.pcg.deterministic = true;
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    std::vector<uint64_t> hashes;
+    for (int i = 0; i < steps; i++) {
+        Physics::PhysicsUpdateImplicit(mpoints, springs, externalForce, 1.0f / 60.0f, implicitState);
+        hashes.push_back(StateHash::Hash(mpoints));
+    }
+    return hashes;
+}
+
+template <typename P>
+static void CheckThreadCounts(const TestScene::Mesh& mesh) {
+    std::vector<uint64_t> reference = HashRun<P>(mesh, 1, 30);
+    CHECK(HashRun<P>(mesh, 2, 30) == reference);
+    CHECK(HashRun<P>(mesh, 4, 30) == reference);
+}
+
+int main() {
+    // enough unknowns for several reduction blocks
+    TestScene::Mesh mesh = TestScene::Block(12, 12, 12);
+    CheckThreadCounts<FloatPrecision>(mesh);
+    CheckThreadCounts<DoublePrecision>(mesh);
+    return TestScene::Finish("determinism");
+}
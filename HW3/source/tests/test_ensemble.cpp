@@ -0,0 +1,55 @@
+// Ensembles (Ensemble.h): every lane, with its own stiffness and damping multipliers and its own
+// initial state, follows a scalar float run of springs scaled the same way.
+
+#include "TestScene.h"
+#include "Ensemble.h"
+
+template <int L>
+static void CheckLanes(const TestScene::Mesh& mesh) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<FloatPrecision>(mesh.nodes, mesh.edges);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    const float dt = 1.0f / 60.0f;
+    const int steps = 40;
+
+    // the last lane starts out moving sideways
+    auto pushed = mpoints;
+    for (auto &mp : pushed) if (!mp.fixed) mp.velocity = cy::Vec3f(0.5f, 0.0f, 0.0f);
+
+    Ensemble::EnsembleT<L> ensemble;
+    ensemble.Init(mpoints, springs);
+    for (int k = 0; k < L; k++) {
+        ensemble.stiffnessScale[k] = 0.5f + 1.5f * k / (L - 1);
+        ensemble.dampingScale[k] = 2.0f - 1.5f * k / (L - 1);
+    }
+    ensemble.SetLane(L - 1, pushed);
+    for (int i = 0; i < steps; i++) ensemble.Step(externalForce, dt);
+
+    double maxDifference = 0.0, spread = 0.0;
+    auto first = mpoints;
+    ensemble.GetLane(0, first);
+    for (int k = 0; k < L; k++) {
+        auto scalarPoints = k == L - 1 ? pushed : mpoints;
+        auto scalarSprings = springs;
+        for (auto &s : scalarSprings) {
+            s.stiffness *= ensemble.stiffnessScale[k];
+            s.damping *= ensemble.dampingScale[k];
+        }
+        for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(scalarPoints, scalarSprings, externalForce, dt);
+
+        auto lane = mpoints;
+        ensemble.GetLane(k, lane);
+        for (size_t i = 0; i < lane.size(); i++) {
+            maxDifference = std::max(maxDifference, double((lane[i].position - scalarPoints[i].position).Length()));
+            spread = std::max(spread, double((lane[i].position - first[i].position).Length()));
+        }
+    }
+    CHECK(maxDifference <= 1e-3);
+    CHECK(spread > 1e-2);   // the lanes really ran different simulations
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(4, 6, 4);
+    CheckLanes<8>(mesh);
+    CheckLanes<16>(mesh);
+    return TestScene::Finish("ensemble");
+}
@@ -0,0 +1,46 @@
+// Feature-specialized explicit step (Physics.h): DetectFeatures reports what the body holds, and
+// for every combination of damping, pins, masses and external force the kernel PhysicsUpdate
+// picks moves the points like the general kernel that tests for everything. Pinned points stay.
+
+#include "TestScene.h"
+
+using P = FloatPrecision;
+
+static float MaxDifference(const std::vector<MassPointT<P>>& a, const std::vector<MassPointT<P>>& b) {
+    float difference = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        difference = std::max(difference, (a[i].position - b[i].position).Length());
+        difference = std::max(difference, (a[i].velocity - b[i].velocity).Length());
+    }
+    return difference;
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(3, 5, 3);
+    for (int index = 0; index < 16; index++) {
+        bool damping = index & 1, fixed = index & 2, uniform = index & 4, external = index & 8;
+        auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+        if (!damping) for (auto &s : springs) s.damping = 0.0f;
+        if (!fixed) for (auto &mp : mpoints) mp.fixed = false;
+        if (!uniform) for (size_t i = 0; i < mpoints.size(); i++) mpoints[i].mass = 1.0f + 0.1f * float(i % 3);
+        const cy::Vec3f force = external ? cy::Vec3f(0.5f, 0.0f, -0.25f) : cy::Vec3f(0.0f, 0.0f, 0.0f);
+
+        Physics::StepFeatures features = Physics::DetectFeatures(mpoints, springs);
+        CHECK(features.damping == damping && features.hasFixed == fixed && features.uniformMass == uniform);
+
+        auto general = mpoints;
+        auto generalSprings = springs;
+        for (int step = 0; step < 100; step++) {
+            Physics::PhysicsUpdate(mpoints, springs, features, force, 1.0f / 60.0f);
+            Physics::PhysicsUpdateKernel<P, std::vector<SpringT<P>>, true, true, false, true>(general, generalSprings, Physics::FullLayout(general, generalSprings), force, 1.0f / 60.0f);
+        }
+        CHECK(MaxDifference(mpoints, general) < 1e-4f);
+
+        bool pinsHeld = true;
+        for (size_t i = 0; i < mpoints.size(); i++) {
+            if (mpoints[i].fixed) pinsHeld &= mpoints[i].position == decltype(mpoints[i].position)(mesh.nodes[i]);
+        }
+        CHECK(pinsHeld);
+    }
+    return TestScene::Finish("features");
+}
@@ -0,0 +1,51 @@
+// Fused node-centric step (FusedStep.h): the state after a fused run hashes the same as the
+// active-set run it replaces, in every precision policy and with any number of threads, and
+// fixed points are never written.
+
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "FusedStep.h"
+#include "StateHash.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+template <typename P>
+static void CheckPolicy(const TestScene::Mesh& mesh) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+    Physics::ActiveSetT<P> activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    const float dt = 1.0f / 60.0f;
+    const int steps = 40;
+    const auto start = mpoints;
+
+    Physics::FusedStateT<P> fused;
+    fused.Load(mpoints, springs);
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+
+    for (int threads : {1, 4}) {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        Physics::FusedStateT<P> run = fused;
+        for (int i = 0; i < steps; i++) Physics::PhysicsUpdateFused(run, features, externalForce, dt);
+        auto result = start;
+        run.Store(result);
+        CHECK(StateHash::Hash(result) == StateHash::Hash(mpoints));
+        bool pinned = true;
+        for (size_t i = 0; i < result.size(); i++) {
+            if (start[i].fixed) pinned &= result[i].position == start[i].position;
+        }
+        CHECK(pinned);
+    }
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(5, 8, 5);
+    CheckPolicy<FloatPrecision>(mesh);
+    CheckPolicy<MixedPrecision>(mesh);
+    CheckPolicy<DoublePrecision>(mesh);
+    return TestScene::Finish("fused");
+}
@@ -0,0 +1,62 @@
+// Packed springs (PackedSprings.h): with one material the packed step is bitwise identical to the
+// spring records; with three, every spring lands once in a run of its own material and the result
+// differs only by the order of the sums.
+
+#include <map>
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "PackedSprings.h"
+
+// variants > 1 scales the parameters of every variants-th spring differently, as the benchmark does.
+static void CheckMaterials(const TestScene::Mesh& mesh, int variants) {
+    using P = FloatPrecision;
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+    for (size_t i = 0; i < springs.size(); i++) {
+        springs[i].stiffness *= 1.0f + float(i % variants);
+        springs[i].damping   *= 1.0f + float(i % variants);
+    }
+    Physics::ActiveSetT<P> activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    const float dt = 1.0f / 60.0f;
+    Physics::PackedSpringsT<P> packed;
+    packed.Build(springs, activeSet.Layout());
+
+    CHECK(packed.materials.size() == size_t(variants));
+    CHECK(packed.springs.size() == activeSet.freePinnedEnd);
+    CHECK(packed.runs.size() <= size_t(2 * variants));
+    std::map<std::pair<int,int>, Physics::MaterialT<P>> materialOf;
+    for (size_t i = 0; i < activeSet.freePinnedEnd; i++) materialOf[{ springs[i].a, springs[i].b }] = { springs[i].stiffness, springs[i].damping };
+    size_t packedCount = 0;
+    bool materialsMatch = true;
+    for (const auto &run : packed.runs) {
+        for (uint32_t i = run.begin; i < run.end; i++) {
+            auto it = materialOf.find({ packed.springs[i].a, packed.springs[i].b });
+            materialsMatch &= it != materialOf.end() && it->second == packed.materials[run.material];
+            if (it != materialOf.end()) materialOf.erase(it);
+            packedCount++;
+        }
+    }
+    CHECK(materialsMatch);
+    CHECK(materialOf.empty() && packedCount == packed.springs.size());
+
+    auto packedPoints = mpoints;
+    for (int i = 0; i < 40; i++) {
+        Physics::PhysicsUpdate(mpoints, springs, activeSet.Layout(), features, externalForce, dt);
+        Physics::PhysicsUpdate(packedPoints, packed, activeSet.Layout(), features, externalForce, dt);
+    }
+    double maxDifference = 0.0;
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        maxDifference = std::max(maxDifference, double((packedPoints[i].position - mpoints[i].position).Length()));
+    }
+    if (variants == 1) CHECK(maxDifference == 0.0);
+    else CHECK(maxDifference < 1e-3);
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(5, 8, 5);
+    CheckMaterials(mesh, 1);
+    CheckMaterials(mesh, 3);
+    return TestScene::Finish("packed");
+}
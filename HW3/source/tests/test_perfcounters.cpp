@@ -0,0 +1,43 @@
+// Hardware counters (PerfCounters.h): switched off, scopes count nothing; switched on, the
+// physics phases of a step are counted once per step on a machine with counters, and left out
+// without them (containers and VMs usually have none), with the step itself unchanged.
+// TakeTotals hands the totals over once.
+
+#include "TestScene.h"
+#include "PerfCounters.h"
+
+using P = FloatPrecision;
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(3, 5, 3);
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+    auto uncounted = mpoints;
+    auto uncountedSprings = springs;
+    const int steps = 20;
+
+    PerfCounters::enabled = false;
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(uncounted, uncountedSprings, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f / 60.0f);
+    CHECK(PerfCounters::TakeTotals().empty());
+
+    PerfCounters::enabled = true;
+    for (int i = 0; i < steps; i++) Physics::PhysicsUpdate(mpoints, springs, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f / 60.0f);
+    auto totals = PerfCounters::TakeTotals();
+    if (PerfCounters::Thread().Available()) {
+        for (const char* phase : { "forces", "springs", "integrate" }) {
+            auto it = totals.find(phase);
+            CHECK(it != totals.end() && it->second.calls == uint64_t(steps));
+        }
+        auto springsPhase = totals.find("springs");
+        if (springsPhase != totals.end() && springsPhase->second.values.valid[PerfCounters::INSTRUCTIONS]) {
+            CHECK(springsPhase->second.values.count[PerfCounters::INSTRUCTIONS] > springs.size());
+        }
+    } else {
+        CHECK(totals.empty());
+    }
+    CHECK(PerfCounters::TakeTotals().empty());
+
+    bool same = true;
+    for (size_t i = 0; i < mpoints.size(); i++) same &= mpoints[i].position == uncounted[i].position;
+    CHECK(same);
+    return TestScene::Finish("perfcounters");
+}
@@ -0,0 +1,48 @@
+// Precision policies (Physics.h): the policies store and accumulate in the types they name, and
+// a float or mixed run of the block, explicit or implicit, stays close to the double run of the
+// same steps (float storage rounding dominates both, at about 5e-5 here).
+
+#include <type_traits>
+#include "TestScene.h"
+
+static_assert(std::is_same<decltype(MassPointT<FloatPrecision>().position.x), float>::value, "float storage");
+static_assert(std::is_same<decltype(MassPointT<DoublePrecision>().position.x), double>::value, "double storage");
+static_assert(std::is_same<decltype(MassPointT<MixedPrecision>().position.x), float>::value, "mixed storage");
+static_assert(std::is_same<decltype(MassPointT<MixedPrecision>().force.x), double>::value, "mixed accumulation");
+
+template <typename P>
+static std::vector<cy::Vec3d> Run(const TestScene::Mesh& mesh, bool implicit, int steps) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+    Physics::ImplicitStateT<P> state;
+    for (int i = 0; i < steps; i++) {
+        if (implicit) Physics::PhysicsUpdateImplicit(mpoints, springs, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f / 60.0f, state);
+        else          Physics::PhysicsUpdate(mpoints, springs, cy::Vec3f(0.0f, 0.0f, 0.0f), 1.0f / 60.0f);
+    }
+    std::vector<cy::Vec3d> positions;
+    for (auto &mp : mpoints) positions.push_back(cy::Vec3d(mp.position));
+    return positions;
+}
+
+static double MaxDrift(const std::vector<cy::Vec3d>& a, const std::vector<cy::Vec3d>& b) {
+    double drift = 0.0;
+    for (size_t i = 0; i < a.size(); i++) drift = std::max(drift, (a[i] - b[i]).Length());
+    return drift;
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(4, 6, 4);
+    for (bool implicit : { false, true }) {
+        auto reference = Run<DoublePrecision>(mesh, implicit, 300);
+        auto single    = Run<FloatPrecision>(mesh, implicit, 300);
+        auto mixed     = Run<MixedPrecision>(mesh, implicit, 300);
+
+        // the body has fallen and swung by several units, so these bound the relative error
+        bool moved = false;
+        for (size_t i = 0; i < reference.size(); i++) moved |= (reference[i] - cy::Vec3d(mesh.nodes[i])).Length() > 1.0;
+        CHECK(moved);
+        CHECK(MaxDrift(single, reference) < 1e-3);
+        CHECK(MaxDrift(mixed, reference) < 1e-3);
+        CHECK(MaxDrift(single, reference) > 0.0);   // the float run really rounds to float
+    }
+    return TestScene::Finish("precision");
+}
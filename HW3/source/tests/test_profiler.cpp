@@ -0,0 +1,81 @@
+// Frame profiler (Profiler.h): the rolling summary counts each phase of every thread once per
+// scope over its window, with ordered percentiles; a burst larger than a ring keeps only the
+// newest events, and the trace written at shutdown holds exactly what the rings still hold.
+
+#include <cstdio>
+#include <thread>
+#include "TestScene.h"
+#include "Profiler.h"
+
+static const Profiler::PhaseSummary* Find(const std::vector<Profiler::PhaseSummary>& summary, const char* name) {
+    for (auto &s : summary) {
+        if (s.name == name) return &s;
+    }
+    return nullptr;
+}
+
+static void Work(int n) {
+    volatile double x = 0.0;
+    for (int i = 0; i < n; i++) x = x + std::sqrt(double(i));
+}
+
+int main() {
+    Profiler::summaryFile   = "test_profiler.csv";
+    Profiler::traceFile     = "test_profiler.json";
+    Profiler::summaryFrames = 10;
+
+    // a window of nested scopes on this thread and a few on another
+    std::thread worker([] {
+        for (int i = 0; i < 5; i++) {
+            PROFILE_SCOPE("worker");
+            Work(1000);
+        }
+    });
+    worker.join();
+    for (int frame = 0; frame < 10; frame++) {
+        {
+            PROFILE_SCOPE("outer");
+            Work(2000);
+            PROFILE_SCOPE("inner");
+            Work(2000);
+        }
+        PROFILE_FRAME();
+    }
+    auto summary = Profiler::LatestSummary();
+    const Profiler::PhaseSummary *outer = Find(summary, "outer"), *inner = Find(summary, "inner"), *work = Find(summary, "worker");
+    CHECK(outer && outer->count == 10);
+    CHECK(inner && inner->count == 10);
+    CHECK(work && work->count == 5);
+    if (outer && inner) {
+        CHECK(outer->meanMs >= inner->meanMs);
+        CHECK(0 < outer->p50Ms && outer->p50Ms <= outer->p95Ms && outer->p95Ms <= outer->p99Ms);
+    }
+
+    // a burst that overruns the ring: only the newest CAPACITY events are left to summarize
+    const size_t burst = Profiler::Ring::CAPACITY + 1000;
+    for (size_t i = 0; i < burst; i++) {
+        PROFILE_SCOPE("burst");
+    }
+    for (int frame = 0; frame < 10; frame++) PROFILE_FRAME();
+    summary = Profiler::LatestSummary();
+    CHECK(summary.size() == 1 && summary[0].name == "burst" && summary[0].count == Profiler::Ring::CAPACITY);
+
+    PROFILE_SHUTDOWN();
+    {
+        std::ifstream in(Profiler::traceFile);
+        std::string trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        size_t events = 0;
+        for (size_t at = trace.find("\"ph\":\"X\""); at != std::string::npos; at = trace.find("\"ph\":\"X\"", at + 1)) events++;
+        CHECK(events == Profiler::Ring::CAPACITY + 5);
+        CHECK(trace.find("\"name\":\"outer\"") == std::string::npos);
+    }
+    {
+        std::ifstream in(Profiler::summaryFile);
+        std::string header;
+        std::getline(in, header);
+        CHECK(header == "frame,phase,count,mean_ms,p50_ms,p95_ms,p99_ms,cycles,instructions,llc_misses,branch_misses");
+    }
+    std::remove(Profiler::summaryFile.c_str());
+    std::remove(Profiler::traceFile.c_str());
+    return TestScene::Finish("profiler");
+}
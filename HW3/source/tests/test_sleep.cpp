@@ -0,0 +1,99 @@
+// Island sleep (Sleep.h): pinned points belong to no island, a body at rest falls asleep island
+// by island, sleeping points stay put, a poke wakes everything, and afterwards islands next to
+// moving ones stay awake without flipping between the two states. After a relayout a reset
+// implicit state steps like a fresh one.
+
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "Sleep.h"
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(6, 9, 6);
+    auto [mpoints, springs] = SceneSetup::MakeBody<SimPrecision>(mesh.nodes, mesh.edges, SceneSetup::Stiff);
+    TestScene::Settle(mpoints, springs);
+    Physics::ActiveSet activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    features.hasFixed = false;
+    const cy::Vec3f externalForce(0.0f, 0.0f, 0.0f);
+    const float dt = 1.0f / 60.0f;
+    const size_t numFree = activeSet.numFree;
+
+    Physics::SleepIslands islands;
+    islands.Build(mpoints, springs, activeSet);
+    size_t members = 0;
+    bool noPinned = true;
+    for (auto &island : islands.members) {
+        members += island.size();
+        for (int node : island) noPinned &= !mpoints[activeSet.slotOf[node]].fixed;
+    }
+    CHECK(islands.Size() > 1);
+    CHECK(noPinned);
+    CHECK(members == numFree);
+
+    auto step = [&]() {
+        Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+        return islands.Update(mpoints, springs, activeSet);
+    };
+    auto stateOf = [&]() {
+        std::vector<bool> asleep;
+        for (auto &c : islands.counters) asleep.push_back(c.asleep);
+        return asleep;
+    };
+
+    for (int i = 0; i < islands.params.calmSteps + 10; i++) step();
+    CHECK(islands.numAsleep == islands.Size());
+    CHECK(activeSet.numFree == 0);
+    auto resting = mpoints;
+    for (int i = 0; i < 10; i++) CHECK(!step());
+    CHECK(std::memcmp(resting.data(), mpoints.data(), mpoints.size() * sizeof(MassPoint)) == 0);
+
+    // poke the lowest layer of nodes sideways
+    CHECK(islands.WakeAll(mpoints, springs, activeSet));
+    CHECK(islands.numAsleep == 0 && activeSet.numFree == numFree);
+    for (size_t slot = 0; slot < activeSet.numFree; slot++) {
+        if (mesh.nodes[activeSet.nodeAt[slot]].y == 0.0f) mpoints[slot].velocity = decltype(mpoints[slot].velocity)(1, 0, 0);
+    }
+    std::vector<int> wokeAt(islands.Size(), -1);
+    std::vector<bool> before = stateOf();
+    size_t leastAsleep = islands.Size(), mostAsleep = 0;
+    bool neighboursCalm = true, slowFlips = true;
+    for (int i = 0; i < 600; i++) {
+        step();
+        std::vector<bool> after = stateOf();
+        for (size_t k = 0; k < islands.Size(); k++) {
+            // a woken island counts its calm steps again from zero before it can fall back asleep
+            if (!after[k] && before[k]) wokeAt[k] = i;
+            if (after[k] && !before[k]) slowFlips &= i - wokeAt[k] >= islands.params.calmSteps;
+        }
+        before = after;
+        if (i >= islands.params.calmSteps) {
+            leastAsleep = std::min(leastAsleep, islands.numAsleep);
+            mostAsleep = std::max(mostAsleep, islands.numAsleep);
+        }
+        // no island sleeps next to one that moves fast enough to wake it
+        for (size_t k = 0; k < islands.Size(); k++) {
+            if (!after[k]) continue;
+            for (int n : islands.neighbours[k]) neighboursCalm &= after[n] || islands.energy[n] <= islands.params.wakeFactor * islands.params.energy;
+        }
+    }
+    CHECK(neighboursCalm);
+    CHECK(mostAsleep > 0);
+    CHECK(leastAsleep < islands.Size());
+    CHECK(slowFlips);
+
+    // an implicit state used before a relayout and then reset steps like a fresh one
+    Physics::ImplicitState used, fresh;
+    used.assemble = fresh.assemble = true;
+    auto earlier = mpoints;
+    Physics::PhysicsUpdateImplicit(earlier, springs, externalForce, dt, used);
+    bool relaid = false;
+    for (int i = 0; i < 1000 && !relaid; i++) relaid = step();
+    CHECK(relaid);
+    used.ResetPattern();
+    auto reused = mpoints, reference = mpoints;
+    Physics::PhysicsUpdateImplicit(reused, springs, externalForce, dt, used);
+    Physics::PhysicsUpdateImplicit(reference, springs, externalForce, dt, fresh);
+    CHECK(std::memcmp(reused.data(), reference.data(), reused.size() * sizeof(MassPoint)) == 0);
+    return TestScene::Finish("sleep");
+}
@@ -0,0 +1,138 @@
+// PCG solver and implicit Euler (Solver.h, Physics::PhysicsUpdateImplicit): every preconditioner
+// solves a system shaped like the implicit one to the requested residual, the preconditioned
+// solves take fewer iterations than plain CG, matrix-free products match the assembled matrix, a
+// warm start from the solution costs no iterations, and an implicit step stays put at a step the
+// explicit one cannot take. Also pins the sign of the spring force: a stretched spring pulls.
+
+#include "TestScene.h"
+#include "Physics.h"
+
+// 3n x 3n matrix of a chain of unit masses joined by stiff springs along varying directions:
+// M plus a e e^T + b I on the diagonal blocks of both ends and minus it between them.
+static Solver::CSRMatrix<float> ChainMatrix(int nodes) {
+    std::vector<float> blocks(9 * size_t(nodes) * nodes, 0.0f);   // dense, node pair (i, j) at 9 (i n + j)
+    auto block = [&](int i, int j) { return &blocks[9 * (size_t(i) * nodes + j)]; };
+    for (int i = 0; i < nodes; i++) {
+        for (int c = 0; c < 3; c++) block(i, i)[4 * c] = 1.0f;
+    }
+    for (int i = 0; i + 1 < nodes; i++) {
+        cy::Vec3f e(std::sin(0.7f * i), std::cos(1.3f * i), 0.5f);
+        e.Normalize();
+        const float alpha = 40.0f, beta = 2.0f;
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                float s = alpha * e[r] * e[c] + (r == c ? beta : 0.0f);
+                block(i, i)[3 * r + c]         += s;
+                block(i + 1, i + 1)[3 * r + c] += s;
+                block(i, i + 1)[3 * r + c]     -= s;
+                block(i + 1, i)[3 * r + c]     -= s;
+            }
+        }
+    }
+    Solver::CSRMatrix<float> A;
+    A.n = 3 * nodes;
+    A.rowStart.assign(A.n + 1, 0);
+    for (int row = 0; row < A.n; row++) {
+        int i = row / 3;
+        for (int j = std::max(i - 1, 0); j <= std::min(i + 1, nodes - 1); j++) {
+            for (int c = 0; c < 3; c++) {
+                A.col.push_back(3 * j + c);
+                A.val.push_back(block(i, j)[3 * (row % 3) + c]);
+            }
+        }
+        A.rowStart[row + 1] = int(A.col.size());
+    }
+    return A;
+}
+
+int main() {
+    const int nodes = 200;
+    Solver::CSRMatrix<float> A = ChainMatrix(nodes);
+    std::vector<float> expected(A.n), b(A.n);
+    for (int i = 0; i < A.n; i++) expected[i] = std::sin(0.1f * i);
+    A.Multiply(expected, b);
+    auto maxError = [&](const std::vector<float>& x) {
+        double e = 0.0;
+        for (int i = 0; i < A.n; i++) e = std::max(e, double(std::abs(x[i] - expected[i])));
+        return e;
+    };
+
+    int iterations[4] = {};
+    const Solver::Preconditioner preconditioners[4] = { Solver::Preconditioner::Identity, Solver::Preconditioner::Jacobi,
+                                                        Solver::Preconditioner::BlockJacobi, Solver::Preconditioner::IC0 };
+    for (int p = 0; p < 4; p++) {
+        Solver::PCG<float> pcg;
+        pcg.preconditioner = preconditioners[p];
+        pcg.maxIterations = 1000;
+        pcg.tolerance = 1e-5;
+        pcg.SetupFromMatrix(A);
+        std::vector<float> x(A.n, 0.0f);
+        Solver::SolveResult result = pcg.Solve(A, b, x);
+        CHECK(result.converged && result.residual <= pcg.tolerance);
+        CHECK(maxError(x) < 1e-2);
+        iterations[p] = result.iterations;
+
+        // warm start from the solution: nothing left to do
+        Solver::SolveResult again = pcg.Solve(A, b, x);
+        CHECK(again.converged && again.iterations == 0);
+    }
+    CHECK(iterations[2] < iterations[0]);
+    CHECK(iterations[3] < iterations[0]);
+
+    // matrix-free: the operator and the diagonal blocks instead of the matrix
+    {
+        std::vector<float> blocks(9 * size_t(nodes), 0.0f);
+        for (int row = 0; row < A.n; row++) {
+            for (int k = A.rowStart[row]; k < A.rowStart[row + 1]; k++) {
+                if (A.col[k] / 3 == row / 3) blocks[9 * (row / 3) + 3 * (row % 3) + A.col[k] % 3] = A.val[k];
+            }
+        }
+        Solver::PCG<float> pcg;
+        pcg.maxIterations = 1000;
+        pcg.tolerance = 1e-5;
+        pcg.SetupFromBlocks(blocks);
+        std::vector<float> x(A.n, 0.0f);
+        Solver::SolveResult result = pcg.Solve([&](const std::vector<float>& in, std::vector<float>& out) { A.Multiply(in, out); }, b, x);
+        CHECK(result.converged && result.iterations == iterations[2]);
+        CHECK(maxError(x) < 1e-2);
+    }
+
+    // a stretched spring between two free points pulls them together
+    {
+        std::vector<MassPoint> pair(2);
+        pair[0].position = decltype(pair[0].position)(0, 0, 0);
+        pair[1].position = decltype(pair[1].position)(2, 0, 0);
+        std::vector<Spring> spring = { { 0, 1, 1.0f, 10.0f, 0.0f } };
+        Physics::PhysicsUpdate(pair, spring, cy::Vec3f(0.0f, 0.0f, 0.0f), 0.01f);
+        CHECK(pair[0].velocity.x > 0 && pair[1].velocity.x < 0);
+        CHECK(std::abs(pair[0].velocity.x + pair[1].velocity.x) < 1e-6);
+    }
+
+    // a stiff hanging chain at a step far over the explicit stability limit (about 2 / sqrt(4 k))
+    {
+        const int links = 10;
+        std::vector<MassPoint> chain(links + 1);
+        std::vector<Spring> springs;
+        for (int i = 0; i <= links; i++) chain[i].position = decltype(chain[i].position)(0, -i, 0);
+        chain[0].fixed = true;
+        for (int i = 0; i < links; i++) springs.push_back({ i, i + 1, 1.0f, 1000.0f, 1.0f });
+        auto explicitChain = chain, implicitChain = chain;
+        Physics::ImplicitState state;
+        const float dt = 0.1f;
+        for (int step = 0; step < 100; step++) {
+            Physics::PhysicsUpdate(explicitChain, springs, cy::Vec3f(0.0f, 0.0f, 0.0f), dt);
+            Physics::PhysicsUpdateImplicit(implicitChain, springs, cy::Vec3f(0.0f, 0.0f, 0.0f), dt, state);
+        }
+        bool explicitBounded = true, implicitNearRest = true;
+        float rest = 0.0f;   // each link stretches by the weight below it over k
+        for (int i = 0; i <= links; i++) {
+            if (i > 0) rest -= 1.0f + 9.8f * (links - i + 1) / 1000.0f;
+            explicitBounded &= std::abs(float(explicitChain[i].position.y)) < 100.0f;
+            implicitNearRest &= std::abs(float(implicitChain[i].position.y) - rest) < 1e-2f && std::abs(float(implicitChain[i].position.x)) < 1e-3f;
+        }
+        CHECK(!explicitBounded);
+        CHECK(implicitNearRest);
+        CHECK(state.pcg.lastResult.converged);
+    }
+    return TestScene::Finish("solver");
+}
@@ -0,0 +1,79 @@
+// Parameter sweeps (Sweep.h): a spec expands to every combination, a bad spec is rejected, the
+// work-stealing pool runs every index exactly once even when one run holds up its worker, and the
+// meshes' tetrahedra are numbered from the .node file's first index.
+
+#include "TestScene.h"
+#include "Sweep.h"
+
+static void WriteFile(const char* fileName, const char* text) {
+    std::ofstream out(fileName);
+    out << text;
+}
+
+int main() {
+    const char* specFile = "test_sweep.spec";
+    WriteFile(specFile,
+              "# three stiffnesses, two steps, both integrators\n"
+              "stiffness   0.1 0.2 0.4\n"
+              "dt          0.0166667 0.00833333   # halved\n"
+              "integrator  explicit implicit\n"
+              "duration    0.25\n");
+    Sweep::Spec spec;
+    CHECK(Sweep::LoadSpec(specFile, spec));
+    std::vector<Sweep::RunParams> runs = spec.Expand();
+    CHECK(runs.size() == 12);
+    CHECK(runs.size() == 12 && runs[0].stiffness == 0.1f && runs[0].dt == 0.0166667f && !runs[0].implicit && runs[1].implicit);
+    CHECK(runs.size() == 12 && runs[11].stiffness == 0.4f && runs[11].Steps() == 30);
+
+    Sweep::Spec rejected;
+    WriteFile(specFile, "stiffness 0.1 soft\n");
+    CHECK(!Sweep::LoadSpec(specFile, rejected));
+    WriteFile(specFile, "integrator verlet\n");
+    CHECK(!Sweep::LoadSpec(specFile, rejected));
+    WriteFile(specFile, "gravity 9.8\n");
+    CHECK(!Sweep::LoadSpec(specFile, rejected));
+    std::remove(specFile);
+
+    // run 0 is slow, so the other workers have to take what was dealt to its worker
+    TestScene::Mesh block = TestScene::Block(3, 4, 3);
+    Sweep::Mesh mesh = { block.nodes, block.edges };
+    std::vector<Sweep::RunResult> results(runs.size());
+    std::vector<std::atomic<int>> visits(runs.size());
+    std::vector<size_t> order(runs.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    Sweep::WorkStealingPool pool(3);
+    pool.Run(order, [&](size_t index, int worker) {
+        visits[index]++;
+        if (index == 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        results[index] = Sweep::Simulate<SimPrecision>(runs[index], mesh);
+        results[index].worker = worker;
+    });
+    bool once = true, finished = true;
+    for (size_t i = 0; i < runs.size(); i++) {
+        once &= visits[i] == 1;
+        finished &= results[i].stable && results[i].steps == runs[i].Steps() && results[i].maxDisplacement > 0.0;
+    }
+    CHECK(once);
+    CHECK(finished);
+    CHECK(pool.Steals() > 0);
+
+    // the tetrahedron leaves out the first node, so only the .node file tells the numbering
+    for (int first : { 0, 1 }) {
+        std::ostringstream node, ele;
+        node << "5 3 0 0\n";
+        for (int i = 0; i < 5; i++) node << first + i << " " << i << " 0 0\n";
+        ele << "1 4 0\n0 " << first + 1 << " " << first + 2 << " " << first + 3 << " " << first + 4 << "\n";
+        WriteFile("test_sweep.node", node.str().c_str());
+        WriteFile("test_sweep.ele", ele.str().c_str());
+        std::vector<cy::Vec3f> nodes;
+        std::vector<Models::Tetrahedron> tets;
+        cy::Vec3f centroid(0.0f, 0.0f, 0.0f);
+        int firstIndex = -1;
+        CHECK(Models::loadNodes("test_sweep.node", nodes, centroid, firstIndex) && firstIndex == first);
+        CHECK(Models::loadTetrahedra("test_sweep.ele", tets, firstIndex) && tets.size() == 1);
+        CHECK(tets.size() == 1 && tets[0].v[0] == 1 && tets[0].v[3] == 4 && nodes[tets[0].v[3]].x == 4.0f);
+    }
+    std::remove("test_sweep.node");
+    std::remove("test_sweep.ele");
+    return TestScene::Finish("sweep");
+}
@@ -0,0 +1,57 @@
+// Position Verlet (Verlet.h): a Verlet run stays close to the explicit step it replaces, in float
+// and in double, pinned points do not move, halving the step midway barely changes the result
+// and the velocities written back by Store match the explicit ones.
+
+#include "TestScene.h"
+#include "ActiveSet.h"
+#include "Verlet.h"
+
+template <typename P>
+static void CheckPolicy(const TestScene::Mesh& mesh) {
+    auto [mpoints, springs] = SceneSetup::MakeBody<P>(mesh.nodes, mesh.edges);
+    Physics::ActiveSetT<P> activeSet;
+    Physics::BuildActiveSet(mpoints, springs, activeSet);
+    auto features = Physics::DetectFeatures(mpoints, springs);
+    const cy::Vec3f externalForce(0.0f, -0.05f, 0.0f);
+    const float dt = 1.0f / 60.0f;
+    const int steps = 60;
+    const auto start = mpoints;
+
+    Verlet::VerletStateT<P> verlet, refined;
+    verlet.Load(mpoints, dt);
+    refined.Load(mpoints, dt);
+    for (int i = 0; i < steps; i++) {
+        Physics::PhysicsUpdate(mpoints, springs, activeSet, features, externalForce, dt);
+        Verlet::VerletUpdate(verlet, springs, activeSet.Layout(), features, externalForce, dt);
+        if (i < steps / 2) {
+            Verlet::VerletUpdate(refined, springs, activeSet.Layout(), features, externalForce, dt);
+        } else {
+            for (int k = 0; k < 2; k++) Verlet::VerletUpdate(refined, springs, activeSet.Layout(), features, externalForce, 0.5f * dt);
+        }
+    }
+
+    double fall = 0.0, maxDifference = 0.0, refinedDifference = 0.0;
+    bool pinned = true;
+    for (size_t i = 0; i < mpoints.size(); i++) {
+        fall = std::max(fall, double((mpoints[i].position - start[i].position).Length()));
+        maxDifference = std::max(maxDifference, double((verlet.position[i] - mpoints[i].position).Length()));
+        refinedDifference = std::max(refinedDifference, double((refined.position[i] - verlet.position[i]).Length()));
+        if (mpoints[i].fixed) pinned &= verlet.position[i] == start[i].position;
+    }
+    CHECK(pinned);
+    CHECK(fall > 0.1);
+    CHECK(maxDifference < 1e-3 * fall);
+    CHECK(refinedDifference < 1e-2 * fall);
+
+    auto stored = mpoints;
+    verlet.Store(stored);
+    CHECK(stored[0].position == verlet.position[0]);
+    CHECK(((stored[0].velocity - mpoints[0].velocity).Length()) < 1e-2 * mpoints[0].velocity.Length());
+}
+
+int main() {
+    TestScene::Mesh mesh = TestScene::Block(4, 6, 4);
+    CheckPolicy<FloatPrecision>(mesh);
+    CheckPolicy<DoublePrecision>(mesh);
+    return TestScene::Finish("verlet");
+}